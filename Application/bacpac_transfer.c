@@ -0,0 +1,452 @@
+/******************************************************************************
+
+ @file  bacpac_transfer.c
+
+ @brief Offload of the recorded data over the BACPAC Channel characteristic.
+        Moved out of the application task so the protocol can be driven by
+        the host build.
+
+ *****************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include "bacpac_transfer.h"
+#include "Sensors/sensors.h"
+#include "Sensors/DiskAccess.h"
+#include "Sensors/Storage.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+// Where the transferred bytes come from
+struct BacpacTransferSource
+{
+    int (*size)(void);                      // bytes left to send
+    uint32_t (*position)(void);             // where the next read starts
+    int (*read)(char *buffer, int size);    // size, -1 or BACPAC_TRANSFER_BUSY
+    void (*commit)(void);                   // everything sent so far was received
+    void (*checkpoint)(void);               // keep the last commit across a reset
+    void (*rollback)(void);                 // back to the last commit
+    void (*finish)(void);                   // the whole transfer was received
+    void (*clear)(void);                    // the central gave up
+};
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static const struct BacpacTransferSource *source;
+static int chunkSent;
+static uint16_t chunksSinceCheckpoint;
+static int remaining;
+static uint8_t finished;
+static uint32_t startTime;
+static struct BacpacTransferStats stats;
+
+static volatile int diskReadResult = DISK_SUCCESS;
+static uint32_t diskReadPosition;
+static char *diskReadBuffer;
+static int diskReadSize;                    // of the last read request, 0 once its bytes were taken
+static uint8_t diskRequestsPending;         // bit per request type the storage queue had no room for
+static uint8_t diskClearsPending;           // bit per cursor of STORAGE_CLEAR requests that didn't fit either
+
+static uint32_t patternSize;
+static uint32_t patternPos;
+static uint32_t patternCommitted;
+
+/*********************************************************************
+ * SD card source
+ */
+static int BacpacTransfer_diskSize(void)
+{
+    return da_get_data_size();
+}
+
+static uint32_t BacpacTransfer_diskPosition(void)
+{
+    return da_get_read_pos();
+}
+
+// the storage task is still writing into the caller's buffer
+static uint8_t BacpacTransfer_diskReading(void)
+{
+    return diskReadResult == STORAGE_PENDING;
+}
+
+static int BacpacTransfer_diskRead(char *buffer, int size)
+{
+    if (BacpacTransfer_diskReading()) return BACPAC_TRANSFER_BUSY;
+
+    // the bytes of the last request, unless the transfer moved on while they were read
+    if (diskReadSize == size && diskReadPosition == (uint32_t) da_get_read_pos() && diskReadBuffer == buffer)
+    {
+        diskReadSize = 0;
+        if (diskReadResult != DISK_SUCCESS) return -1;
+        da_advance(size);
+        return size;
+    }
+
+    // a clear or commit that is still waiting for room goes first
+    if (BacpacTransfer_poll()) return BACPAC_TRANSFER_BUSY;
+
+    struct StorageRequest request = { STORAGE_READ, DA_CURSOR_DEFAULT, size, da_get_read_pos(), buffer, &diskReadResult, NULL };
+    diskReadSize = 0;
+    if (Storage_submit(&request) != DISK_SUCCESS) return -1;
+    diskReadPosition = request.position;
+    diskReadBuffer = buffer;
+    diskReadSize = size;
+
+    // without the storage task it is done already
+    return BacpacTransfer_diskReading() ? BACPAC_TRANSFER_BUSY : BacpacTransfer_diskRead(buffer, size);
+}
+
+static uint8_t BacpacTransfer_diskSubmit(uint8_t type, uint8_t cursor)
+{
+    struct StorageRequest request = { type, cursor, 0, 0, NULL, NULL, NULL };
+    return Storage_submit(&request) == DISK_SUCCESS;
+}
+
+// The queue is shared with the benchmark and the mount, so it can be full. A request
+// that doesn't fit is kept and submitted again by BacpacTransfer_poll, in order.
+static void BacpacTransfer_diskRequest(uint8_t type)
+{
+    uint8_t cursor = da_get_cursor();
+
+    if (!BacpacTransfer_poll() && BacpacTransfer_diskSubmit(type, cursor)) return;
+
+    if (type == STORAGE_CLEAR) diskClearsPending |= 1 << cursor;
+    else diskRequestsPending |= 1 << type;
+}
+
+static void BacpacTransfer_diskCommit(void)
+{
+    da_soft_commit();
+}
+
+static void BacpacTransfer_diskCheckpoint(void)
+{
+    BacpacTransfer_diskRequest(STORAGE_CHECKPOINT);
+}
+
+static void BacpacTransfer_diskRollback(void)
+{
+    diskReadSize = 0; // whatever is being read gets read again
+    da_soft_rollback();
+}
+
+static void BacpacTransfer_diskFinish(void)
+{
+    if (Sensors_get_config()->flags & CONFIG_FLAG_FOURTYEIGHT) BacpacTransfer_diskRequest(STORAGE_CLOSE);
+    else BacpacTransfer_diskRequest(STORAGE_COMMIT);
+}
+
+static void BacpacTransfer_diskClear(void)
+{
+    diskReadSize = 0;
+    BacpacTransfer_diskRequest(STORAGE_CLEAR);
+}
+
+static const struct BacpacTransferSource diskSource =
+{
+    BacpacTransfer_diskSize,
+    BacpacTransfer_diskPosition,
+    BacpacTransfer_diskRead,
+    BacpacTransfer_diskCommit,
+    BacpacTransfer_diskCheckpoint,
+    BacpacTransfer_diskRollback,
+    BacpacTransfer_diskFinish,
+    BacpacTransfer_diskClear
+};
+
+/*********************************************************************
+ * Pattern source
+ */
+static int BacpacTransfer_patternSize(void)
+{
+    return patternSize - patternPos;
+}
+
+static uint32_t BacpacTransfer_patternPosition(void)
+{
+    return patternPos;
+}
+
+static int BacpacTransfer_patternRead(char *buffer, int size)
+{
+    BacpacTransfer_fillPattern(buffer, patternPos, size);
+    patternPos += size;
+    return size;
+}
+
+static void BacpacTransfer_patternCommit(void)
+{
+    patternCommitted = patternPos;
+}
+
+static void BacpacTransfer_patternRollback(void)
+{
+    patternPos = patternCommitted;
+}
+
+static void BacpacTransfer_patternNothing(void)
+{
+}
+
+static const struct BacpacTransferSource patternSource =
+{
+    BacpacTransfer_patternSize,
+    BacpacTransfer_patternPosition,
+    BacpacTransfer_patternRead,
+    BacpacTransfer_patternCommit,
+    BacpacTransfer_patternNothing,
+    BacpacTransfer_patternRollback,
+    BacpacTransfer_patternNothing,
+    BacpacTransfer_patternNothing
+};
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+static int BacpacTransfer_start(const struct BacpacTransferSource *newSource)
+{
+    // starting over doesn't skip a chunk the central didn't acknowledge
+    if (source) source->rollback();
+
+    source = newSource;
+    chunkSent = 0;
+    chunksSinceCheckpoint = 0;
+    finished = 0;
+    memset(&stats, 0, sizeof(stats));
+    startTime = Timestamp_get32();
+
+    source->commit();
+    remaining = source->size();
+    return remaining;
+}
+
+int BacpacTransfer_initialize(void)
+{
+    return BacpacTransfer_start(&diskSource);
+}
+
+int BacpacTransfer_initializePattern(uint32_t size)
+{
+    if (size == 0) size = BACPAC_PATTERN_DEFAULT_SIZE;
+    patternSize = (size + BACPAC_PATTERN_RECORD_LENGTH - 1) / BACPAC_PATTERN_RECORD_LENGTH * BACPAC_PATTERN_RECORD_LENGTH;
+    patternPos = 0;
+    return BacpacTransfer_start(&patternSource);
+}
+
+int BacpacTransfer_resume(void)
+{
+    // after a reset the disk source starts where the last checkpoint left it
+    if (!source) return BacpacTransfer_initialize();
+
+    source->rollback();
+    chunkSent = 0;
+    finished = 0;
+    remaining = source->size();
+    return remaining;
+}
+
+uint32_t BacpacTransfer_getPosition(void)
+{
+    return source ? source->position() : (uint32_t) da_get_read_pos();
+}
+
+uint8_t BacpacTransfer_success(void)
+{
+    if (!source) return 0;
+
+    Types_FreqHz freq;
+    Timestamp_getFreq(&freq);
+
+    // the first success after initialize only starts the transfer
+    source->commit();
+    if (chunkSent > 0)
+    {
+        stats.chunks++;
+        stats.bytes += chunkSent;
+        stats.elapsedMs = (uint64_t) (Timestamp_get32() - startTime) * 1000 / freq.lo;
+        chunksSinceCheckpoint++;
+    }
+    chunkSent = 0;
+
+    if (!finished)
+    {
+        if (chunksSinceCheckpoint >= BACPAC_TRANSFER_CHECKPOINT_CHUNKS)
+        {
+            source->checkpoint();
+            chunksSinceCheckpoint = 0;
+        }
+        return 0;
+    }
+    source->finish();
+    source = NULL;
+    return 1;
+}
+
+void BacpacTransfer_error(void)
+{
+    if (!source) return;
+
+    source->rollback();
+    stats.retries++;
+    chunkSent = 0;
+    finished = 0;
+    remaining = source->size();
+}
+
+void BacpacTransfer_failure(void)
+{
+    if (source) source->clear();
+    source = NULL;
+    chunkSent = 0;
+    finished = 0;
+    remaining = 0;
+}
+
+int BacpacTransfer_next(char *packet)
+{
+    // the packet is still being read into, even if the transfer was dropped meanwhile
+    if (BacpacTransfer_diskReading()) return BACPAC_TRANSFER_BUSY;
+
+    // a full chunk waits for the central's answer
+    if (!source || chunkSent >= BACPAC_TRANSFER_CHUNK_LENGTH || remaining <= 0) return BACPAC_TRANSFER_IDLE;
+
+    remaining = source->size();
+
+    int length = BACPAC_TRANSFER_PACKET_LENGTH;
+    if (BACPAC_TRANSFER_CHUNK_LENGTH - chunkSent < length) length = BACPAC_TRANSFER_CHUNK_LENGTH - chunkSent;
+    uint8_t last = (remaining <= length);
+    if (last) length = remaining;
+
+    int result = source->read(packet, length);
+    if (result == BACPAC_TRANSFER_BUSY) return result;
+    if (result != length) return BACPAC_TRANSFER_BAD_READ;
+    memset(packet + length, 0, BACPAC_TRANSFER_PACKET_LENGTH - length);
+
+    chunkSent += length;
+    remaining -= length;
+    if (last)
+    {
+        remaining = 0;
+        finished = 1;
+    }
+    return length;
+}
+
+int BacpacTransfer_nextSdu(char *buffer, int maxLength)
+{
+    if (BacpacTransfer_diskReading()) return BACPAC_TRANSFER_BUSY;
+
+    // one SDU is a whole chunk, the next waits for the central's answer
+    if (!source || chunkSent > 0 || remaining <= 0 || maxLength <= 0) return BACPAC_TRANSFER_IDLE;
+
+    remaining = source->size();
+    int length = maxLength;
+    uint8_t last = (remaining <= length);
+    if (last) length = remaining;
+
+    int result = source->read(buffer, length);
+    if (result == BACPAC_TRANSFER_BUSY) return result;
+    if (result != length) return BACPAC_TRANSFER_BAD_READ;
+
+    chunkSent = length;
+    remaining -= length;
+    if (last)
+    {
+        remaining = 0;
+        finished = 1;
+    }
+    return length;
+}
+
+uint8_t BacpacTransfer_poll(void)
+{
+    static const uint8_t types[] = { STORAGE_COMMIT, STORAGE_CHECKPOINT, STORAGE_CLOSE };
+    uint8_t i;
+
+    // the central gave up on these before it asked for anything else
+    for (i = 0; i < DA_CURSORS; i++)
+    {
+        if (!(diskClearsPending & (1 << i))) continue;
+        if (!BacpacTransfer_diskSubmit(STORAGE_CLEAR, i)) return 1;
+        diskClearsPending &= ~(1 << i);
+    }
+    for (i = 0; i < sizeof(types); i++)
+    {
+        if (!(diskRequestsPending & (1 << types[i]))) continue;
+        if (!BacpacTransfer_diskSubmit(types[i], DA_CURSOR_DEFAULT)) return 1;
+        diskRequestsPending &= ~(1 << types[i]);
+    }
+    return 0;
+}
+
+uint8_t BacpacTransfer_reading(void)
+{
+    return BacpacTransfer_diskReading();
+}
+
+void BacpacTransfer_getStats(struct BacpacTransferStats *result)
+{
+    *result = stats;
+}
+
+uint16_t BacpacTransfer_crc16(const uint8_t *data, uint16_t length)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (length--)
+    {
+        crc ^= (uint16_t) *data++ << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void BacpacTransfer_buildRecord(uint8_t *record, uint32_t sequence)
+{
+    memcpy(record, &sequence, sizeof(sequence));
+    for (uint8_t i = sizeof(sequence); i < BACPAC_PATTERN_RECORD_LENGTH - 2; i++)
+    {
+        record[i] = (uint8_t) (sequence * 7 + i);
+    }
+    uint16_t crc = BacpacTransfer_crc16(record, BACPAC_PATTERN_RECORD_LENGTH - 2);
+    memcpy(record + BACPAC_PATTERN_RECORD_LENGTH - 2, &crc, sizeof(crc));
+}
+
+void BacpacTransfer_fillPattern(char *buffer, uint32_t offset, uint16_t length)
+{
+    uint8_t record[BACPAC_PATTERN_RECORD_LENGTH];
+
+    while (length)
+    {
+        uint16_t start = offset % BACPAC_PATTERN_RECORD_LENGTH;
+        uint16_t n = BACPAC_PATTERN_RECORD_LENGTH - start;
+        if (n > length) n = length;
+
+        BacpacTransfer_buildRecord(record, offset / BACPAC_PATTERN_RECORD_LENGTH);
+        memcpy(buffer, record + start, n);
+        buffer += n;
+        offset += n;
+        length -= n;
+    }
+}
+
+uint8_t BacpacTransfer_checkRecord(const uint8_t *record, uint32_t *sequence)
+{
+    uint16_t crc;
+
+    memcpy(&crc, record + BACPAC_PATTERN_RECORD_LENGTH - 2, sizeof(crc));
+    memcpy(sequence, record, sizeof(*sequence));
+    return crc == BacpacTransfer_crc16(record, BACPAC_PATTERN_RECORD_LENGTH - 2);
+}
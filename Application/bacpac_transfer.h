@@ -0,0 +1,145 @@
+/******************************************************************************
+
+ @file  bacpac_transfer.h
+
+ @brief Offload of the recorded data over the BACPAC Channel characteristic.
+
+        The central starts a transfer with the initialize command and gets
+        "size:position" on the Channel characteristic: the number of bytes
+        to expect and the read position they start at, both decimal. Data
+        then goes out BACPAC_TRANSFER_PACKET_LENGTH bytes at a time. After
+        every BACPAC_TRANSFER_CHUNK_LENGTH bytes the peripheral waits for
+        the central to acknowledge the chunk (success) or to ask for it
+        again (error). Failure drops the recorded data the central hasn't
+        read.
+
+        Every BACPAC_TRANSFER_CHECKPOINT_CHUNKS acknowledged chunks the read
+        position is saved on the card. After a disconnect the central sends
+        resume and gets "size:position" again, counted from the last
+        acknowledged chunk, or from the last checkpoint after a reset. The
+        central keeps what it has up to position and drops the rest.
+
+        The byte after initialize and resume names the read cursor of the
+        SD card log (0 unless the central has its own, see DA_CURSORS), so
+        several centrals can offload the same recording independently. A
+        negative size is a DiskAccess error, e.g. DISK_BAD_CURSOR.
+
+        When the central opens an L2CAP connection-oriented channel on
+        BACPAC_TRANSFER_COC_PSM, every chunk goes out as one SDU of up to
+        BACPAC_TRANSFER_SDU_LENGTH bytes instead, acknowledged the same way.
+
+        Instead of the SD card the same path can send a synthetic pattern
+        of 16 byte records, each a uint32 sequence number, 10 pattern bytes
+        and a CRC-16/CCITT of the first 14 bytes, to measure the offload.
+
+ *****************************************************************************/
+
+#ifndef BACPAC_TRANSFER_H
+#define BACPAC_TRANSFER_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define BACPAC_TRANSFER_CHUNK_LENGTH        528
+#define BACPAC_TRANSFER_PACKET_LENGTH       20  // BACPAC_SERVICE_CHANNEL_LEN
+#define BACPAC_TRANSFER_SDU_LENGTH          512 // a sector of the SD card
+#define BACPAC_TRANSFER_COC_PSM             0x0081 // LE dynamic PSM of the offload channel
+
+// Transferring characteristic commands
+#define BACPAC_TRANSFER_CMD_INITIALIZE      0x07
+#define BACPAC_TRANSFER_CMD_SUCCESS         0x08
+#define BACPAC_TRANSFER_CMD_ERROR           0x09
+#define BACPAC_TRANSFER_CMD_FAILURE         0x0a
+#define BACPAC_TRANSFER_CMD_DISK_BENCHMARK  0x0b
+#define BACPAC_TRANSFER_CMD_PATTERN         0x0c  // followed by the uint32 pattern size, 0 for the default
+#define BACPAC_TRANSFER_CMD_RESUME          0x0d
+
+#define BACPAC_TRANSFER_CHECKPOINT_CHUNKS   16  // acknowledged chunks between two index writes
+
+// BacpacTransfer_next results besides the packet length
+#define BACPAC_TRANSFER_IDLE                0   // wait for the central
+#define BACPAC_TRANSFER_BAD_READ            -1  // nothing sent, try again
+#define BACPAC_TRANSFER_BUSY                -2  // the storage task is reading into the buffer, call again with it
+
+#define BACPAC_PATTERN_RECORD_LENGTH        16
+#define BACPAC_PATTERN_DEFAULT_SIZE         (64UL * 1024)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+struct BacpacTransferStats
+{
+    uint32_t bytes;     // acknowledged by the central
+    uint32_t chunks;    // acknowledged by the central
+    uint32_t retries;   // chunks sent again after an error
+    uint32_t elapsedMs; // initialize to the last acknowledged chunk
+};
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+// Start sending the recorded data, returns the number of bytes to send
+extern int BacpacTransfer_initialize(void);
+
+// Start sending size bytes of the synthetic pattern instead, rounded up to whole records
+extern int BacpacTransfer_initializePattern(uint32_t size);
+
+// Continue the transfer from the last acknowledged chunk, or start one from the
+// saved read position if none is running. Returns the number of bytes to send.
+extern int BacpacTransfer_resume(void);
+
+// Read position the bytes still to send start at
+extern uint32_t BacpacTransfer_getPosition(void);
+
+// The central acknowledged the last chunk. Returns 1 once the whole transfer is acknowledged.
+extern uint8_t BacpacTransfer_success(void);
+
+// The central wants the last chunk again
+extern void BacpacTransfer_error(void);
+
+// The central gave up, the recorded data is dropped
+extern void BacpacTransfer_failure(void);
+
+// Fills packet (BACPAC_TRANSFER_PACKET_LENGTH bytes, zero padded) with the next
+// bytes. Returns how many of them are data, BACPAC_TRANSFER_IDLE, BACPAC_TRANSFER_BAD_READ
+// or BACPAC_TRANSFER_BUSY. After BUSY the packet belongs to the storage task until a
+// later call with the same packet returns something else.
+extern int BacpacTransfer_next(char *packet);
+
+// Fills buffer with a whole chunk of at most maxLength bytes to send as one SDU.
+// Returns the length, BACPAC_TRANSFER_IDLE, BACPAC_TRANSFER_BAD_READ or BACPAC_TRANSFER_BUSY.
+extern int BacpacTransfer_nextSdu(char *buffer, int maxLength);
+
+// The storage task is still reading into the buffer of the last BACPAC_TRANSFER_BUSY
+extern uint8_t BacpacTransfer_reading(void);
+
+// Submits the commits, checkpoints and clears the storage queue had no room for.
+// Call it regularly, returns 1 while some are still waiting.
+extern uint8_t BacpacTransfer_poll(void);
+
+extern void BacpacTransfer_getStats(struct BacpacTransferStats *stats);
+
+// Pattern bytes at offset, for the central side to compare against
+extern void BacpacTransfer_fillPattern(char *buffer, uint32_t offset, uint16_t length);
+
+// Returns 1 when the record's CRC matches and sets its sequence number
+extern uint8_t BacpacTransfer_checkRecord(const uint8_t *record, uint32_t *sequence);
+
+extern uint16_t BacpacTransfer_crc16(const uint8_t *data, uint16_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BACPAC_TRANSFER_H */
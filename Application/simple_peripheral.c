@@ -87,6 +87,11 @@
 #include "simple_peripheral.h"
 #include "Sensors/sensors.h"
 #include "Sensors/DiskAccess.h"
+#include "Sensors/Storage.h"
+#include "Sensors/LiveStream.h"
+#include "Sensors/Telemetry.h"
+#include "Sensors/MemoryPlan.h"
+#include "bacpac_transfer.h"
 #include <xdc/runtime/System.h>
 
 /*********************************************************************
@@ -126,6 +131,19 @@
 // Application specific event ID for HCI Connection Event End Events
 #define SBP_HCI_CONN_EVT_END_EVT              0x0001
 
+// Most Live notifications queued per pass of the application loop
+#define SBP_LIVE_NOTI_PER_LOOP                4
+
+// SNV item holding the acquisition config written over the Config characteristic
+#define SNV_ID_CONFIG                         0x8B
+
+// FOURTYEIGHT: SNV item holding the number of the last session, see SimplePeripheral_diskMounted
+#define BUF_LEN 1
+#define SNV_ID_APP 0x8A
+#define UNCORRUPSEC     10000 //sectors before 10000 are subject to corruption
+#define SD_RAW_FACTOR   33
+#define RANGE_FACTOR    33 // This number * 33 is the number of empty sectors between sections of raw data. This number * about 100 to get how many minutes of data you can record successfully.
+
 // Type of Display to open
 #if !defined(Display_DISABLE_ALL)
 #if defined(BOARD_DISPLAY_USE_LCD) && (BOARD_DISPLAY_USE_LCD!=0)
@@ -195,7 +213,22 @@ Semaphore_Struct bacpac_channel_error_mutex_struct;
 Semaphore_Struct bacpac_channel_success_mutex_struct;
 Semaphore_Struct bacpac_channel_initialize_mutex_struct;
 Semaphore_Struct bacpac_channel_failure_mutex_struct;
+Semaphore_Struct bacpac_config_mutex_struct;
+Semaphore_Struct bacpac_diagnostics_mutex_struct;
+Semaphore_Struct bacpac_benchmark_mutex_struct;
+// posted by the storage task when the disk benchmark is done
+static Semaphore_Struct benchmarkDoneStruct;
+static Semaphore_Handle benchmarkDone;
+// FOURTYEIGHT: last session read from SNV, and its size once the card is mounted
+static uint8_t snv_buf[BUF_LEN] = {0};
+static uint32_t flashFactor;
+Semaphore_Struct bacpac_pattern_mutex_struct;
+Semaphore_Struct bacpac_resume_mutex_struct;
 char bleChannelBuf[BACPAC_SERVICE_CHANNEL_LEN];
+// the Channel buffer holds a packet the stack didn't take, it is sent again before the next is read
+static uint8_t channelPacketFilled = FALSE;
+char bleLiveBuf[BACPAC_SERVICE_LIVE_LEN];
+uint8_t bleDiagnosticsBuf[BACPAC_SERVICE_DIAGNOSTICS_LEN];
 
 /*********************************************************************
  * LOCAL VARIABLES
@@ -208,6 +241,18 @@ static ICall_EntityID selfEntity;
 // local events.
 static ICall_SyncHandle syncEvent;
 
+#if defined(BLE_V41_FEATURES) && (BLE_V41_FEATURES & L2CAP_COC_CFG)
+// L2CAP channel the central opened for the offload, L2CAP_CID_NULL if none
+static uint16_t offloadCID = L2CAP_CID_NULL;
+// Largest SDU the central takes, at most BACPAC_TRANSFER_SDU_LENGTH
+static uint16_t offloadSduLength;
+// The stack is still sending the last SDU
+static uint8_t offloadSduPending = FALSE;
+// Stack buffer of the next SDU, kept while the storage task reads into it
+static uint8_t *offloadSduBuffer = NULL;
+static uint16_t offloadSduBufferLength;
+#endif // BLE_V41_FEATURES & L2CAP_COC_CFG
+
 // Clock instances for internal periodic events.
 static Clock_Struct periodicClock;
 
@@ -306,6 +351,24 @@ static uint8_t SimplePeripheral_enqueueMsg(uint8_t event, uint8_t state,
 
 static void SimplePeripheral_connEvtCB(Gap_ConnEventRpt_t *pReport);
 static void SimplePeripheral_processConnEvt(Gap_ConnEventRpt_t *pReport);
+static void SimplePeripheral_sendLiveFrames(void);
+static void SimplePeripheral_loadConfig(void);
+static void SimplePeripheral_loadSession(void);
+static void SimplePeripheral_diskMounted(int status);
+static void SimplePeripheral_applyConfig(void);
+static void SimplePeripheral_readDiagnostics(void);
+static void SimplePeripheral_benchmarkDisk(void);
+static void SimplePeripheral_printBenchmark(void);
+static void SimplePeripheral_announceTransfer(int size);
+static void SimplePeripheral_dropChannelPacket(void);
+static int SimplePeripheral_selectCursor(void);
+static void SimplePeripheral_printTransfer(void);
+#if defined(BLE_V41_FEATURES) && (BLE_V41_FEATURES & L2CAP_COC_CFG)
+static void SimplePeripheral_registerOffloadChannel(void);
+static void SimplePeripheral_processL2CAPSignal(l2capSignalEvent_t *pMsg);
+static uint8_t SimplePeripheral_sendSdu(void);
+static uint8_t SimplePeripheral_releaseSduBuffer(void);
+#endif // BLE_V41_FEATURES & L2CAP_COC_CFG
 
 /*********************************************************************
  * EXTERN FUNCTIONS
@@ -430,6 +493,7 @@ void SimplePeripheral_createTask(void)
     taskParams.priority = SBP_TASK_PRIORITY;
 
     Task_construct(&sbpTask, SimplePeripheral_taskFxn, &taskParams, NULL);
+    telemetry_register_task(Task_handle(&sbpTask), "sbp");
 }
 
 /*********************************************************************
@@ -475,7 +539,10 @@ static void SimplePeripheral_init(void)
   #endif // DEBUG_SW_TRACE
 #endif // USE_FPGA
 
-    Sensors_init();
+    SimplePeripheral_loadConfig();
+    SimplePeripheral_loadSession();
+    Storage_setMountFxn(SimplePeripheral_diskMounted);
+    Sensors_init(); // the storage task mounts the card, advertising doesn't wait for it
 
     Semaphore_Params channelParams;
     Semaphore_Params_init(&channelParams);
@@ -508,6 +575,19 @@ static void SimplePeripheral_init(void)
     bacpac_channel_failure_mutex = Semaphore_handle(
             &bacpac_channel_failure_mutex_struct);
 
+    Semaphore_construct(&bacpac_config_mutex_struct, 0, &channelParams);
+    bacpac_config_mutex = Semaphore_handle(&bacpac_config_mutex_struct);
+    Semaphore_construct(&bacpac_diagnostics_mutex_struct, 0, &channelParams);
+    bacpac_diagnostics_mutex = Semaphore_handle(&bacpac_diagnostics_mutex_struct);
+    Semaphore_construct(&bacpac_benchmark_mutex_struct, 0, &channelParams);
+    bacpac_benchmark_mutex = Semaphore_handle(&bacpac_benchmark_mutex_struct);
+    Semaphore_construct(&benchmarkDoneStruct, 0, &channelParams);
+    benchmarkDone = Semaphore_handle(&benchmarkDoneStruct);
+    Semaphore_construct(&bacpac_pattern_mutex_struct, 0, &channelParams);
+    bacpac_pattern_mutex = Semaphore_handle(&bacpac_pattern_mutex_struct);
+    Semaphore_construct(&bacpac_resume_mutex_struct, 0, &channelParams);
+    bacpac_resume_mutex = Semaphore_handle(&bacpac_resume_mutex_struct);
+
     // Create an RTOS queue for message from profile to be sent to app.
     appMsgQueue = Util_constructQueue(&appMsg);
 
@@ -620,6 +700,11 @@ static void SimplePeripheral_init(void)
     DevInfo_AddService();                        // Device Information Service
     //SimpleProfile_AddService(GATT_ALL_SERVICES); // Simple GATT Profile
     Bacpac_service_AddService(selfEntity);
+    Bacpac_service_SetParameter(BACPAC_SERVICE_CONFIG_ID, BACPAC_SERVICE_CONFIG_LEN,
+                                (void *)Sensors_get_config());
+#if defined(BLE_V41_FEATURES) && (BLE_V41_FEATURES & L2CAP_COC_CFG)
+    SimplePeripheral_registerOffloadChannel();
+#endif // BLE_V41_FEATURES & L2CAP_COC_CFG
 
     // Setup the SimpleProfile Characteristic Values
     // For more information, see the sections in the User's Guide:
@@ -686,7 +771,7 @@ static void SimplePeripheral_init(void)
     Display_print0(dispHandle, 0, 0, "BLE Peripheral\n");
 }
 
-char *outputBuffer;
+char outputBuffer[MEMORY_OUTPUT_BUF_SIZE];
 void printNotification(int pos, char *buffer, int dataLength)
 {
     int outputBufferSize = 0;
@@ -702,6 +787,344 @@ void printNotification(int pos, char *buffer, int dataLength)
 
     print(outputBuffer);
 }
+
+/*********************************************************************
+ * @fn      SimplePeripheral_sendLiveFrames
+ *
+ * @brief   Drain the live stream ring into MTU sized Live notifications.
+ *          Bytes only leave the ring once the stack accepted them, so
+ *          under backpressure the ring fills up and drops its oldest frames.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_sendLiveFrames(void)
+{
+    uint16_t payloadSize = Bacpac_service_GetLivePayloadSize();
+
+    for (uint8_t i = 0; i < SBP_LIVE_NOTI_PER_LOOP && payloadSize > 0; i++)
+    {
+        uint16_t len = livestream_peek(bleLiveBuf, payloadSize);
+        if (len == 0)
+        {
+            break;
+        }
+
+        if (Bacpac_service_NotifyLive((uint8_t*) bleLiveBuf, len) != SUCCESS)
+        {
+            livestream_release();
+            break;
+        }
+        livestream_consume(len);
+    }
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_loadConfig
+ *
+ * @brief   Hand the acquisition config saved in SNV to the sensors before
+ *          they start. Falls back to the defaults when nothing valid is saved.
+ *          A config saved by an older firmware is shorter, it is read by its
+ *          own size, upgraded and saved again.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_loadConfig(void)
+{
+    struct AcquisitionConfig config;
+    uint8_t status = osal_snv_read(SNV_ID_CONFIG, sizeof(config), (uint8_t *)&config);
+    uint8_t version;
+
+    if (status != SUCCESS)
+    {
+        status = osal_snv_read(SNV_ID_CONFIG, CONFIG_V2_SIZE, (uint8_t *)&config);
+    }
+    if (status != SUCCESS)
+    {
+        status = osal_snv_read(SNV_ID_CONFIG, CONFIG_V1_SIZE, (uint8_t *)&config);
+    }
+    version = config.version;
+
+    if (status == SUCCESS && config_upgrade(&config) && Sensors_configure(&config))
+    {
+        if (version != CONFIG_VERSION)
+        {
+            osal_snv_write(SNV_ID_CONFIG, sizeof(config), (uint8_t *)&config);
+        }
+    }
+    else
+    {
+        config_default(&config);
+        Sensors_configure(&config);
+    }
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_loadSession
+ *
+ * @brief   FOURTYEIGHT: read the number of the last session from SNV before
+ *          the card is mounted. SNV is only ever touched from this task.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_loadSession(void)
+{
+    if (!(Sensors_get_config()->flags & CONFIG_FLAG_FOURTYEIGHT)) return;
+
+    if (osal_snv_read(SNV_ID_APP, BUF_LEN, (uint8_t *)snv_buf) != SUCCESS)
+    {
+        //Write first time to initialize SN V ID if the first read doesn't register
+        osal_snv_write(SNV_ID_APP, BUF_LEN, (uint8_t *)snv_buf);
+    }
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_diskMounted
+ *
+ * @brief   FOURTYEIGHT: start the next session on the card. Runs in the
+ *          storage task right after the mount, before the frames that
+ *          waited for the card are written. On an export card the session
+ *          goes into the file after the last one, or into SESS000.BIN on a
+ *          volume that was never committed to, and is committed right away
+ *          so the next boot knows the volume is in use.
+ *
+ * @param   status - DISK_ status of da_load.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_diskMounted(int status)
+{
+    uint32_t flash_posit;
+
+    if (status != DISK_SUCCESS || !(Sensors_get_config()->flags & CONFIG_FLAG_FOURTYEIGHT)) return;
+
+    // on an export card every session gets a file of its own, FAT_EXPORT_FILE_SECTORS is the same size
+    flashFactor = da_get_export_files() ? da_get_export_file_size() : SD_RAW_FACTOR * da_get_sector_size() * RANGE_FACTOR;
+    //IMPORTANT! If you want to check if 48 hr collection is working for smaller run times. You need to change flashFactor to 512. OTherwise your data will skip 1000 sectors between turning on/off.
+    flash_posit = snv_buf[0] * flashFactor;
+    if (da_get_export_files()) {
+        // the cursors that are done skip the unwritten rest of the last file too
+        da_start_at(da_get_generation() ? flash_posit + flashFactor : 0);
+        da_commit();
+    }
+    else if (snv_buf[0] > 0) {
+        da_set_write_pos(flash_posit + flashFactor);
+    }
+    else da_set_write_pos(flash_posit+(UNCORRUPSEC*da_get_sector_size()));
+    //change to 512000 for collecting data
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_applyConfig
+ *
+ * @brief   Apply a config written to the Config characteristic and save it
+ *          in SNV. The characteristic is set back to the running config, so
+ *          a rejected write reads back unchanged.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_applyConfig(void)
+{
+    struct AcquisitionConfig config;
+    uint16_t len;
+
+    Bacpac_service_GetParameter(BACPAC_SERVICE_CONFIG_ID, &len, &config);
+    if (Sensors_configure(&config))
+    {
+        osal_snv_write(SNV_ID_CONFIG, sizeof(config), (uint8_t *)&config);
+        System_sprintf(outputBuffer, "config applied: %u Hz, %u slots\n\0",
+                       config.muxFreq, config.numSlots);
+    }
+    else
+    {
+        System_sprintf(outputBuffer, "config rejected\n\0");
+    }
+    print(outputBuffer);
+
+    Bacpac_service_SetParameter(BACPAC_SERVICE_CONFIG_ID, BACPAC_SERVICE_CONFIG_LEN,
+                                (void *)Sensors_get_config());
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_readDiagnostics
+ *
+ * @brief   Fill the Diagnostics characteristic with the page the client
+ *          asked for. The value starts with the page number so a client
+ *          reading too early can tell it got the request back. Asking for
+ *          the profiler, stats or telemetry page also prints it over UART.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_readDiagnostics(void)
+{
+    uint16_t len;
+
+    Bacpac_service_GetParameter(BACPAC_SERVICE_DIAGNOSTICS_ID, &len, bleDiagnosticsBuf);
+    len = diagnostics_read_page(bleDiagnosticsBuf[0], bleDiagnosticsBuf + 1,
+                                BACPAC_SERVICE_DIAGNOSTICS_LEN - 1);
+    Bacpac_service_SetParameter(BACPAC_SERVICE_DIAGNOSTICS_ID, len + 1, bleDiagnosticsBuf);
+
+    if (bleDiagnosticsBuf[0] == DIAGNOSTICS_PAGE_PROFILER)
+    {
+        Sensors_print_profile();
+    }
+    else if (bleDiagnosticsBuf[0] == DIAGNOSTICS_PAGE_STATS)
+    {
+        Sensors_print_stats();
+    }
+    else if (bleDiagnosticsBuf[0] == DIAGNOSTICS_PAGE_TELEMETRY)
+    {
+        Sensors_print_telemetry();
+    }
+    else if (bleDiagnosticsBuf[0] == DIAGNOSTICS_PAGE_POWER)
+    {
+        Sensors_print_power();
+    }
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_benchmarkDisk
+ *
+ * @brief   Have the storage task measure the SD card over the sectors
+ *          DiskAccess keeps for it. The results stay readable on the disk
+ *          benchmark page of the Diagnostics characteristic. Refused while
+ *          recording.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_benchmarkDisk(void)
+{
+    struct StorageRequest request = { STORAGE_BENCHMARK, DA_CURSOR_DEFAULT, 0, 0, NULL, NULL, benchmarkDone };
+
+    int status = Storage_submit(&request);
+    if (status != DISK_SUCCESS)
+    {
+        DA_get_status(status, "Disk benchmark");
+    }
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_printBenchmark
+ *
+ * @brief   Print the results of the disk benchmark the storage task just
+ *          finished.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_printBenchmark(void)
+{
+    struct DiskBenchmark result;
+
+    da_get_benchmark(&result);
+    DA_get_status(result.status, "Disk benchmark");
+    if (result.status != DISK_SUCCESS)
+    {
+        return;
+    }
+
+    System_sprintf(outputBuffer, "write %u B/s, %u B/s x%u, read %u B/s\n\0",
+                   result.singleWriteBps, result.multiWriteBps,
+                   DA_BENCH_BLOCK_SECTORS, result.readBps);
+    print(outputBuffer);
+    System_sprintf(outputBuffer, "write latency mean %u us, max %u us\n\0",
+                   result.meanWriteUs, result.maxWriteUs);
+    print(outputBuffer);
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_selectCursor
+ *
+ * @brief   Read the SD card through the cursor named by the byte after the
+ *          initialize or resume command, so every central drains the log
+ *          at its own pace. What a transfer on the last cursor sent after
+ *          its last acknowledged chunk is sent again next time.
+ *
+ * @param   None.
+ *
+ * @return  DISK_SUCCESS, DISK_BAD_CURSOR, or DISK_NOT_MOUNTED until
+ *          the storage task has mounted the card.
+ */
+static int SimplePeripheral_selectCursor(void)
+{
+    uint8_t command[BACPAC_SERVICE_TRANSFERRING_LEN];
+    uint16_t len;
+
+    if (Storage_getMountStatus() == STORAGE_PENDING) return DISK_NOT_MOUNTED;
+    Bacpac_service_GetParameter(BACPAC_SERVICE_TRANSFERRING_ID, &len, command);
+    return da_set_cursor(command[1]);
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_announceTransfer
+ *
+ * @brief   Tell the central how many bytes the transfer it started has
+ *          and the read position they start at, as "size:position" on the
+ *          Channel characteristic.
+ *
+ * @param   size - bytes to send.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_announceTransfer(int size)
+{
+    memset(bleChannelBuf, 0, BACPAC_SERVICE_CHANNEL_LEN);
+    System_sprintf(bleChannelBuf, "%d:%u", size, BacpacTransfer_getPosition());
+    Bacpac_service_SetParameter(BACPAC_SERVICE_CHANNEL_ID,
+                                BACPAC_SERVICE_CHANNEL_LEN,
+                                bleChannelBuf);
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_dropChannelPacket
+ *
+ * @brief   Give back a Channel packet the stack didn't take, its bytes
+ *          belong to a chunk the transfer is about to read again.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_dropChannelPacket(void)
+{
+    if (channelPacketFilled)
+    {
+        Bacpac_service_FreeChannel();
+        channelPacketFilled = FALSE;
+    }
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_printTransfer
+ *
+ * @brief   Print the throughput of the transfer the central just finished.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_printTransfer(void)
+{
+    struct BacpacTransferStats stats;
+
+    BacpacTransfer_getStats(&stats);
+    System_sprintf(outputBuffer, "transfer %u B in %u ms, %u chunks, %u retries\n\0",
+                   stats.bytes, stats.elapsedMs, stats.chunks, stats.retries);
+    print(outputBuffer);
+}
+
 /*********************************************************************
  * @fn      SimplePeripheral_taskFxn
  *
@@ -720,80 +1143,83 @@ static void SimplePeripheral_taskFxn(UArg a0, UArg a1)
     const int MIN_HEAP_FREE = 512;
     const int LONG_SLEEP_TIME = 7000;
     const int SHORT_SLEEP_TIME = 1200;
-    const int CHUNK_LENGTH = 528;
-    const bool FOURTYEIGHT = true; // adjust to true if running 48 hour code.
-    int chunkSent = 0;
-    short finished = 0;
-    outputBuffer = malloc(sizeof(char) * 64);
     uint32_t flash_posit = 0;
-    #define BUF_LEN 1
-    #define SNV_ID_APP 0x8A
-    const uint16_t UNCORRUPSEC = 10000; //sectors before 10000 are subject to corruption
-    const uint8_t SD_RAW_FACTOR = 33;
-    const uint8_t RANGE_FACTOR = 33; // This number * 33 is the number of empty sectors between sections of raw data. This number * about 100 to get how many minutes of data you can record successfully.
-    const uint32_t FLASH_FACTOR = SD_RAW_FACTOR * da_get_sector_size() * RANGE_FACTOR;
-    //IMPORTANT! If you want to check if 48 hr collection is working for smaller run times. You need to change FLASH_FACTOR to 512. OTherwise your data will skip 1000 sectors between turning on/off.
-//    uint8_t help_multiply[BUF_LEN] = { 1,1,1,1,1,1,1,1,1,1 }; // more accurate fourty eight hour code?
-    static uint8_t snv_buf[BUF_LEN] = {0};
 //    uint8_t trash[BUF_LEN] = { 0,0,0,0,0,0,0,0,0,0 }; // more accurate fourty eight hour code?
     uint8_t status = SUCCESS;
 
-    if (FOURTYEIGHT) {
-//        Read from SNV flash
-            status = osal_snv_read(SNV_ID_APP, BUF_LEN, (uint8_t* )snv_buf);
-            if (status != SUCCESS){
-            //Write first time to initialize SN V ID if the first read doesn't register
-                osal_snv_write(SNV_ID_APP, BUF_LEN, (uint8_t*)snv_buf);
-        }
-                flash_posit = snv_buf[0] * FLASH_FACTOR;
-                if (snv_buf[0] > 0) {
-                    da_set_write_pos(flash_posit + FLASH_FACTOR);
-                }
-                else da_set_write_pos(flash_posit+(UNCORRUPSEC*da_get_sector_size()));
-                //change to 512000 for collecting data
-
-                // more accurate fourty eight hour code?
-//            for (uint8_t flash_iter = 0; flash_iter < BUF_LEN; flash_iter++) {
-//                if (snv_buf[flash_iter] > 0) {
-//                    help_multiply[flash_iter] = snv_buf[flash_iter];
-//                }
-//                flash_pos = flash_pos* help_multiply[flash_iter];
-//                }
-////            }
-//            da_set_write_pos(flash_pos);
-////            Task_sleep(LONG_SLEEP_TIME);
-//        }
-//        if (flash_pos < 100) {
-//            da_set_write_pos(4000);
-//        }
-    }
-
     // Application main loop
 
     for (;;)
     {
         ICall_heapStats_t stats;
         ICall_getHeapStats(&stats);
+        telemetry_heap(stats.totalSize, stats.totalFreeSize, stats.largestFreeSize);
+        telemetry_poll();
         if (stats.totalFreeSize < MIN_HEAP_FREE)
         {
+            pipelineStats.heapSleeps++;
             Task_sleep(LONG_SLEEP_TIME);
             continue;
         }
 
+        SimplePeripheral_sendLiveFrames();
+
+        if (Semaphore_pend(storage_ready, BIOS_NO_WAIT))
+        {
+            DA_get_status(Storage_getMountStatus(), "Loading Disk"); // BLUETOOTH
+        }
+
+        if (Semaphore_pend(bacpac_config_mutex, BIOS_NO_WAIT))
+        {
+            SimplePeripheral_applyConfig();
+        }
+
+        if (Semaphore_pend(bacpac_diagnostics_mutex, BIOS_NO_WAIT))
+        {
+            SimplePeripheral_readDiagnostics();
+        }
+
+        if (Semaphore_pend(bacpac_benchmark_mutex, BIOS_NO_WAIT))
+        {
+            SimplePeripheral_benchmarkDisk();
+        }
+
+        if (Semaphore_pend(benchmarkDone, BIOS_NO_WAIT))
+        {
+            SimplePeripheral_printBenchmark();
+        }
+
+        // commits and clears that found the storage queue full
+        BacpacTransfer_poll();
+
         if (Semaphore_pend(bacpac_channel_initialize_mutex, BIOS_NO_WAIT))
         {
-            System_sprintf(outputBuffer, "initializing-read:%u write:%u\n\0",
-                           da_get_read_pos(), da_get_write_pos());
+            SimplePeripheral_dropChannelPacket();
+            int status = SimplePeripheral_selectCursor();
+            System_sprintf(outputBuffer, "initializing-cursor:%d read:%u write:%u\n\0",
+                           da_get_cursor(), da_get_read_pos(), da_get_write_pos());
+            print(outputBuffer);
+            SimplePeripheral_announceTransfer(status == DISK_SUCCESS ? BacpacTransfer_initialize() : status);
+        }
+
+        if (Semaphore_pend(bacpac_pattern_mutex, BIOS_NO_WAIT))
+        {
+            uint8_t command[BACPAC_SERVICE_TRANSFERRING_LEN];
+            uint16_t len;
+            Bacpac_service_GetParameter(BACPAC_SERVICE_TRANSFERRING_ID, &len, command);
+            uint32_t size = BUILD_UINT32(command[1], command[2], command[3], command[4]);
+            SimplePeripheral_dropChannelPacket();
+            SimplePeripheral_announceTransfer(BacpacTransfer_initializePattern(size));
+        }
+
+        if (Semaphore_pend(bacpac_resume_mutex, BIOS_NO_WAIT))
+        {
+            SimplePeripheral_dropChannelPacket();
+            int status = SimplePeripheral_selectCursor();
+            SimplePeripheral_announceTransfer(status == DISK_SUCCESS ? BacpacTransfer_resume() : status);
+            System_sprintf(outputBuffer, "resuming-cursor:%d read:%u write:%u\n\0",
+                           da_get_cursor(), BacpacTransfer_getPosition(), da_get_write_pos());
             print(outputBuffer);
-            chunkSent = 0;
-            finished = 0;
-            memset(bleChannelBuf, 0, BACPAC_SERVICE_CHANNEL_LEN);
-            remaining_data = da_get_data_size();
-            da_soft_commit();
-            System_sprintf(bleChannelBuf, "%d", remaining_data);
-            Bacpac_service_SetParameter(BACPAC_SERVICE_CHANNEL_ID,
-                                        BACPAC_SERVICE_CHANNEL_LEN,
-                                        bleChannelBuf);
         }
 
         if (Semaphore_pend(bacpac_channel_success_mutex, BIOS_NO_WAIT))
@@ -801,93 +1227,87 @@ static void SimplePeripheral_taskFxn(UArg a0, UArg a1)
             System_sprintf(outputBuffer, "success-read:%u write:%u expected:%u\n\0",
                            da_get_read_pos(), da_get_write_pos(), da_get_data_size());
             print(outputBuffer);
-            char buf[32];
-            int readPos = da_soft_commit();
-            System_sprintf(buf, "soft commit to read pos: %d\n\0", readPos);
-            print(buf);
-            Semaphore_post(bacpac_channel_mutex);
-            if (finished) {
-                da_commit();
-                if (FOURTYEIGHT) da_close();
+            if (BacpacTransfer_success())
+            {
+                SimplePeripheral_printTransfer();
             }
+            Semaphore_post(bacpac_channel_mutex);
         }
 
         if (Semaphore_pend(bacpac_channel_error_mutex, BIOS_NO_WAIT))
         {
-            da_soft_rollback();
+            SimplePeripheral_dropChannelPacket();
+            BacpacTransfer_error();
             System_sprintf(outputBuffer, "error-read:%u write:%u\n\0",
                            da_get_read_pos(), da_get_write_pos());
             print(outputBuffer);
-            finished = 0;
 
             Semaphore_post(bacpac_channel_mutex);
         }
 
         if (Semaphore_pend(bacpac_channel_failure_mutex, BIOS_NO_WAIT))
         {
-            da_clear();
-            chunkSent = 0;
+            SimplePeripheral_dropChannelPacket();
+            BacpacTransfer_failure();
             System_sprintf(outputBuffer, "failure-read:%u write:%u\n\0",
                            da_get_read_pos(), da_get_write_pos());
             print(outputBuffer);
-            finished = 0;
         }
 
         if (Semaphore_pend(bacpac_channel_mutex, BIOS_NO_WAIT))
         {
-            int status = DISK_FAILED_READ;
-            if (chunkSent >= CHUNK_LENGTH)
+#if defined(BLE_V41_FEATURES) && (BLE_V41_FEATURES & L2CAP_COC_CFG)
+            // the offload channel takes the place of Channel notifications while it is open
+            if (offloadCID != L2CAP_CID_NULL)
             {
-                // if we send a full chunk, then don't sem post on bacpac channel mutex
-                // that way we stop sending until we get a success or failure
-                chunkSent = 0;
+                if (SimplePeripheral_sendSdu())
+                {
+                    Semaphore_post(bacpac_channel_mutex);
+                }
+                Task_sleep(SHORT_SLEEP_TIME);
+                continue;
             }
-            else if (remaining_data > 0)
+            SimplePeripheral_releaseSduBuffer();
+#endif // BLE_V41_FEATURES & L2CAP_COC_CFG
+            // after a full chunk the channel mutex isn't posted again,
+            // that way we stop sending until we get a success or error.
+            // The packet is read straight into the notification buffer and
+            // nothing is read while the stack is out of buffers. A packet
+            // the stack didn't take stays in the buffer and goes out again.
+            uint8_t *packet;
+            bStatus_t status = Bacpac_service_AllocChannel(&packet);
+            if (status == bleMemAllocError)
             {
-                remaining_data = da_get_data_size();
-                memset(bleChannelBuf, 0, BACPAC_SERVICE_CHANNEL_LEN);
-                if (CHUNK_LENGTH - chunkSent < BACPAC_SERVICE_CHANNEL_LEN)
+                Semaphore_post(bacpac_channel_mutex);
+            }
+            else if (status == SUCCESS)
+            {
+                int length = channelPacketFilled ? BACPAC_TRANSFER_PACKET_LENGTH
+                                                 : BacpacTransfer_next((char *)packet);
+                if (length == BACPAC_TRANSFER_BUSY)
                 {
-                    int partialLength = CHUNK_LENGTH - chunkSent;
-                    status = da_read(bleChannelBuf, partialLength);
-                    if (status == DISK_SUCCESS) {
-                        //printNotification(chunkSent, bleChannelBuf, partialLength);
-                        chunkSent += partialLength;
-                    }
+                    // the storage task is reading into it, the buffer is kept for the next pass
+                    Semaphore_post(bacpac_channel_mutex);
                 }
-                else if (remaining_data > BACPAC_SERVICE_CHANNEL_LEN)
+                else if (length > 0)
                 {
-                    remaining_data -= BACPAC_SERVICE_CHANNEL_LEN;
-                    status = da_read(bleChannelBuf, BACPAC_SERVICE_CHANNEL_LEN);
-                    if (status == DISK_SUCCESS) {
-                        //printNotification(chunkSent, bleChannelBuf, BACPAC_SERVICE_CHANNEL_LEN);
-                        chunkSent += BACPAC_SERVICE_CHANNEL_LEN;
-                    }
+                    status = Bacpac_service_NotifyChannel();
+                    channelPacketFilled = (status != SUCCESS && status != bleNotConnected);
+                    Semaphore_post(bacpac_channel_mutex);
                 }
                 else
                 {
-                    status = da_read(bleChannelBuf, remaining_data);
-                    if (status == DISK_SUCCESS) {
-                        remaining_data = 0;
-                        finished = 1;
-
-                        //printNotification(chunkSent, bleChannelBuf, BACPAC_SERVICE_CHANNEL_LEN);
-                        chunkSent += BACPAC_SERVICE_CHANNEL_LEN;
-                    }
-                }
-
-                if (status == DISK_SUCCESS) {
-                    Bacpac_service_SetParameter(BACPAC_SERVICE_CHANNEL_ID,
-                                            BACPAC_SERVICE_CHANNEL_LEN,
-                                            bleChannelBuf);
+                    Bacpac_service_FreeChannel();
                 }
-                else {
+                if (length == BACPAC_TRANSFER_BAD_READ)
+                {
+                    pipelineStats.bleBadReads++;
                     System_sprintf(outputBuffer, "Not sending bad read\n\0");
                     print(outputBuffer);
+                    Semaphore_post(bacpac_channel_mutex);
                 }
-                
-                Semaphore_post(bacpac_channel_mutex);
             }
+            // bleNotConnected: nobody listens, wait for the central's next command
 
             Task_sleep(SHORT_SLEEP_TIME);
             continue;
@@ -950,10 +1370,11 @@ static void SimplePeripheral_taskFxn(UArg a0, UArg a1)
         }
         Task_sleep(SHORT_SLEEP_TIME);
         // FOURTY EIGHT HOUR CODE
-        if (FOURTYEIGHT) {
+        // set once the storage task has mounted the card
+        if ((Sensors_get_config()->flags & CONFIG_FLAG_FOURTYEIGHT) && flashFactor) {
             flash_posit = da_get_write_pos();
 
-            snv_buf[0] = flash_posit/FLASH_FACTOR;
+            snv_buf[0] = flash_posit/flashFactor;
 
             // CHANGE TO 512000 for testing
             status = osal_snv_write(SNV_ID_APP, BUF_LEN, (uint8_t *)snv_buf);
@@ -1061,6 +1482,17 @@ static uint8_t SimplePeripheral_processStackMsg(ICall_Hdr *pMsg)
     }
         break;
 
+#if defined(BLE_V41_FEATURES) && (BLE_V41_FEATURES & L2CAP_COC_CFG)
+    case L2CAP_SIGNAL_EVENT:
+        SimplePeripheral_processL2CAPSignal((l2capSignalEvent_t *) pMsg);
+        break;
+
+    case L2CAP_DATA_EVENT:
+        // the central doesn't send anything on the offload channel
+        BM_free(((l2capDataEvent_t *) pMsg)->pkt.pPayload);
+        break;
+#endif // BLE_V41_FEATURES & L2CAP_COC_CFG
+
     default:
         // do nothing
         break;
@@ -1070,6 +1502,171 @@ static uint8_t SimplePeripheral_processStackMsg(ICall_Hdr *pMsg)
     return (safeToDealloc);
 }
 
+#if defined(BLE_V41_FEATURES) && (BLE_V41_FEATURES & L2CAP_COC_CFG)
+/*********************************************************************
+ * @fn      SimplePeripheral_registerOffloadChannel
+ *
+ * @brief   Accept L2CAP connection-oriented channels on
+ *          BACPAC_TRANSFER_COC_PSM and advertise it in the Version
+ *          characteristic.
+ *
+ * @param   None.
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_registerOffloadChannel(void)
+{
+    l2capPsm_t psm;
+
+    memset(&psm, 0, sizeof(l2capPsm_t));
+    psm.psm = BACPAC_TRANSFER_COC_PSM;
+    psm.mtu = BACPAC_TRANSFER_SDU_LENGTH;
+    psm.initPeerCredits = 0xFFFF; // the central never sends data, give it all the credits
+    psm.peerCreditThreshold = 0;
+    psm.maxNumChannels = MAX_NUM_BLE_CONNS;
+    psm.pfnVerifySecCB = NULL;
+    psm.taskId = ICall_getLocalMsgEntityId(ICALL_SERVICE_CLASS_BLE_MSG, selfEntity);
+
+    if (L2CAP_RegisterPsm(&psm) == SUCCESS)
+    {
+        Bacpac_service_SetCapabilities(BACPAC_SERVICE_CAP_L2CAP_COC, BACPAC_TRANSFER_COC_PSM);
+    }
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_processL2CAPSignal
+ *
+ * @brief   Track the offload channel the central opens and closes.
+ *
+ * @param   pMsg - L2CAP signal event
+ *
+ * @return  None.
+ */
+static void SimplePeripheral_processL2CAPSignal(l2capSignalEvent_t *pMsg)
+{
+    switch (pMsg->opcode)
+    {
+    case L2CAP_CHANNEL_ESTABLISHED_EVT:
+    {
+        l2capChannelEstEvt_t *pEstEvt = &(pMsg->cmd.channelEstEvt);
+
+        if (pEstEvt->result == L2CAP_CONN_SUCCESS)
+        {
+            offloadCID = pEstEvt->CID;
+            offloadSduLength = MIN(pEstEvt->info.peerMtu, BACPAC_TRANSFER_SDU_LENGTH);
+            offloadSduPending = FALSE;
+        }
+    }
+        break;
+
+    case L2CAP_CHANNEL_TERMINATED_EVT:
+        if (pMsg->cmd.channelTermEvt.CID == offloadCID)
+        {
+            // an unacknowledged chunk is sent again over Channel when the central asks
+            offloadCID = L2CAP_CID_NULL;
+            offloadSduLength = 0;
+            offloadSduPending = FALSE;
+        }
+        break;
+
+    case L2CAP_SEND_SDU_DONE_EVT:
+        offloadSduPending = FALSE;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_sendSdu
+ *
+ * @brief   Send the next chunk as one SDU on the offload channel. The
+ *          chunk is read straight into the stack buffer.
+ *
+ * @param   None.
+ *
+ * @return  TRUE to try again on the next pass, FALSE to wait for the
+ *          central's answer.
+ */
+static uint8_t SimplePeripheral_sendSdu(void)
+{
+    l2capPacket_t pkt;
+
+    if (offloadSduPending || SimplePeripheral_releaseSduBuffer())
+    {
+        return TRUE;
+    }
+
+    if (offloadSduBuffer == NULL)
+    {
+        offloadSduBuffer = L2CAP_bm_alloc(offloadSduLength);
+        offloadSduBufferLength = offloadSduLength;
+        if (offloadSduBuffer == NULL)
+        {
+            return TRUE;
+        }
+    }
+
+    pkt.pPayload = offloadSduBuffer;
+    int length = BacpacTransfer_nextSdu((char *)pkt.pPayload, offloadSduLength);
+    if (length == BACPAC_TRANSFER_BUSY)
+    {
+        return TRUE; // the storage task is reading the chunk into the buffer
+    }
+
+    offloadSduBuffer = NULL;
+    if (length <= 0)
+    {
+        BM_free(pkt.pPayload);
+        if (length == BACPAC_TRANSFER_BAD_READ)
+        {
+            pipelineStats.bleBadReads++;
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    pkt.CID = offloadCID;
+    pkt.len = length;
+    if (L2CAP_SendSDU(&pkt) != SUCCESS)
+    {
+        BM_free(pkt.pPayload);
+        BacpacTransfer_error(); // read the chunk again
+        return TRUE;
+    }
+
+    offloadSduPending = TRUE;
+    return FALSE;
+}
+
+/*********************************************************************
+ * @fn      SimplePeripheral_releaseSduBuffer
+ *
+ * @brief   Give back an SDU buffer of a channel that closed or changed its
+ *          SDU length, once the storage task no longer reads into it.
+ *
+ * @param   None.
+ *
+ * @return  TRUE while such a buffer is still being read into.
+ */
+static uint8_t SimplePeripheral_releaseSduBuffer(void)
+{
+    if (offloadSduBuffer == NULL || offloadSduBufferLength == offloadSduLength)
+    {
+        return FALSE;
+    }
+    if (BacpacTransfer_reading())
+    {
+        return TRUE;
+    }
+
+    BM_free(offloadSduBuffer);
+    offloadSduBuffer = NULL;
+    return FALSE;
+}
+#endif // BLE_V41_FEATURES & L2CAP_COC_CFG
+
 /*********************************************************************
  * @fn      SimplePeripheral_processGATTMsg
  *
@@ -1359,6 +1956,7 @@ static void SimplePeripheral_processStateChangeEvt(gaprole_States_t newState)
 
         Util_stopClock(&periodicClock);
         attRsp_freeAttRsp(bleNotConnected);
+        livestream_enable(FALSE);
 
         // Clear remaining lines
         Display_clearLines(dispHandle, 3, 5);
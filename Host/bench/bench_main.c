@@ -0,0 +1,368 @@
+/*
+ * bench_main.c
+ *
+ * Replays ADC traces through the whole acquisition path of the host build:
+ * DACtimerCallback, p controller, impedanceCalc, averaging, filter, serializer
+ * and the storage task writing to a card image. Prints the timing of every
+ * DACtimerCallback phase, frames/s, bytes written per frame and how the logged
+ * frames compare to a golden file.
+ *
+ * Traces are what CALIBRATE mode prints over UART, one row per round through
+ * the channels: time,tap,adc0,...,adc15. Lines that don't parse are skipped.
+ * The controller picks its own taps during the replay, so every channel gets
+ * a tap response curve averaged from the trace rows, and the row's adc is moved
+ * along that curve to the tap the controller has set.
+ *
+ *   host_bench [options] [trace.csv]
+ *     --synthetic          replay two generated tap sweeps instead of a trace file
+ *     --golden FILE        compare the logged frames to FILE, exit 1 on a mismatch
+ *     --update-golden      write the logged frames to the golden file instead
+ *     --tolerance OHMS     largest difference still accepted (default 0.01)
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "HostDrivers.h"
+#include "sensors.h"
+#include "Storage.h"
+#include "Serializer.h"
+#include "Profiler.h"
+
+#define IMAGE           "bench.img"
+#define IMAGE_SECTORS   16384
+#define NUM_TAPS        256
+#define MAX_ROWS        100000
+#define MAX_LINE        256
+#define ADC_MAX         4095
+
+struct TraceRow {
+    uint8_t tap;
+    uint16_t adc[NUM_SENSORS];
+};
+
+static struct TraceRow *rows;
+static size_t num_rows;
+static float curve[NUM_SENSORS][NUM_TAPS]; // adc by tap for every trace column
+
+static uint8_t column_of_address[16];     // mux address -> trace column (CALIBRATE channel order)
+static uint8_t first_address;             // mux address of the first channel outside of CALIBRATE
+static uint8_t last_address;
+static size_t replay_row;
+
+// sensors.c, not in sensors.h since nothing else on the board needs it
+void muxPinReset(uint8_t muxmod, bool autoCal);
+
+////////////////////////////////// traces //////////////////////////////////
+
+static int trace_parse_line(char *line, struct TraceRow *row) {
+    char *end;
+    strtoul(line, &end, 10); // time stamp
+    if (end == line || *end != ',') return 0;
+
+    line = end + 1;
+    unsigned long tap = strtoul(line, &end, 10);
+    if (end == line || *end != ',' || tap >= NUM_TAPS) return 0;
+    row->tap = tap;
+
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        line = end + 1;
+        unsigned long adc = strtoul(line, &end, 10);
+        if (end == line || adc > ADC_MAX) return 0;
+        if (i < NUM_SENSORS - 1 && *end != ',') return 0;
+        row->adc[i] = adc;
+    }
+    return 1;
+}
+
+static int trace_load(const char *path) {
+    char line[MAX_LINE];
+    FILE *file = fopen(path, "r");
+    if (!file) return 0;
+
+    rows = calloc(MAX_ROWS, sizeof(*rows));
+    while (num_rows < MAX_ROWS && fgets(line, sizeof(line), file)) {
+        if (trace_parse_line(line, &rows[num_rows])) num_rows++;
+    }
+    fclose(file);
+    return num_rows > 0;
+}
+
+// adc = 4095 * R / (R + Z) for a 10k potentiometer against a fixed load per channel, with a little noise
+static void trace_synthesize(void) {
+    uint32_t noise = 12345;
+
+    num_rows = 2 * (254 - 2 + 1);
+    rows = calloc(num_rows, sizeof(*rows));
+    for (size_t r = 0; r < num_rows; r++) {
+        rows[r].tap = 2 + r % (254 - 2 + 1); // same sweep as CALIBRATE
+        for (int c = 0; c < NUM_SENSORS; c++) {
+            float load = 300 + 110 * c;
+            float pot = rows[r].tap * (10000.0f / 256);
+            noise = noise * 1103515245 + 12345;
+            int adc = (int) (ADC_MAX * pot / (pot + load)) + (int) ((noise >> 16) % 11) - 5;
+            rows[r].adc[c] = adc < 0 ? 0 : adc > ADC_MAX ? ADC_MAX : adc;
+        }
+    }
+}
+
+// averages the rows per tap and fills taps the trace never saw by interpolation
+static void trace_build_curves(void) {
+    static uint32_t count[NUM_TAPS];
+
+    for (int c = 0; c < NUM_SENSORS; c++) {
+        memset(count, 0, sizeof(count));
+        memset(curve[c], 0, sizeof(curve[c]));
+        for (size_t r = 0; r < num_rows; r++) {
+            curve[c][rows[r].tap] += rows[r].adc[c];
+            count[rows[r].tap]++;
+        }
+
+        int previous = -1;
+        for (int tap = 0; tap < NUM_TAPS; tap++) {
+            if (!count[tap]) continue;
+            curve[c][tap] /= count[tap];
+            if (previous < 0) {
+                for (int t = 0; t < tap; t++) curve[c][t] = curve[c][tap];
+            }
+            else {
+                for (int t = previous + 1; t < tap; t++) {
+                    curve[c][t] = curve[c][previous] + (curve[c][tap] - curve[c][previous]) * (t - previous) / (tap - previous);
+                }
+            }
+            previous = tap;
+        }
+        for (int t = previous + 1; t < NUM_TAPS; t++) curve[c][t] = curve[c][previous];
+    }
+}
+
+////////////////////////////////// replay //////////////////////////////////
+
+static uint16_t replay_adc(void *arg, uint8_t muxAddress, uint8_t tap) {
+    // a new round starts when the mux comes back to the first channel, stutters read the same channel again
+    if (muxAddress == first_address && last_address != first_address && replay_row < num_rows) replay_row++;
+    last_address = muxAddress;
+
+    const struct TraceRow *row = &rows[replay_row < num_rows ? replay_row : num_rows - 1];
+    uint8_t column = column_of_address[muxAddress & 0x0F];
+    float adc = row->adc[column] + curve[column][tap] - curve[column][row->tap];
+    if (adc < 0) adc = 0;
+    if (adc > ADC_MAX) adc = ADC_MAX;
+    return (uint16_t) (adc + 0.5f);
+}
+
+// the trace columns are in CALIBRATE channel order, which uses other mux addresses than the functional code
+static void replay_map_columns(void) {
+    for (uint8_t i = 0; i < 16; i++) column_of_address[i] = i;
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+        muxPinReset(i, true);
+        column_of_address[host_pin_mux_address() & 0x0F] = i;
+    }
+    muxPinReset(0, false);
+    first_address = host_pin_mux_address();
+    last_address = first_address;
+    replay_row = 0;
+}
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+////////////////////////////////// frames //////////////////////////////////
+
+// reads the logged frames back from the card and writes one csv row per frame: sequence,type,timestamp,values
+static size_t frames_write_csv(FILE *out) {
+    char header[SERIALIZER_HEADER_SIZE];
+    float values[NUM_SENSORS] = { 0 };
+    size_t frames = 0;
+
+    while (da_get_data_size() >= (int) SERIALIZER_HEADER_SIZE) {
+        if (da_read(header, SERIALIZER_HEADER_SIZE) != DISK_SUCCESS) break;
+        uint8_t type = header[0];
+        uint16_t timestamp, sequence;
+        memcpy(&timestamp, header + 1, sizeof(timestamp));
+        memcpy(&sequence, header + 1 + sizeof(timestamp), sizeof(sequence));
+
+        switch (type & SERIALIZER_FRAME_TYPE_MASK) {
+            case SERIALIZER_FRAME_DENSE:
+                if (da_read((char *) values, sizeof(values)) != DISK_SUCCESS) return frames;
+                break;
+            case SERIALIZER_FRAME_SPARSE: {
+                uint16_t mask;
+                if (da_read((char *) &mask, sizeof(mask)) != DISK_SUCCESS) return frames;
+                for (int i = 0; i < NUM_SENSORS; i++) {
+                    if ((mask & (1 << i)) && da_read((char *) &values[i], sizeof(float)) != DISK_SUCCESS) return frames;
+                }
+                break;
+            }
+            case SERIALIZER_FRAME_HEARTBEAT:
+                break;
+            default:
+                return frames; // not a frame, the rest can't be parsed
+        }
+
+        fprintf(out, "%u,%u,%u", sequence, type, timestamp);
+        for (int i = 0; i < NUM_SENSORS; i++) fprintf(out, ",%.2f", values[i]);
+        fprintf(out, "\n");
+        frames++;
+    }
+    return frames;
+}
+
+// compares two frame csv files, returns the number of frames that differ by more than tolerance
+static size_t frames_compare(FILE *actual, FILE *golden, double tolerance, double *maxDelta, size_t *compared) {
+    char a[MAX_LINE * 2], g[MAX_LINE * 2];
+    size_t mismatches = 0;
+
+    *maxDelta = 0;
+    *compared = 0;
+    for (;;) {
+        char *ra = fgets(a, sizeof(a), actual);
+        char *rg = fgets(g, sizeof(g), golden);
+        if (!ra && !rg) break;
+        if (!ra || !rg) {
+            mismatches++; // different number of frames
+            continue;
+        }
+        (*compared)++;
+
+        char *pa = a, *pg = g;
+        int bad = 0;
+        for (int field = 0; field < 3 + NUM_SENSORS; field++) {
+            double va = strtod(pa, &pa);
+            double vg = strtod(pg, &pg);
+            double delta = va > vg ? va - vg : vg - va;
+            if (field < 3 && delta != 0) bad = 1; // sequence, type and timestamp have to match
+            if (field >= 3 && delta > *maxDelta) *maxDelta = delta;
+            if (field >= 3 && delta > tolerance) bad = 1;
+            if (*pa == ',') pa++;
+            if (*pg == ',') pg++;
+        }
+        mismatches += bad;
+    }
+    return mismatches;
+}
+
+////////////////////////////////// main //////////////////////////////////
+
+static const char *const stage_names[PROFILER_NUM_STAGES] = { "tick", "adc read", "impedance", "controller", "output", "i2c" };
+
+int main(int argc, char **argv) {
+    const char *tracePath = NULL;
+    const char *goldenPath = NULL;
+    int synthetic = 0;
+    int updateGolden = 0;
+    double tolerance = 0.01;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--synthetic")) synthetic = 1;
+        else if (!strcmp(argv[i], "--golden") && i + 1 < argc) goldenPath = argv[++i];
+        else if (!strcmp(argv[i], "--update-golden")) updateGolden = 1;
+        else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (argv[i][0] != '-') tracePath = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [--synthetic] [--golden FILE] [--update-golden] [--tolerance OHMS] [trace.csv]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (synthetic) trace_synthesize();
+    else if (!tracePath || !trace_load(tracePath)) {
+        fprintf(stderr, "no trace rows in %s\n", tracePath ? tracePath : "(none given)");
+        return 2;
+    }
+    trace_build_curves();
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, IMAGE_SECTORS);
+    host_uart_set_output(NULL);
+    Storage_createTask();
+    host_rtos_wait_idle();
+
+    // impedance only, time stamps in milliseconds, and nothing starts before the replay is set up
+    struct AcquisitionConfig config;
+    config_default(&config);
+    config.flags &= ~CONFIG_FLAG_FOURTYEIGHT;
+    Sensors_configure(&config);
+    Sensors_init();
+    replay_map_columns();
+    host_adc_set_source(replay_adc, NULL);
+    host_sd_reset_stats();
+
+    uint32_t maxTicks = (uint32_t) num_rows * NUM_SENSORS * 3 * 8; // room for a lot of stutters
+    uint32_t ticks = 0;
+    Sensors_start_timers();
+    double start = now_seconds();
+    while (replay_row < num_rows && ticks < maxTicks) {
+        host_timer_fire(1);
+        host_rtos_wait_idle(); // the storage task keeps up like it does on the board
+        ticks++;
+    }
+    double wall = now_seconds() - start;
+
+    struct PipelineStats stats;
+    struct ProfilerSummary summary;
+    struct HostSdStats sd;
+    Sensors_get_stats(&stats);
+    profiler_get_summary(&summary);
+    Sensors_stop_timers();
+    host_rtos_wait_idle();
+    host_sd_get_stats(&sd);
+
+    uint32_t samples = 0; // channel reads
+    struct ProfilerStage stage;
+    profiler_get_stage(PROFILER_ADC_READ, &stage);
+    samples = stage.count;
+
+    printf("trace:    %zu rows%s, %u ticks, %u samples\n", num_rows, synthetic ? " (synthetic)" : "", summary.ticks, samples);
+    printf("frames:   %u built, %u stored, %u skipped, %.0f frames/s replayed (%.1f frames/s on the board)\n",
+           stats.framesBuilt, stats.framesStored, stats.framesSkipped, wall > 0 ? stats.framesBuilt / wall : 0, stats.deliveredRate / 1000.0);
+    if (stats.framesStored) {
+        printf("storage:  %.1f bytes logged per frame, %.1f bytes written to the card per frame (%u sectors)\n",
+               (double) da_get_write_pos() / stats.framesStored, (double) sd.sectorsWritten * HOST_SD_SECTOR_SIZE / stats.framesStored, sd.sectorsWritten);
+    }
+    printf("%-12s %10s %10s %10s %10s %12s\n", "stage", "count", "min ns", "mean ns", "max ns", "ns/sample");
+    for (uint8_t i = 0; i < PROFILER_NUM_STAGES; i++) {
+        profiler_get_stage(i, &stage);
+        double total = (double) stage.mean * stage.count;
+        printf("%-12s %10u %10.0f %10.0f %10.0f %12.1f\n", stage_names[i], stage.count, stage.min / 0.048, stage.mean / 0.048,
+               stage.max / 0.048, samples ? total / 0.048 / samples : 0);
+    }
+
+    // nothing was read from the card yet, this starts at the first frame of the recording
+    FILE *actual = tmpfile();
+    size_t frames = frames_write_csv(actual);
+    rewind(actual);
+
+    int result = 0;
+    if (goldenPath && updateGolden) {
+        FILE *golden = fopen(goldenPath, "w");
+        if (!golden) {
+            fprintf(stderr, "can't write %s\n", goldenPath);
+            return 2;
+        }
+        int c;
+        while ((c = fgetc(actual)) != EOF) fputc(c, golden);
+        fclose(golden);
+        printf("golden:   wrote %zu frames to %s\n", frames, goldenPath);
+    }
+    else if (goldenPath) {
+        FILE *golden = fopen(goldenPath, "r");
+        if (!golden) {
+            fprintf(stderr, "can't read %s\n", goldenPath);
+            return 2;
+        }
+        double maxDelta;
+        size_t compared;
+        size_t mismatches = frames_compare(actual, golden, tolerance, &maxDelta, &compared);
+        fclose(golden);
+        printf("golden:   %zu frames compared, %zu differ, largest difference %.3f ohms\n", compared, mismatches, maxDelta);
+        result = mismatches ? 1 : 0;
+    }
+    fclose(actual);
+    return result;
+}
@@ -0,0 +1,242 @@
+/*
+ * central_main.c
+ *
+ * Drives the Channel offload protocol of bacpac_transfer.c the way a phone
+ * does, over a simulated connection, and reports the throughput. The pattern
+ * source is used so every record can be checked for its sequence number and
+ * CRC on the central side.
+ *
+ * The peripheral side follows SimplePeripheral_taskFxn: every pass of the
+ * application loop handles the Transferring commands, queues at most one
+ * notification and then sleeps. A packet is only read once the stack has a
+ * buffer for it, like Bacpac_service_AllocChannel. Queued notifications go
+ * out at the next connection events, a few per event. The central answers every chunk with
+ * success (0x08), or error (0x09) when a record doesn't check out, and its
+ * writes reach the peripheral at the next connection event.
+ *
+ *   host_central [options]
+ *     --size BYTES         pattern size (default 65536)
+ *     --interval MS        connection interval (default 30)
+ *     --packets N          notifications sent per connection event (default 4)
+ *     --loop MS            application loop period, SHORT_SLEEP_TIME (default 12)
+ *     --buffers N          notifications the stack can queue (default 8)
+ *     --error-rate P       chance that a notification arrives corrupted (default 0)
+ *     --seed N             seed for the corruption (default 1)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HostDrivers.h"
+#include "bacpac_transfer.h"
+
+#define MAX_BUFFERS     64
+#define TIMEOUT_US      (3600ULL * 1000000)
+
+struct Packet {
+    char data[BACPAC_TRANSFER_PACKET_LENGTH];
+    uint8_t announce;   // the "size:position" string sent after the pattern command
+};
+
+static struct Packet queue[MAX_BUFFERS];
+static int queueHead;
+static int queueCount;
+static int queueSize = 8;
+static uint32_t lost;
+static uint32_t bufferWaits; // loop passes that found no stack buffer for the next packet
+
+static uint8_t command;     // written by the central, read by the next loop pass
+static uint8_t commandPending;
+static uint8_t channelPosted;
+
+static void notify(const char *data, uint8_t announce) {
+    if (queueCount == queueSize) {
+        lost++; // GATT_Notification fails and the application doesn't retry
+        return;
+    }
+    struct Packet *packet = &queue[(queueHead + queueCount++) % MAX_BUFFERS];
+    memcpy(packet->data, data, BACPAC_TRANSFER_PACKET_LENGTH);
+    packet->announce = announce;
+}
+
+// one pass of the application loop, see SimplePeripheral_taskFxn
+static void peripheral_loop(uint32_t patternSize) {
+    char packet[BACPAC_TRANSFER_PACKET_LENGTH];
+
+    if (commandPending) {
+        commandPending = 0;
+        if (command == BACPAC_TRANSFER_CMD_PATTERN) {
+            memset(packet, 0, sizeof(packet));
+            int total = BacpacTransfer_initializePattern(patternSize);
+            snprintf(packet, sizeof(packet), "%d:%u", total, BacpacTransfer_getPosition());
+            notify(packet, 1);
+        }
+        else if (command == BACPAC_TRANSFER_CMD_SUCCESS) {
+            BacpacTransfer_success();
+            channelPosted = 1;
+        }
+        else if (command == BACPAC_TRANSFER_CMD_ERROR) {
+            BacpacTransfer_error();
+            channelPosted = 1;
+        }
+    }
+
+    if (channelPosted && queueCount == queueSize) {
+        bufferWaits++; // GATT_bm_alloc fails, the packet stays unread until the next pass
+    }
+    else if (channelPosted) {
+        int length = BacpacTransfer_next(packet);
+        channelPosted = (length != BACPAC_TRANSFER_IDLE);
+        if (length > 0) notify(packet, 0);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t size = BACPAC_PATTERN_DEFAULT_SIZE;
+    double intervalMs = 30;
+    double loopMs = 12;
+    int packetsPerEvent = 4;
+    double errorRate = 0;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--size") && i + 1 < argc) size = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--interval") && i + 1 < argc) intervalMs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--packets") && i + 1 < argc) packetsPerEvent = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--loop") && i + 1 < argc) loopMs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--buffers") && i + 1 < argc) queueSize = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--error-rate") && i + 1 < argc) errorRate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = strtoul(argv[++i], NULL, 0);
+        else {
+            fprintf(stderr, "usage: %s [--size BYTES] [--interval MS] [--packets N] [--loop MS] "
+                            "[--buffers N] [--error-rate P] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (queueSize < 1 || queueSize > MAX_BUFFERS || packetsPerEvent < 1 || intervalMs <= 0 || loopMs <= 0) {
+        fprintf(stderr, "bad option value\n");
+        return 2;
+    }
+    srand(seed);
+
+    const uint64_t interval = intervalMs * 1000;
+    const uint64_t loop = loopMs * 1000;
+    uint64_t nextEvent = 0;
+    uint64_t nextLoop = loop / 2; // not in step with the connection events
+    uint64_t now = 0;
+
+    // central side
+    static uint8_t chunk[BACPAC_TRANSFER_CHUNK_LENGTH];
+    uint32_t total = 0;
+    uint32_t acked = 0;
+    uint32_t chunkBytes = 0;
+    uint8_t started = 0;
+    uint8_t done = 0;
+    uint8_t write = BACPAC_TRANSFER_CMD_PATTERN; // goes out at the next connection event
+    uint32_t chunks = 0;
+    uint32_t retries = 0;
+    uint32_t badRecords = 0;
+    uint32_t corrupted = 0;
+    uint64_t lastAck = 0;
+    uint64_t sumChunkUs = 0;
+    uint64_t maxChunkUs = 0;
+
+    while (!done && now < TIMEOUT_US) {
+        if (nextLoop <= nextEvent) {
+            now = nextLoop;
+            nextLoop += loop;
+            peripheral_loop(size);
+            continue;
+        }
+
+        // connection event: the central's write, then the queued notifications
+        now = nextEvent;
+        nextEvent += interval;
+        if (write) {
+            command = write;
+            commandPending = 1;
+            write = 0;
+        }
+
+        for (int p = 0; p < packetsPerEvent && queueCount && !write; p++) {
+            struct Packet *packet = &queue[queueHead];
+            queueHead = (queueHead + 1) % MAX_BUFFERS;
+            queueCount--;
+
+            if (packet->announce) {
+                total = strtoul(packet->data, NULL, 10);
+                started = 1;
+                lastAck = now;
+                write = BACPAC_TRANSFER_CMD_SUCCESS; // starts the transfer
+                continue;
+            }
+            if (!started) continue;
+
+            uint32_t chunkLength = total - acked < BACPAC_TRANSFER_CHUNK_LENGTH ? total - acked : BACPAC_TRANSFER_CHUNK_LENGTH;
+            uint32_t length = chunkLength - chunkBytes < BACPAC_TRANSFER_PACKET_LENGTH ? chunkLength - chunkBytes : BACPAC_TRANSFER_PACKET_LENGTH;
+            memcpy(chunk + chunkBytes, packet->data, length);
+            if (errorRate > 0 && rand() < errorRate * RAND_MAX) {
+                chunk[chunkBytes + rand() % length] ^= 0x10;
+                corrupted++;
+            }
+            chunkBytes += length;
+            if (chunkBytes < chunkLength) continue;
+
+            uint8_t ok = 1;
+            for (uint32_t r = 0; r < chunkLength / BACPAC_PATTERN_RECORD_LENGTH; r++) {
+                uint32_t sequence;
+                if (!BacpacTransfer_checkRecord(chunk + r * BACPAC_PATTERN_RECORD_LENGTH, &sequence)
+                        || sequence != acked / BACPAC_PATTERN_RECORD_LENGTH + r) {
+                    badRecords++;
+                    ok = 0;
+                }
+            }
+
+            chunkBytes = 0;
+            if (ok) {
+                acked += chunkLength;
+                chunks++;
+                sumChunkUs += now - lastAck;
+                if (now - lastAck > maxChunkUs) maxChunkUs = now - lastAck;
+                lastAck = now;
+                write = BACPAC_TRANSFER_CMD_SUCCESS;
+                done = (acked == total);
+            }
+            else {
+                retries++;
+                write = BACPAC_TRANSFER_CMD_ERROR;
+            }
+        }
+
+        // a lost notification leaves the chunk short forever, the central times out on it
+        if (started && !write && !queueCount && chunkBytes && now - lastAck > 10 * (interval + loop) * (BACPAC_TRANSFER_CHUNK_LENGTH / BACPAC_TRANSFER_PACKET_LENGTH)) {
+            chunkBytes = 0;
+            retries++;
+            lastAck = now;
+            write = BACPAC_TRANSFER_CMD_ERROR;
+        }
+    }
+
+    // the last success reaches the peripheral at the next connection event
+    command = BACPAC_TRANSFER_CMD_SUCCESS;
+    commandPending = done;
+    peripheral_loop(size);
+
+    struct BacpacTransferStats stats;
+    BacpacTransfer_getStats(&stats);
+    double seconds = now / 1e6;
+
+    printf("interval %.1f ms, %d packets/event, loop %.1f ms, %d buffers, error rate %g\n",
+           intervalMs, packetsPerEvent, loopMs, queueSize, errorRate);
+    printf("%s: %u of %u bytes in %.2f s, %.0f bytes/s\n", done ? "done" : "timed out",
+           acked, total, seconds, seconds > 0 ? acked / seconds : 0);
+    printf("chunks %u, retries %u, corrupted packets %u, bad records %u, lost notifications %u, buffer waits %u\n",
+           chunks, retries, corrupted, badRecords, lost, bufferWaits);
+    printf("chunk latency mean %.1f ms, max %.1f ms\n",
+           chunks ? sumChunkUs / 1e3 / chunks : 0, maxChunkUs / 1e3);
+
+    if (!done || stats.bytes != acked || stats.chunks != chunks || stats.retries != retries) {
+        printf("peripheral counted %u bytes, %u chunks, %u retries\n", stats.bytes, stats.chunks, stats.retries);
+        return 1;
+    }
+    return 0;
+}
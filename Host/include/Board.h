@@ -0,0 +1,23 @@
+/*
+ * Host build shim for the CC2640R2 LaunchPad Board.h.
+ */
+#ifndef HOST_BOARD_H
+#define HOST_BOARD_H
+
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/PIN.h>
+
+#define CC2640R2_LAUNCHXL_GPTIMER0A 0
+
+#define Board_GPIO_LED0     0
+#define Board_GPIO_LED1     1
+#define Board_DIO0          2
+#define Board_GPIO_LED_ON   1
+#define Board_GPIO_LED_OFF  0
+
+#define Board_I2C0          0
+#define Board_UART0         0
+#define Board_SD0           0
+#define Board_NVSINTERNAL   0
+
+#endif
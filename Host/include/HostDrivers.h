@@ -0,0 +1,99 @@
+/*
+ * HostDrivers.h
+ *
+ * Control side of the host build driver shims. Tests and benchmarks use these
+ * to feed the Sensors code and to look at what it did to the hardware.
+ */
+#ifndef HOST_DRIVERS_H
+#define HOST_DRIVERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/////////////////////////////// RTOS ///////////////////////////////
+// blocks until every task is waiting on a semaphore
+void host_rtos_wait_idle(void);
+
+// what Task_stat and Load_getTaskLoad report for the task, Task_getIdleTask() for the idle task
+void host_task_set_stats(void *task, size_t stackUsed, uint32_t threadTime, uint32_t totalTime);
+// moves Clock_getTicks on and runs the Clock functions that come due on the way
+void host_clock_advance(uint32_t ticks);
+
+/////////////////////////////// Power ///////////////////////////////
+// how many times the constraint is set right now
+int host_power_get_constraint(unsigned int constraintId);
+
+/////////////////////////////// SD card ///////////////////////////////
+#define HOST_SD_SECTOR_SIZE 512
+
+// card image used by the next SD_initialize. The file is created (zeroed) when it doesn't exist yet.
+void host_sd_set_image(const char *path, uint32_t numSectors);
+// a missing card fails SD_initialize
+void host_sd_set_present(bool present);
+// the next count sector writes fail
+void host_sd_fail_writes(uint32_t count);
+
+struct HostSdStats {
+    uint32_t sectorsRead;
+    uint32_t sectorsWritten;
+};
+void host_sd_get_stats(struct HostSdStats *stats);
+void host_sd_reset_stats(void);
+
+/////////////////////////////// NVS ///////////////////////////////
+// the NVSINTERNAL region of the CC2640R2 LaunchPad board file, two 4 kB flash sectors
+#define HOST_NVS_SECTOR_SIZE 4096
+#define HOST_NVS_SECTORS     2
+
+// erases the whole region like a freshly programmed board, it is kept across NVS_open otherwise
+void host_nvs_erase(void);
+// sectors erased so far
+uint32_t host_nvs_get_erases(void);
+// the next count writes fail after programming the first half of their bytes
+void host_nvs_fail_writes(uint32_t count);
+
+/////////////////////////////// ADC ///////////////////////////////
+// Returns the conversion for the mux address that is selected (S3..S0 pins)
+// and the last tap written to the potentiometer.
+typedef uint16_t (*HostAdcFxn)(void *arg, uint8_t muxAddress, uint8_t tap);
+void host_adc_set_source(HostAdcFxn fxn, void *arg);
+// plays back samples in order, starting over at the end
+void host_adc_set_trace(const uint16_t *samples, size_t count);
+// the next count conversions report ADC_STATUS_ERROR
+void host_adc_fail_next(uint32_t count);
+uint32_t host_adc_get_conversions(void);
+
+/////////////////////////////// PIN ///////////////////////////////
+uint8_t host_pin_get(uint32_t ioid);
+// S3..S0 of the BACPAC mux (IOID 22, 23, 12, 15)
+uint8_t host_pin_mux_address(void);
+uint32_t host_pin_get_changes(void);
+
+/////////////////////////////// I2C ///////////////////////////////
+#define HOST_I2C_LOG_SIZE   64
+
+struct HostI2cRecord {
+    uint8_t slaveAddress;
+    uint8_t length;
+    uint8_t data[4];
+};
+// records are kept in a ring of HOST_I2C_LOG_SIZE, index 0 is the oldest one still kept
+uint32_t host_i2c_log_count(void);
+const struct HostI2cRecord *host_i2c_log_get(uint32_t index);
+void host_i2c_log_clear(void);
+// last byte written to the potentiometer
+uint8_t host_i2c_get_tap(void);
+
+/////////////////////////////// GPTimer ///////////////////////////////
+// runs the registered callback count times while the timer is started, as if from its interrupt
+void host_timer_fire(uint32_t count);
+bool host_timer_is_running(void);
+uint32_t host_timer_get_load(void);
+
+/////////////////////////////// UART ///////////////////////////////
+// where UART_write output goes, NULL drops it
+void host_uart_set_output(FILE *file);
+
+#endif
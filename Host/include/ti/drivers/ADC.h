@@ -0,0 +1,25 @@
+/*
+ * Host build shim for ti/drivers/ADC.h. Conversions come from the source set
+ * with host_adc_set_source() or host_adc_set_trace() (see HostDrivers.h).
+ */
+#ifndef HOST_ADC_H
+#define HOST_ADC_H
+
+#include <stdint.h>
+
+#define ADC_STATUS_SUCCESS  0
+#define ADC_STATUS_ERROR    (-1)
+
+typedef struct ADC_Config *ADC_Handle;
+
+typedef struct {
+    void *custom;
+    uint8_t isProtected;
+} ADC_Params;
+
+void ADC_init(void);
+void ADC_Params_init(ADC_Params *params);
+ADC_Handle ADC_open(uint_least8_t index, ADC_Params *params);
+int_fast16_t ADC_convert(ADC_Handle handle, uint16_t *value);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HOST_GPIO_H
+#define HOST_GPIO_H
+
+#include <stdint.h>
+
+#define GPIO_CFG_OUT_STD    0x0001
+#define GPIO_CFG_OUT_LOW    0x0000
+#define GPIO_CFG_OUT_HIGH   0x0002
+
+void GPIO_init(void);
+void GPIO_setConfig(uint_least8_t index, uint32_t pinConfig);
+void GPIO_write(uint_least8_t index, unsigned int value);
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Host build shim for ti/drivers/I2C.h. Transfers complete immediately, are
+ * appended to the I2C log and call the transfer callback in callback mode.
+ */
+#ifndef HOST_I2C_H
+#define HOST_I2C_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct I2C_Config *I2C_Handle;
+
+typedef enum { I2C_MODE_BLOCKING, I2C_MODE_CALLBACK } I2C_TransferMode;
+typedef enum { I2C_100kHz, I2C_400kHz } I2C_BitRate;
+
+typedef struct {
+    void *writeBuf;
+    size_t writeCount;
+    void *readBuf;
+    size_t readCount;
+    uint_least8_t slaveAddress;
+    void *arg;
+} I2C_Transaction;
+
+typedef void (*I2C_CallbackFxn)(I2C_Handle handle, I2C_Transaction *transaction, bool transferStatus);
+
+typedef struct {
+    I2C_TransferMode transferMode;
+    I2C_CallbackFxn transferCallbackFxn;
+    I2C_BitRate bitRate;
+} I2C_Params;
+
+void I2C_init(void);
+void I2C_Params_init(I2C_Params *params);
+I2C_Handle I2C_open(uint_least8_t index, I2C_Params *params);
+bool I2C_transfer(I2C_Handle handle, I2C_Transaction *transaction);
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Host build shim for ti/drivers/NVS.h. The region is a RAM array that behaves
+ * like the internal flash: writes only clear bits, erases set a sector to 0xFF.
+ */
+#ifndef HOST_NVS_H
+#define HOST_NVS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NVS_STATUS_SUCCESS  0
+#define NVS_STATUS_ERROR    (-1)
+
+#define NVS_WRITE_ERASE         0x1
+#define NVS_WRITE_PRE_VERIFY    0x2
+#define NVS_WRITE_POST_VERIFY   0x4
+
+typedef struct NVS_Config *NVS_Handle;
+
+typedef struct {
+    void *custom;
+} NVS_Params;
+
+typedef struct {
+    void *regionBase;
+    size_t regionSize;
+    size_t sectorSize;
+} NVS_Attrs;
+
+void NVS_init(void);
+void NVS_Params_init(NVS_Params *params);
+NVS_Handle NVS_open(uint_least8_t index, NVS_Params *params);
+void NVS_close(NVS_Handle handle);
+void NVS_getAttrs(NVS_Handle handle, NVS_Attrs *attrs);
+int_fast16_t NVS_erase(NVS_Handle handle, size_t offset, size_t size);
+int_fast16_t NVS_read(NVS_Handle handle, size_t offset, void *buffer, size_t bufferSize);
+int_fast16_t NVS_write(NVS_Handle handle, size_t offset, void *buffer, size_t bufferSize, uint_fast16_t flags);
+
+#endif
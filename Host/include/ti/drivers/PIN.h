@@ -0,0 +1,37 @@
+/*
+ * Host build shim for ti/drivers/PIN.h. Output values are kept per IOID and
+ * every change is appended to the PIN log (see HostDrivers.h).
+ */
+#ifndef HOST_PIN_H
+#define HOST_PIN_H
+
+#include <stdint.h>
+
+#define IOID_0      0
+#define IOID_12     12
+#define IOID_15     15
+#define IOID_22     22
+#define IOID_23     23
+#define IOID_28     28
+#define PIN_TERMINATE       0xFE
+#define PIN_IOID_MASK       0xFF
+
+#define PIN_GPIO_OUTPUT_EN  0x00800000
+#define PIN_GPIO_HIGH       0x00000100
+#define PIN_GPIO_LOW        0x00000000
+#define PIN_PUSHPULL        0x00000000
+#define PIN_DRVSTR_MAX      0x00000600
+
+typedef uint32_t PIN_Config;
+typedef uint32_t PIN_Id;
+
+typedef struct {
+    const PIN_Config *table;
+} PIN_State;
+
+typedef PIN_State *PIN_Handle;
+
+PIN_Handle PIN_open(PIN_State *state, const PIN_Config pinList[]);
+int PIN_setOutputValue(PIN_Handle handle, PIN_Id pinId, uint32_t val);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_POWER_H
+#define HOST_POWER_H
+
+#include <stdint.h>
+
+int_fast16_t Power_setConstraint(uint_fast16_t constraintId);
+int_fast16_t Power_releaseConstraint(uint_fast16_t constraintId);
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * Host build shim for ti/drivers/SD.h backed by a card image file set with
+ * host_sd_set_image() (see HostDrivers.h).
+ */
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include <stdint.h>
+
+#define SD_STATUS_SUCCESS   0
+#define SD_STATUS_ERROR     (-1)
+
+typedef struct SD_Config *SD_Handle;
+
+typedef struct {
+    void *custom;
+} SD_Params;
+
+void SD_init(void);
+SD_Handle SD_open(uint_least8_t index, SD_Params *params);
+void SD_close(SD_Handle handle);
+int_fast16_t SD_initialize(SD_Handle handle);
+uint_fast32_t SD_getSectorSize(SD_Handle handle);
+uint_fast32_t SD_getNumSectors(SD_Handle handle);
+int_fast16_t SD_read(SD_Handle handle, void *buf, int_fast32_t sector, uint_fast32_t secCount);
+int_fast16_t SD_write(SD_Handle handle, const void *buf, int_fast32_t sector, uint_fast32_t secCount);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HOST_UART_H
+#define HOST_UART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct UART_Config *UART_Handle;
+typedef void (*UART_Callback)(UART_Handle handle, void *buf, size_t count);
+
+typedef enum { UART_MODE_BLOCKING, UART_MODE_CALLBACK } UART_Mode;
+typedef enum { UART_DATA_BINARY, UART_DATA_TEXT } UART_DataMode;
+
+typedef struct {
+    UART_Mode readMode;
+    UART_Mode writeMode;
+    UART_DataMode readDataMode;
+    UART_DataMode writeDataMode;
+    UART_Callback readCallback;
+    UART_Callback writeCallback;
+    uint32_t baudRate;
+} UART_Params;
+
+void UART_init(void);
+void UART_Params_init(UART_Params *params);
+UART_Handle UART_open(uint_least8_t index, UART_Params *params);
+int_fast32_t UART_write(UART_Handle handle, const void *buffer, size_t size);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_I2CCC26XX_H
+#define HOST_I2CCC26XX_H
+
+#include <ti/drivers/I2C.h>
+
+#endif
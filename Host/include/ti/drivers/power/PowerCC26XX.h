@@ -0,0 +1,9 @@
+#ifndef HOST_POWERCC26XX_H
+#define HOST_POWERCC26XX_H
+
+#include <ti/drivers/Power.h>
+
+#define PowerCC26XX_SB_DISALLOW     0
+#define PowerCC26XX_IDLE_PD_DISALLOW 1
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Host build shim for ti/drivers/timer/GPTimerCC26XX.h. The timer never runs
+ * on its own, host_timer_fire() calls the registered callback like the
+ * timeout interrupt would.
+ */
+#ifndef HOST_GPTIMERCC26XX_H
+#define HOST_GPTIMERCC26XX_H
+
+#include <stdint.h>
+
+typedef uint32_t GPTimerCC26XX_Value;
+typedef uint16_t GPTimerCC26XX_IntMask;
+
+typedef enum { GPT_CONFIG_32BIT, GPT_CONFIG_16BIT } GPTimerCC26XX_Width;
+typedef enum { GPT_MODE_ONESHOT_UP, GPT_MODE_PERIODIC_UP } GPTimerCC26XX_Mode;
+typedef enum { GPTimerCC26XX_DEBUG_STALL_OFF, GPTimerCC26XX_DEBUG_STALL_ON } GPTimerCC26XX_DebugMode;
+
+#define GPT_INT_TIMEOUT 0x0001
+
+typedef struct GPTimerCC26XX_Config *GPTimerCC26XX_Handle;
+typedef void (*GPTimerCC26XX_HwiFxn)(GPTimerCC26XX_Handle handle, GPTimerCC26XX_IntMask interruptMask);
+
+typedef struct {
+    GPTimerCC26XX_Width width;
+    GPTimerCC26XX_Mode mode;
+    GPTimerCC26XX_DebugMode debugStallMode;
+} GPTimerCC26XX_Params;
+
+void GPTimerCC26XX_Params_init(GPTimerCC26XX_Params *params);
+GPTimerCC26XX_Handle GPTimerCC26XX_open(unsigned int index, const GPTimerCC26XX_Params *params);
+void GPTimerCC26XX_setLoadValue(GPTimerCC26XX_Handle handle, GPTimerCC26XX_Value loadValue);
+void GPTimerCC26XX_registerInterrupt(GPTimerCC26XX_Handle handle, GPTimerCC26XX_HwiFxn callback, GPTimerCC26XX_IntMask intMask);
+void GPTimerCC26XX_start(GPTimerCC26XX_Handle handle);
+void GPTimerCC26XX_stop(GPTimerCC26XX_Handle handle);
+
+#endif
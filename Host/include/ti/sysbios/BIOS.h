@@ -0,0 +1,9 @@
+#ifndef HOST_BIOS_H
+#define HOST_BIOS_H
+
+#include <xdc/std.h>
+
+#define BIOS_WAIT_FOREVER   (~(UInt32)0)
+#define BIOS_NO_WAIT        ((UInt32)0)
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * Host build shim for ti/sysbios/hal/Hwi.h. Disabling interrupts takes a
+ * recursive lock that the simulated timer interrupt also holds while it runs.
+ */
+#ifndef HOST_HWI_H
+#define HOST_HWI_H
+
+#include <xdc/std.h>
+
+UInt Hwi_disable(void);
+void Hwi_restore(UInt key);
+
+#endif
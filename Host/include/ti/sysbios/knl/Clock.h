@@ -0,0 +1,43 @@
+/*
+ * Host build shim for ti/sysbios/knl/Clock.h. A tick is 10 us like on the
+ * board. Time only moves with host_clock_advance, which also runs the Clock
+ * functions that come due, in the calling thread.
+ */
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <xdc/std.h>
+
+typedef void (*Clock_FuncPtr)(UArg arg);
+
+typedef struct {
+    UInt32 period;
+    Bool startFlag;
+    UArg arg;
+} Clock_Params;
+
+typedef struct Clock_Struct {
+    Clock_FuncPtr fxn;
+    UArg arg;
+    UInt32 timeout;
+    UInt32 period;
+    UInt32 due;
+    Bool active;
+    struct Clock_Struct *next;
+} Clock_Struct;
+
+typedef Clock_Struct *Clock_Handle;
+
+extern const UInt32 Clock_tickPeriod; // microseconds
+
+UInt32 Clock_getTicks(void);
+void Clock_Params_init(Clock_Params *params);
+Clock_Handle Clock_construct(Clock_Struct *clock, Clock_FuncPtr fxn, UInt32 timeout, const Clock_Params *params);
+Clock_Handle Clock_handle(Clock_Struct *clock);
+void Clock_start(Clock_Handle clock);
+void Clock_stop(Clock_Handle clock);
+void Clock_setPeriod(Clock_Handle clock, UInt32 period);
+void Clock_setTimeout(Clock_Handle clock, UInt32 timeout);
+Bool Clock_isActive(Clock_Handle clock);
+
+#endif
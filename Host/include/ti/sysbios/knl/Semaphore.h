@@ -0,0 +1,37 @@
+/*
+ * Host build shim for ti/sysbios/knl/Semaphore.h on top of one pthread mutex
+ * shared by every semaphore, so host_rtos_wait_idle() can tell when all tasks
+ * are blocked.
+ */
+#ifndef HOST_SEMAPHORE_H
+#define HOST_SEMAPHORE_H
+
+#include <xdc/std.h>
+#include <pthread.h>
+
+typedef enum {
+    Semaphore_Mode_COUNTING,
+    Semaphore_Mode_BINARY
+} Semaphore_Mode;
+
+typedef struct {
+    Semaphore_Mode mode;
+} Semaphore_Params;
+
+typedef struct {
+    Int count;
+    Semaphore_Mode mode;
+    Int waiters;
+    pthread_cond_t cond;
+} Semaphore_Struct;
+
+typedef Semaphore_Struct *Semaphore_Handle;
+
+void Semaphore_Params_init(Semaphore_Params *params);
+void Semaphore_construct(Semaphore_Struct *sem, Int count, const Semaphore_Params *params);
+Semaphore_Handle Semaphore_handle(Semaphore_Struct *sem);
+Bool Semaphore_pend(Semaphore_Handle sem, UInt32 timeout);
+void Semaphore_post(Semaphore_Handle sem);
+Int Semaphore_getCount(Semaphore_Handle sem);
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Host build shim for ti/sysbios/knl/Task.h. Every task runs on its own
+ * pthread, priorities are ignored. A Clock tick is 10 us like on the board.
+ */
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include <xdc/std.h>
+#include <pthread.h>
+
+typedef void (*Task_FuncPtr)(UArg arg0, UArg arg1);
+
+typedef struct {
+    UArg arg0;
+    UArg arg1;
+    Int priority;
+    Ptr stack;
+    size_t stackSize;
+} Task_Params;
+
+typedef struct {
+    pthread_t thread;
+    Task_FuncPtr fxn;
+    UArg arg0;
+    UArg arg1;
+    size_t stackSize;
+    size_t stackUsed;   // what Task_stat reports, set with host_task_set_stats
+    UInt32 threadTime;  // what Load_getTaskLoad reports
+    UInt32 totalTime;
+} Task_Struct;
+
+typedef Task_Struct *Task_Handle;
+
+typedef struct {
+    Int priority;
+    Ptr stack;
+    size_t stackSize;
+    size_t used;
+} Task_Stat;
+
+void Task_Params_init(Task_Params *params);
+// returns nothing, like the SYS/BIOS 6 kernel, Task_handle gives the handle
+void Task_construct(Task_Struct *task, Task_FuncPtr fxn, const Task_Params *params, void *eb);
+Task_Handle Task_handle(Task_Struct *task);
+void Task_sleep(UInt32 ticks);
+void Task_stat(Task_Handle task, Task_Stat *stat);
+Task_Handle Task_getIdleTask(void);
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * Host build shim for ti/sysbios/utils/Load.h. The numbers come from
+ * host_task_set_stats.
+ */
+#ifndef HOST_LOAD_H
+#define HOST_LOAD_H
+
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Task.h>
+
+typedef struct {
+    UInt32 threadTime;
+    UInt32 totalTime;
+} Load_Stat;
+
+Bool Load_getTaskLoad(Task_Handle task, Load_Stat *stat);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef HOST_XDC_SYSTEM_H
+#define HOST_XDC_SYSTEM_H
+
+#include <xdc/std.h>
+
+Int System_sprintf(Char *buf, const Char *fmt, ...);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_XDC_TIMESTAMP_H
+#define HOST_XDC_TIMESTAMP_H
+
+#include <xdc/std.h>
+#include <xdc/runtime/Types.h>
+
+UInt32 Timestamp_get32(void);
+void Timestamp_getFreq(Types_FreqHz *freq);
+
+#endif
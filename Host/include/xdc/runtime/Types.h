@@ -0,0 +1,13 @@
+#ifndef HOST_XDC_TYPES_H
+#define HOST_XDC_TYPES_H
+
+#include <xdc/std.h>
+
+typedef uint32_t Bits32;
+
+typedef struct Types_FreqHz {
+    Bits32 hi;
+    Bits32 lo;
+} Types_FreqHz;
+
+#endif
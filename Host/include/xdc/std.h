@@ -0,0 +1,19 @@
+/*
+ * Host build shim for xdc/std.h. Only the types the BACPAC sources use.
+ */
+#ifndef HOST_XDC_STD_H
+#define HOST_XDC_STD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uintptr_t UArg;
+typedef char Char;
+typedef int Int;
+typedef unsigned int UInt;
+typedef uint32_t UInt32;
+typedef bool Bool;
+typedef void *Ptr;
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * HostNVS.c
+ *
+ * NVS driver for the host build, the internal flash region lives in RAM and
+ * survives NVS_close and NVS_open like the flash survives a reset.
+ */
+#include <ti/drivers/NVS.h>
+#include <string.h>
+#include "HostDrivers.h"
+
+struct NVS_Config {
+    uint8_t region[HOST_NVS_SECTORS * HOST_NVS_SECTOR_SIZE];
+    bool erased;
+};
+
+static struct NVS_Config flash;
+static uint32_t erases;
+static uint32_t failing_writes;
+
+void host_nvs_erase(void) {
+    memset(flash.region, 0xFF, sizeof(flash.region));
+    flash.erased = true;
+}
+
+uint32_t host_nvs_get_erases(void) {
+    return erases;
+}
+
+void host_nvs_fail_writes(uint32_t count) {
+    failing_writes = count;
+}
+
+void NVS_init(void) {
+}
+
+void NVS_Params_init(NVS_Params *params) {
+    params->custom = NULL;
+}
+
+NVS_Handle NVS_open(uint_least8_t index, NVS_Params *params) {
+    if (!flash.erased) host_nvs_erase(); // a new board
+    return &flash;
+}
+
+void NVS_close(NVS_Handle handle) {
+}
+
+void NVS_getAttrs(NVS_Handle handle, NVS_Attrs *attrs) {
+    attrs->regionBase = handle->region;
+    attrs->regionSize = sizeof(handle->region);
+    attrs->sectorSize = HOST_NVS_SECTOR_SIZE;
+}
+
+int_fast16_t NVS_erase(NVS_Handle handle, size_t offset, size_t size) {
+    if (offset % HOST_NVS_SECTOR_SIZE || size % HOST_NVS_SECTOR_SIZE || offset + size > sizeof(handle->region)) return NVS_STATUS_ERROR;
+
+    memset(handle->region + offset, 0xFF, size);
+    erases += size / HOST_NVS_SECTOR_SIZE;
+    return NVS_STATUS_SUCCESS;
+}
+
+int_fast16_t NVS_read(NVS_Handle handle, size_t offset, void *buffer, size_t bufferSize) {
+    if (offset + bufferSize > sizeof(handle->region)) return NVS_STATUS_ERROR;
+
+    memcpy(buffer, handle->region + offset, bufferSize);
+    return NVS_STATUS_SUCCESS;
+}
+
+int_fast16_t NVS_write(NVS_Handle handle, size_t offset, void *buffer, size_t bufferSize, uint_fast16_t flags) {
+    const uint8_t *bytes = buffer;
+    size_t i;
+
+    if (offset + bufferSize > sizeof(handle->region) || (flags & NVS_WRITE_ERASE)) return NVS_STATUS_ERROR;
+    if (failing_writes) {
+        failing_writes--;
+        bufferSize = (bufferSize + 1) / 2;
+        for (i = 0; i < bufferSize; i++) handle->region[offset + i] &= bytes[i];
+        return NVS_STATUS_ERROR;
+    }
+
+    // programming only clears bits
+    for (i = 0; i < bufferSize; i++) handle->region[offset + i] &= bytes[i];
+    if ((flags & NVS_WRITE_POST_VERIFY) && memcmp(handle->region + offset, buffer, bufferSize) != 0) return NVS_STATUS_ERROR;
+    return NVS_STATUS_SUCCESS;
+}
@@ -0,0 +1,287 @@
+/*
+ * HostPeripherals.c
+ *
+ * GPIO, PIN, I2C, ADC, UART, GPTimer and Power drivers for the host build.
+ */
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/PIN.h>
+#include <ti/drivers/I2C.h>
+#include <ti/drivers/ADC.h>
+#include <ti/drivers/UART.h>
+#include <ti/drivers/Power.h>
+#include <ti/drivers/timer/GPTimerCC26XX.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <string.h>
+#include "HostDrivers.h"
+
+#define HOST_NUM_IOIDS  32
+#define HOST_POT_ADDRESS        0x2C
+#define HOST_POT_ADDRESS_V131   0x28
+
+/////////////////////////////// GPIO ///////////////////////////////
+void GPIO_init(void) {
+}
+
+void GPIO_setConfig(uint_least8_t index, uint32_t pinConfig) {
+}
+
+void GPIO_write(uint_least8_t index, unsigned int value) {
+}
+
+/////////////////////////////// PIN ///////////////////////////////
+static uint8_t pin_values[HOST_NUM_IOIDS];
+static uint32_t pin_changes;
+
+PIN_Handle PIN_open(PIN_State *state, const PIN_Config pinList[]) {
+    state->table = pinList;
+    for (uint32_t i = 0; (pinList[i] & PIN_IOID_MASK) != PIN_TERMINATE; i++) {
+        uint32_t ioid = pinList[i] & PIN_IOID_MASK;
+        if (ioid < HOST_NUM_IOIDS) pin_values[ioid] = (pinList[i] & PIN_GPIO_HIGH) ? 1 : 0;
+    }
+    return state;
+}
+
+int PIN_setOutputValue(PIN_Handle handle, PIN_Id pinId, uint32_t val) {
+    if (pinId >= HOST_NUM_IOIDS) return -1;
+    if (pin_values[pinId] != (val ? 1 : 0)) pin_changes++;
+    pin_values[pinId] = val ? 1 : 0;
+    return 0;
+}
+
+uint8_t host_pin_get(uint32_t ioid) {
+    return ioid < HOST_NUM_IOIDS ? pin_values[ioid] : 0;
+}
+
+uint8_t host_pin_mux_address(void) {
+    return (pin_values[IOID_22] << 3) | (pin_values[IOID_23] << 2) | (pin_values[IOID_12] << 1) | pin_values[IOID_15];
+}
+
+uint32_t host_pin_get_changes(void) {
+    return pin_changes;
+}
+
+/////////////////////////////// I2C ///////////////////////////////
+struct I2C_Config {
+    I2C_Params params;
+};
+
+static struct I2C_Config i2c;
+static struct HostI2cRecord i2c_log[HOST_I2C_LOG_SIZE];
+static uint32_t i2c_count;
+static uint8_t pot_tap = 125;
+
+void I2C_init(void) {
+}
+
+void I2C_Params_init(I2C_Params *params) {
+    params->transferMode = I2C_MODE_BLOCKING;
+    params->transferCallbackFxn = NULL;
+    params->bitRate = I2C_100kHz;
+}
+
+I2C_Handle I2C_open(uint_least8_t index, I2C_Params *params) {
+    i2c.params = *params;
+    return &i2c;
+}
+
+bool I2C_transfer(I2C_Handle handle, I2C_Transaction *transaction) {
+    struct HostI2cRecord *record = &i2c_log[i2c_count % HOST_I2C_LOG_SIZE];
+    uint8_t *data = (uint8_t *) transaction->writeBuf;
+
+    record->slaveAddress = transaction->slaveAddress;
+    record->length = transaction->writeCount;
+    memset(record->data, 0, sizeof(record->data));
+    memcpy(record->data, data, transaction->writeCount < sizeof(record->data) ? transaction->writeCount : sizeof(record->data));
+    i2c_count++;
+
+    if ((transaction->slaveAddress == HOST_POT_ADDRESS || transaction->slaveAddress == HOST_POT_ADDRESS_V131)
+            && transaction->writeCount >= 2) {
+        pot_tap = data[1];
+    }
+
+    if (handle->params.transferMode == I2C_MODE_CALLBACK && handle->params.transferCallbackFxn) {
+        handle->params.transferCallbackFxn(handle, transaction, true);
+    }
+    return true;
+}
+
+uint32_t host_i2c_log_count(void) {
+    return i2c_count < HOST_I2C_LOG_SIZE ? i2c_count : HOST_I2C_LOG_SIZE;
+}
+
+const struct HostI2cRecord *host_i2c_log_get(uint32_t index) {
+    uint32_t first = i2c_count < HOST_I2C_LOG_SIZE ? 0 : i2c_count - HOST_I2C_LOG_SIZE;
+    return &i2c_log[(first + index) % HOST_I2C_LOG_SIZE];
+}
+
+void host_i2c_log_clear(void) {
+    i2c_count = 0;
+}
+
+uint8_t host_i2c_get_tap(void) {
+    return pot_tap;
+}
+
+/////////////////////////////// ADC ///////////////////////////////
+struct ADC_Config {
+    int unused;
+};
+
+static struct ADC_Config adc_config;
+static HostAdcFxn adc_source;
+static void *adc_source_arg;
+static const uint16_t *adc_trace;
+static size_t adc_trace_length;
+static size_t adc_trace_pos;
+static uint32_t adc_failing;
+static uint32_t adc_conversions;
+
+void host_adc_set_source(HostAdcFxn fxn, void *arg) {
+    adc_source = fxn;
+    adc_source_arg = arg;
+    adc_trace = NULL;
+}
+
+void host_adc_set_trace(const uint16_t *samples, size_t count) {
+    adc_trace = samples;
+    adc_trace_length = count;
+    adc_trace_pos = 0;
+    adc_source = NULL;
+}
+
+void host_adc_fail_next(uint32_t count) {
+    adc_failing = count;
+}
+
+uint32_t host_adc_get_conversions(void) {
+    return adc_conversions;
+}
+
+void ADC_init(void) {
+}
+
+void ADC_Params_init(ADC_Params *params) {
+    params->custom = NULL;
+    params->isProtected = 1;
+}
+
+ADC_Handle ADC_open(uint_least8_t index, ADC_Params *params) {
+    return &adc_config;
+}
+
+int_fast16_t ADC_convert(ADC_Handle handle, uint16_t *value) {
+    adc_conversions++;
+    if (adc_failing) {
+        adc_failing--;
+        return ADC_STATUS_ERROR;
+    }
+
+    if (adc_source) *value = adc_source(adc_source_arg, host_pin_mux_address(), pot_tap);
+    else if (adc_trace && adc_trace_length) {
+        *value = adc_trace[adc_trace_pos];
+        adc_trace_pos = (adc_trace_pos + 1) % adc_trace_length;
+    }
+    else *value = 0;
+    return ADC_STATUS_SUCCESS;
+}
+
+/////////////////////////////// UART ///////////////////////////////
+struct UART_Config {
+    UART_Params params;
+};
+
+static struct UART_Config uart_config;
+static FILE *uart_output;
+
+void host_uart_set_output(FILE *file) {
+    uart_output = file;
+}
+
+void UART_init(void) {
+}
+
+void UART_Params_init(UART_Params *params) {
+    memset(params, 0, sizeof(*params));
+    params->baudRate = 115200;
+}
+
+UART_Handle UART_open(uint_least8_t index, UART_Params *params) {
+    uart_config.params = *params;
+    return &uart_config;
+}
+
+int_fast32_t UART_write(UART_Handle handle, const void *buffer, size_t size) {
+    if (uart_output) fwrite(buffer, 1, size, uart_output);
+    if (handle->params.writeMode == UART_MODE_CALLBACK && handle->params.writeCallback) {
+        handle->params.writeCallback(handle, (void *) buffer, size);
+    }
+    return size;
+}
+
+/////////////////////////////// GPTimer ///////////////////////////////
+struct GPTimerCC26XX_Config {
+    GPTimerCC26XX_HwiFxn callback;
+    GPTimerCC26XX_Value load;
+    bool running;
+};
+
+static struct GPTimerCC26XX_Config gptimer;
+
+void GPTimerCC26XX_Params_init(GPTimerCC26XX_Params *params) {
+    params->width = GPT_CONFIG_16BIT;
+    params->mode = GPT_MODE_PERIODIC_UP;
+    params->debugStallMode = GPTimerCC26XX_DEBUG_STALL_OFF;
+}
+
+GPTimerCC26XX_Handle GPTimerCC26XX_open(unsigned int index, const GPTimerCC26XX_Params *params) {
+    return &gptimer;
+}
+
+void GPTimerCC26XX_setLoadValue(GPTimerCC26XX_Handle handle, GPTimerCC26XX_Value loadValue) {
+    handle->load = loadValue;
+}
+
+void GPTimerCC26XX_registerInterrupt(GPTimerCC26XX_Handle handle, GPTimerCC26XX_HwiFxn callback, GPTimerCC26XX_IntMask intMask) {
+    handle->callback = callback;
+}
+
+void GPTimerCC26XX_start(GPTimerCC26XX_Handle handle) {
+    handle->running = true;
+}
+
+void GPTimerCC26XX_stop(GPTimerCC26XX_Handle handle) {
+    handle->running = false;
+}
+
+void host_timer_fire(uint32_t count) {
+    for (uint32_t i = 0; i < count && gptimer.running; i++) {
+        UInt key = Hwi_disable(); // nothing else runs inside an interrupt
+        if (gptimer.callback) gptimer.callback(&gptimer, GPT_INT_TIMEOUT);
+        Hwi_restore(key);
+    }
+}
+
+bool host_timer_is_running(void) {
+    return gptimer.running;
+}
+
+uint32_t host_timer_get_load(void) {
+    return gptimer.load;
+}
+
+/////////////////////////////// Power ///////////////////////////////
+static int power_constraints[8];
+
+int_fast16_t Power_setConstraint(uint_fast16_t constraintId) {
+    power_constraints[constraintId]++;
+    return 0;
+}
+
+int_fast16_t Power_releaseConstraint(uint_fast16_t constraintId) {
+    power_constraints[constraintId]--;
+    return 0;
+}
+
+int host_power_get_constraint(unsigned int constraintId) {
+    return power_constraints[constraintId];
+}
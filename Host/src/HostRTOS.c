@@ -0,0 +1,289 @@
+/*
+ * HostRTOS.c
+ *
+ * SYS/BIOS Task, Semaphore, Clock, Load and Hwi on pthreads for the host build.
+ */
+#define _GNU_SOURCE
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/utils/Load.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <xdc/runtime/System.h>
+#include <xdc/runtime/Timestamp.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "HostDrivers.h"
+
+#define HOST_TICK_US 10
+
+static pthread_mutex_t rtos_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+static int num_tasks;
+static int blocked_tasks;
+
+static pthread_mutex_t hwi_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static Task_Struct idle_task;
+
+/////////////////////////////// Task ///////////////////////////////
+void Task_Params_init(Task_Params *params) {
+    params->arg0 = 0;
+    params->arg1 = 0;
+    params->priority = 1;
+    params->stack = NULL;
+    params->stackSize = 0;
+}
+
+static void *host_task_entry(void *arg) {
+    Task_Struct *task = (Task_Struct *) arg;
+    task->fxn(task->arg0, task->arg1);
+
+    pthread_mutex_lock(&rtos_lock);
+    num_tasks--;
+    pthread_cond_broadcast(&idle_cond);
+    pthread_mutex_unlock(&rtos_lock);
+    return NULL;
+}
+
+void Task_construct(Task_Struct *task, Task_FuncPtr fxn, const Task_Params *params, void *eb) {
+    task->fxn = fxn;
+    task->arg0 = params->arg0;
+    task->arg1 = params->arg1;
+    task->stackSize = params->stackSize;
+    task->stackUsed = 0;
+    task->threadTime = 0;
+    task->totalTime = 0;
+
+    pthread_mutex_lock(&rtos_lock);
+    num_tasks++;
+    pthread_mutex_unlock(&rtos_lock);
+
+    if (pthread_create(&task->thread, NULL, host_task_entry, task) != 0) {
+        pthread_mutex_lock(&rtos_lock);
+        num_tasks--;
+        pthread_mutex_unlock(&rtos_lock);
+        return;
+    }
+    pthread_detach(task->thread);
+}
+
+Task_Handle Task_handle(Task_Struct *task) {
+    return task;
+}
+
+void Task_sleep(UInt32 ticks) {
+    usleep(ticks * HOST_TICK_US);
+}
+
+void Task_stat(Task_Handle task, Task_Stat *stat) {
+    stat->priority = 1;
+    stat->stack = NULL;
+    stat->stackSize = task->stackSize;
+    stat->used = task->stackUsed;
+}
+
+Task_Handle Task_getIdleTask(void) {
+    return &idle_task;
+}
+
+void host_task_set_stats(void *handle, size_t stackUsed, uint32_t threadTime, uint32_t totalTime) {
+    Task_Handle task = handle;
+    task->stackUsed = stackUsed;
+    task->threadTime = threadTime;
+    task->totalTime = totalTime;
+}
+
+/////////////////////////////// Load ///////////////////////////////
+Bool Load_getTaskLoad(Task_Handle task, Load_Stat *stat) {
+    stat->threadTime = task->threadTime;
+    stat->totalTime = task->totalTime;
+    return true;
+}
+
+/////////////////////////////// Clock ///////////////////////////////
+const UInt32 Clock_tickPeriod = HOST_TICK_US;
+static UInt32 clock_ticks;
+static Clock_Struct *clocks;
+
+UInt32 Clock_getTicks(void) {
+    return clock_ticks;
+}
+
+void Clock_Params_init(Clock_Params *params) {
+    params->period = 0;
+    params->startFlag = false;
+    params->arg = 0;
+}
+
+Clock_Handle Clock_construct(Clock_Struct *clock, Clock_FuncPtr fxn, UInt32 timeout, const Clock_Params *params) {
+    clock->fxn = fxn;
+    clock->arg = params ? params->arg : 0;
+    clock->timeout = timeout;
+    clock->period = params ? params->period : 0;
+    clock->active = false;
+    clock->next = clocks;
+    clocks = clock;
+    if (params && params->startFlag) Clock_start(clock);
+    return clock;
+}
+
+Clock_Handle Clock_handle(Clock_Struct *clock) {
+    return clock;
+}
+
+void Clock_start(Clock_Handle clock) {
+    clock->due = clock_ticks + clock->timeout;
+    clock->active = true;
+}
+
+void Clock_stop(Clock_Handle clock) {
+    clock->active = false;
+}
+
+void Clock_setPeriod(Clock_Handle clock, UInt32 period) {
+    clock->period = period;
+}
+
+void Clock_setTimeout(Clock_Handle clock, UInt32 timeout) {
+    clock->timeout = timeout;
+}
+
+Bool Clock_isActive(Clock_Handle clock) {
+    return clock->active;
+}
+
+void host_clock_advance(uint32_t ticks) {
+    UInt32 end = clock_ticks + ticks;
+
+    for (;;) {
+        Clock_Struct *next = NULL;
+        for (Clock_Struct *clock = clocks; clock; clock = clock->next) {
+            if (clock->active && clock->due - clock_ticks <= end - clock_ticks && (!next || clock->due - clock_ticks < next->due - clock_ticks)) next = clock;
+        }
+        if (!next) break;
+
+        clock_ticks = next->due;
+        if (next->period) next->due += next->period;
+        else next->active = false;
+        next->fxn(next->arg);
+    }
+    clock_ticks = end;
+}
+
+void host_rtos_wait_idle(void) {
+    pthread_mutex_lock(&rtos_lock);
+    while (blocked_tasks < num_tasks) pthread_cond_wait(&idle_cond, &rtos_lock);
+    pthread_mutex_unlock(&rtos_lock);
+}
+
+/////////////////////////////// Semaphore ///////////////////////////////
+void Semaphore_Params_init(Semaphore_Params *params) {
+    params->mode = Semaphore_Mode_COUNTING;
+}
+
+void Semaphore_construct(Semaphore_Struct *sem, Int count, const Semaphore_Params *params) {
+    sem->mode = params ? params->mode : Semaphore_Mode_COUNTING;
+    sem->count = (sem->mode == Semaphore_Mode_BINARY && count > 1) ? 1 : count;
+    sem->waiters = 0;
+    pthread_cond_init(&sem->cond, NULL);
+}
+
+Semaphore_Handle Semaphore_handle(Semaphore_Struct *sem) {
+    return sem;
+}
+
+static void host_timeout_to_abstime(UInt32 timeout, struct timespec *abstime) {
+    clock_gettime(CLOCK_REALTIME, abstime);
+    uint64_t ns = abstime->tv_nsec + (uint64_t) timeout * HOST_TICK_US * 1000;
+    abstime->tv_sec += ns / 1000000000;
+    abstime->tv_nsec = ns % 1000000000;
+}
+
+Bool Semaphore_pend(Semaphore_Handle sem, UInt32 timeout) {
+    struct timespec abstime;
+    Bool taken = false;
+
+    pthread_mutex_lock(&rtos_lock);
+    if (timeout != BIOS_WAIT_FOREVER && timeout != BIOS_NO_WAIT) host_timeout_to_abstime(timeout, &abstime);
+
+    while (sem->count == 0 && timeout != BIOS_NO_WAIT) {
+        // a waiting task counts as blocked until a post hands it the semaphore
+        sem->waiters++;
+        blocked_tasks++;
+        pthread_cond_broadcast(&idle_cond);
+
+        int result = 0;
+        if (timeout == BIOS_WAIT_FOREVER) pthread_cond_wait(&sem->cond, &rtos_lock);
+        else result = pthread_cond_timedwait(&sem->cond, &rtos_lock, &abstime);
+
+        if (result == ETIMEDOUT) {
+            if (sem->waiters > 0) {
+                sem->waiters--;
+                blocked_tasks--;
+            }
+            break;
+        }
+    }
+
+    if (sem->count > 0) {
+        sem->count--;
+        taken = true;
+    }
+    pthread_mutex_unlock(&rtos_lock);
+    return taken;
+}
+
+void Semaphore_post(Semaphore_Handle sem) {
+    pthread_mutex_lock(&rtos_lock);
+    if (sem->mode == Semaphore_Mode_BINARY) sem->count = 1;
+    else sem->count++;
+
+    if (sem->waiters > 0) {
+        sem->waiters--;
+        blocked_tasks--;
+        pthread_cond_signal(&sem->cond);
+    }
+    pthread_mutex_unlock(&rtos_lock);
+}
+
+Int Semaphore_getCount(Semaphore_Handle sem) {
+    pthread_mutex_lock(&rtos_lock);
+    Int count = sem->count;
+    pthread_mutex_unlock(&rtos_lock);
+    return count;
+}
+
+/////////////////////////////// Hwi ///////////////////////////////
+UInt Hwi_disable(void) {
+    pthread_mutex_lock(&hwi_lock);
+    return 0;
+}
+
+void Hwi_restore(UInt key) {
+    pthread_mutex_unlock(&hwi_lock);
+}
+
+/////////////////////////////// xdc runtime ///////////////////////////////
+Int System_sprintf(Char *buf, const Char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    Int length = vsprintf(buf, fmt, args);
+    va_end(args);
+    return length;
+}
+
+UInt32 Timestamp_get32(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UInt32) (now.tv_sec * 48000000ULL + now.tv_nsec * 48ULL / 1000); // 48 MHz like the CPU clock
+}
+
+void Timestamp_getFreq(Types_FreqHz *freq) {
+    freq->hi = 0;
+    freq->lo = 48000000;
+}
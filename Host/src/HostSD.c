@@ -0,0 +1,96 @@
+/*
+ * HostSD.c
+ *
+ * SD driver for the host build, sectors live in a card image file.
+ */
+#define _GNU_SOURCE
+#include <ti/drivers/SD.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "HostDrivers.h"
+
+struct SD_Config {
+    int fd;
+};
+
+static struct SD_Config card = { -1 };
+static char image_path[256] = "host_sd.img";
+static uint32_t image_sectors = 4096;
+static bool present = true;
+static uint32_t failing_writes;
+static struct HostSdStats stats;
+
+void host_sd_set_image(const char *path, uint32_t numSectors) {
+    strncpy(image_path, path, sizeof(image_path) - 1);
+    image_sectors = numSectors;
+}
+
+void host_sd_set_present(bool isPresent) {
+    present = isPresent;
+}
+
+void host_sd_fail_writes(uint32_t count) {
+    failing_writes = count;
+}
+
+void host_sd_get_stats(struct HostSdStats *out) {
+    *out = stats;
+}
+
+void host_sd_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void SD_init(void) {
+}
+
+SD_Handle SD_open(uint_least8_t index, SD_Params *params) {
+    return &card;
+}
+
+void SD_close(SD_Handle handle) {
+    if (handle->fd >= 0) close(handle->fd);
+    handle->fd = -1;
+}
+
+int_fast16_t SD_initialize(SD_Handle handle) {
+    if (!present) return SD_STATUS_ERROR;
+    if (handle->fd >= 0) close(handle->fd);
+
+    handle->fd = open(image_path, O_RDWR | O_CREAT, 0644);
+    if (handle->fd < 0) return SD_STATUS_ERROR;
+    if (ftruncate(handle->fd, (off_t) image_sectors * HOST_SD_SECTOR_SIZE) != 0) return SD_STATUS_ERROR;
+    return SD_STATUS_SUCCESS;
+}
+
+uint_fast32_t SD_getSectorSize(SD_Handle handle) {
+    return HOST_SD_SECTOR_SIZE;
+}
+
+uint_fast32_t SD_getNumSectors(SD_Handle handle) {
+    return image_sectors;
+}
+
+int_fast16_t SD_read(SD_Handle handle, void *buf, int_fast32_t sector, uint_fast32_t secCount) {
+    if (handle->fd < 0 || sector < 0 || sector + secCount > image_sectors) return SD_STATUS_ERROR;
+
+    size_t length = secCount * HOST_SD_SECTOR_SIZE;
+    if (pread(handle->fd, buf, length, (off_t) sector * HOST_SD_SECTOR_SIZE) != (ssize_t) length) return SD_STATUS_ERROR;
+    stats.sectorsRead += secCount;
+    return SD_STATUS_SUCCESS;
+}
+
+int_fast16_t SD_write(SD_Handle handle, const void *buf, int_fast32_t sector, uint_fast32_t secCount) {
+    if (handle->fd < 0 || sector < 0 || sector + secCount > image_sectors) return SD_STATUS_ERROR;
+    if (failing_writes) {
+        failing_writes--;
+        return SD_STATUS_ERROR;
+    }
+
+    size_t length = secCount * HOST_SD_SECTOR_SIZE;
+    if (pwrite(handle->fd, buf, length, (off_t) sector * HOST_SD_SECTOR_SIZE) != (ssize_t) length) return SD_STATUS_ERROR;
+    stats.sectorsWritten += secCount;
+    return SD_STATUS_SUCCESS;
+}
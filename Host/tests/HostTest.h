@@ -0,0 +1,39 @@
+/*
+ * HostTest.h
+ *
+ * Minimal test runner for the host build. A failing CHECK reports the
+ * expression and returns from the test.
+ */
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <math.h>
+#include <stdio.h>
+
+void host_test_fail(const char *file, int line, const char *expr);
+
+#define CHECK(cond) do { if (!(cond)) { host_test_fail(__FILE__, __LINE__, #cond); return; } } while (0)
+#define CHECK_NEAR(a, b, eps) CHECK(fabs((double) (a) - (double) (b)) <= (eps))
+
+typedef void (*HostTestFxn)(void);
+
+struct HostTest {
+    const char *name;
+    HostTestFxn fxn;
+};
+
+// every test file exports a NULL terminated table of its tests
+extern const struct HostTest serializer_tests[];
+extern const struct HostTest filter_tests[];
+extern const struct HostTest scheduler_tests[];
+extern const struct HostTest livestream_tests[];
+extern const struct HostTest blockpool_tests[];
+extern const struct HostTest profiler_tests[];
+extern const struct HostTest telemetry_tests[];
+extern const struct HostTest overflow_tests[];
+extern const struct HostTest diskaccess_tests[];
+extern const struct HostTest fatexport_tests[];
+extern const struct HostTest transfer_tests[];
+extern const struct HostTest sensors_tests[];
+
+#endif
@@ -0,0 +1,31 @@
+#include "HostTest.h"
+#include "BlockPool.h"
+
+static void test_runs(void) {
+    uint8_t before = blockpool_get_free();
+    CHECK(before == BLOCKPOOL_NUM_BLOCKS); // runs before anything loads the disk
+
+    char *one = blockpool_alloc(1);
+    char *two = blockpool_alloc(2);
+    CHECK(one && two);
+    CHECK(((uintptr_t) one & 3) == 0);
+    CHECK(two == one + BLOCKPOOL_BLOCK_SIZE); // runs are consecutive
+    CHECK(blockpool_alloc(1) == NULL);
+    CHECK(blockpool_get_free() == 0);
+
+    // a run of two only fits after the first block once it's back
+    blockpool_free(two);
+    blockpool_free(one);
+    char *pair = blockpool_alloc(2);
+    CHECK(pair == one);
+    blockpool_free(pair);
+
+    CHECK(blockpool_alloc(BLOCKPOOL_NUM_BLOCKS + 1) == NULL);
+    CHECK(blockpool_get_free() == BLOCKPOOL_NUM_BLOCKS);
+    CHECK(blockpool_get_min_free() == 0);
+}
+
+const struct HostTest blockpool_tests[] = {
+    { "blockpool_runs", test_runs },
+    { NULL, NULL }
+};
@@ -0,0 +1,295 @@
+#include <string.h>
+#include <unistd.h>
+#include "HostTest.h"
+#include "HostDrivers.h"
+#include "DiskAccess.h"
+
+#define IMAGE "diskaccess.img"
+
+static void test_write_commit_reload(void) {
+    char data[1000];
+    char back[1000];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_initialize() == DISK_SUCCESS);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_write_pos() == 0);
+
+    for (int i = 0; i < (int) sizeof(data); i++) data[i] = i * 7;
+    CHECK(da_write(data, sizeof(data)) == DISK_SUCCESS);
+    CHECK(da_get_data_size() == sizeof(data));
+    CHECK(da_close() == DISK_SUCCESS);
+
+    // the positions survive in sector 0
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_write_pos() == sizeof(data));
+    CHECK(da_read(back, sizeof(back)) == DISK_SUCCESS);
+    CHECK(memcmp(data, back, sizeof(data)) == 0);
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+#define NUM_SECTORS (256 - 1 - DA_RAW_TAIL_SECTORS) // data ring of a 256 sector image
+#define SUPERBLOCK_B (1 + NUM_SECTORS)
+
+static void read_sector(int number, char *sector) {
+    FILE *image = fopen(IMAGE, "rb");
+    CHECK(image);
+    fseek(image, (long) number * HOST_SD_SECTOR_SIZE, SEEK_SET);
+    CHECK(fread(sector, 1, HOST_SD_SECTOR_SIZE, image) == HOST_SD_SECTOR_SIZE);
+    fclose(image);
+}
+
+static void write_sector(int number, const char *sector) {
+    FILE *image = fopen(IMAGE, "r+b");
+    CHECK(image);
+    fseek(image, (long) number * HOST_SD_SECTOR_SIZE, SEEK_SET);
+    CHECK(fwrite(sector, 1, HOST_SD_SECTOR_SIZE, image) == HOST_SD_SECTOR_SIZE);
+    fclose(image);
+}
+
+static int write_index(char *buffer, int maxLength) {
+    memcpy(buffer, "extra", 6);
+    return 6;
+}
+
+static void test_index_extra_data(void) {
+    char sector[HOST_SD_SECTOR_SIZE];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_load() == DISK_SUCCESS);
+    da_set_index_fxn(write_index);
+    CHECK(da_write("abc", 3) == DISK_SUCCESS);
+    CHECK(da_commit() == DISK_SUCCESS);
+    da_set_index_fxn(NULL);
+
+    struct DaSuperblock superblock;
+    read_sector(SUPERBLOCK_B, sector); // the first superblock goes to copy B
+    memcpy(&superblock, sector, sizeof(superblock));
+    CHECK(superblock.magic == DA_SUPERBLOCK_MAGIC);
+    CHECK(superblock.generation == 1);
+    CHECK(superblock.writePos == 3 && superblock.readPos[DA_CURSOR_DEFAULT] == 0);
+    CHECK(strcmp(sector + DA_INDEX_EXTRA_OFFSET, "extra") == 0);
+
+    CHECK(da_load() == DISK_SUCCESS); // the extra data doesn't confuse the positions
+    CHECK(da_get_write_pos() == 3);
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+static void test_cursors(void) {
+    static char data[NUM_SECTORS * HOST_SD_SECTOR_SIZE];
+    struct DaSuperblock superblock;
+    char sector[HOST_SD_SECTOR_SIZE];
+    char back[600];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_load() == DISK_SUCCESS);
+    for (int i = 0; i < 1000; i++) data[i] = i * 3;
+    CHECK(da_write(data, 1000) == DISK_SUCCESS);
+
+    CHECK(da_set_cursor(DA_CURSORS) == DISK_BAD_CURSOR);
+    CHECK(da_set_cursor(1) == DISK_SUCCESS); // attached at the oldest data still needed
+    CHECK(da_set_cursor(DA_CURSOR_DEFAULT) == DISK_SUCCESS);
+    CHECK(da_read(back, 600) == DISK_SUCCESS);
+    da_soft_commit();
+
+    CHECK(da_set_cursor(1) == DISK_SUCCESS);
+    CHECK(da_get_read_pos() == 0);
+    CHECK(da_read(back, 200) == DISK_SUCCESS);
+    CHECK(memcmp(back, data, 200) == 0);
+    da_soft_commit();
+    CHECK(da_commit() == DISK_SUCCESS);
+
+    read_sector(SUPERBLOCK_B, sector);
+    memcpy(&superblock, sector, sizeof(superblock));
+    CHECK(superblock.attached == 3);
+    CHECK(superblock.writePos == 1000 && superblock.readPos[0] == 600 && superblock.readPos[1] == 200);
+
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_read_pos() == 200);
+    CHECK(da_set_cursor(DA_CURSOR_DEFAULT) == DISK_SUCCESS);
+    CHECK(da_get_data_size() == 400);
+
+    // the default cursor can't write over what cursor 1 hasn't read
+    CHECK(da_write(data, sizeof(data) - 1000 + 200) == DISK_SUCCESS);
+    CHECK(da_write(data, 1) == DISK_FULL);
+
+    // cursor 1 gives up, the log is only held back by the default cursor
+    CHECK(da_set_cursor(1) == DISK_SUCCESS);
+    CHECK(da_clear() == DISK_SUCCESS);
+    CHECK(da_set_cursor(DA_CURSOR_DEFAULT) == DISK_SUCCESS);
+    CHECK(da_write(data, 400) == DISK_SUCCESS);
+    CHECK(da_write(data, 1) == DISK_FULL);
+    CHECK(da_clear() == DISK_SUCCESS); // nobody needs anything anymore
+    CHECK(da_get_write_pos() == 0 && da_get_read_pos() == 0);
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+static void test_start_at(void) {
+    char data[300];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_generation() == 0);
+    memset(data, 3, sizeof(data));
+    CHECK(da_write(data, sizeof(data)) == DISK_SUCCESS);
+    CHECK(da_set_cursor(1) == DISK_SUCCESS);
+    CHECK(da_read(data, 100) == DISK_SUCCESS);
+    da_soft_commit();
+    CHECK(da_set_cursor(DA_CURSOR_DEFAULT) == DISK_SUCCESS);
+    CHECK(da_read(data, sizeof(data)) == DISK_SUCCESS);
+    da_soft_commit();
+
+    // the default cursor read everything and skips the gap, cursor 1 still has to read its data
+    da_start_at(10 * HOST_SD_SECTOR_SIZE);
+    CHECK(da_get_write_pos() == 10 * HOST_SD_SECTOR_SIZE);
+    CHECK(da_get_data_size() == 0);
+    CHECK(da_set_cursor(1) == DISK_SUCCESS);
+    CHECK(da_get_read_pos() == 100);
+    CHECK(da_commit() == DISK_SUCCESS);
+    CHECK(da_get_generation() == 1);
+    CHECK(da_clear_cursor(1) == DISK_SUCCESS);
+    CHECK(da_set_cursor(DA_CURSOR_DEFAULT) == DISK_SUCCESS);
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+static void test_superblock_copies(void) {
+    char sector[HOST_SD_SECTOR_SIZE];
+
+    // a card with the old ASCII index
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_close() == DISK_SUCCESS);
+    memset(sector, 0, sizeof(sector));
+    strcpy(sector, "5000:1200");
+    write_sector(0, sector);
+    write_sector(SUPERBLOCK_B, memset(sector, 0, sizeof(sector)));
+
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_write_pos() == 5000 && da_get_read_pos() == 1200);
+    CHECK(da_commit() == DISK_SUCCESS); // copy B, the old index stays until the next commit
+    da_set_write_pos(6000);
+    CHECK(da_commit() == DISK_SUCCESS); // copy A
+    da_set_write_pos(7000);
+    CHECK(da_commit() == DISK_SUCCESS); // copy B again
+
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_write_pos() == 7000);
+
+    // a torn write of copy B leaves copy A
+    read_sector(SUPERBLOCK_B, sector);
+    sector[20] ^= 1;
+    write_sector(SUPERBLOCK_B, sector);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_write_pos() == 6000 && da_get_read_pos() == 1200);
+
+    // the next write goes over the broken copy
+    da_set_write_pos(8000);
+    CHECK(da_commit() == DISK_SUCCESS);
+    read_sector(SUPERBLOCK_B, sector);
+    struct DaSuperblock superblock;
+    memcpy(&superblock, sector, sizeof(superblock));
+    CHECK(superblock.generation == 3 && superblock.writePos == 8000);
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+static void test_old_index_keeps_ring(void) {
+    char sector[HOST_SD_SECTOR_SIZE];
+    char back[HOST_SD_SECTOR_SIZE];
+
+    // an old card that wrapped around, reading from the last sector of its ring
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_close() == DISK_SUCCESS);
+    write_sector(NUM_SECTORS, memset(sector, 'L', sizeof(sector)));
+    write_sector(1, memset(sector, 'F', sizeof(sector)));
+    write_sector(SUPERBLOCK_B, memset(sector, 0x5A, sizeof(sector))); // what the old benchmark left there
+    memset(sector, 0, sizeof(sector));
+    sprintf(sector, "%d:%d", NUM_SECTORS * HOST_SD_SECTOR_SIZE + 100, (NUM_SECTORS - 1) * HOST_SD_SECTOR_SIZE);
+    write_sector(0, sector);
+
+    // copy B doesn't go over the data, which stays where it was
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_data_size() == HOST_SD_SECTOR_SIZE + 100);
+    CHECK(da_commit() == DISK_SUCCESS);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_read(back, sizeof(back)) == DISK_SUCCESS);
+    CHECK(memcmp(back, memset(sector, 'L', sizeof(sector)), sizeof(back)) == 0);
+    CHECK(da_read(back, 100) == DISK_SUCCESS);
+    CHECK(memcmp(back, memset(sector, 'F', sizeof(sector)), 100) == 0);
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+static void test_benchmark(void) {
+    struct DiskBenchmark result;
+    char data[HOST_SD_SECTOR_SIZE];
+    char sector[HOST_SD_SECTOR_SIZE];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_num_sectors() == NUM_SECTORS);
+    memset(data, 7, sizeof(data));
+    CHECK(da_write(data, sizeof(data)) == DISK_SUCCESS);
+    CHECK(da_commit() == DISK_SUCCESS);
+
+    da_set_locked(1);
+    CHECK(da_benchmark(&result) == DISK_LOCKED);
+    da_set_locked(0);
+
+    CHECK(da_benchmark(&result) == DISK_SUCCESS);
+    CHECK(result.sectors == DA_BENCH_SECTORS);
+    CHECK(result.singleWriteBps > 0 && result.multiWriteBps > 0 && result.readBps > 0);
+    CHECK(result.maxWriteUs >= result.meanWriteUs);
+    uint32_t writes = 0;
+    for (int i = 0; i < DA_BENCH_HIST_BINS; i++) writes += result.latencyHistogram[i];
+    CHECK(writes == DA_BENCH_SECTORS);
+
+    // the logged data is untouched
+    CHECK(da_read(sector, sizeof(sector)) == DISK_SUCCESS);
+    CHECK(memcmp(sector, data, sizeof(data)) == 0);
+
+    host_sd_fail_writes(1);
+    CHECK(da_benchmark(&result) == DISK_FAILED_WRITE);
+    da_get_benchmark(&result);
+    CHECK(result.status == DISK_FAILED_WRITE);
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+static void test_missing_card(void) {
+    host_sd_set_present(false);
+    CHECK(da_load() == DISK_FAILED_INIT);
+    host_sd_set_present(true);
+}
+
+static void test_failed_sector_write(void) {
+    char data[HOST_SD_SECTOR_SIZE];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_load() == DISK_SUCCESS);
+    memset(data, 1, sizeof(data));
+    CHECK(da_write(data, sizeof(data)) == DISK_SUCCESS); // fills the first sector in RAM
+
+    host_sd_fail_writes(1);
+    CHECK(da_write(data, 1) == DISK_FAILED_WRITE); // flushing the full sector fails
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+const struct HostTest diskaccess_tests[] = {
+    { "diskaccess_write_commit_reload", test_write_commit_reload },
+    { "diskaccess_index_extra_data", test_index_extra_data },
+    { "diskaccess_cursors", test_cursors },
+    { "diskaccess_start_at", test_start_at },
+    { "diskaccess_superblock_copies", test_superblock_copies },
+    { "diskaccess_old_index_keeps_ring", test_old_index_keeps_ring },
+    { "diskaccess_benchmark", test_benchmark },
+    { "diskaccess_missing_card", test_missing_card },
+    { "diskaccess_failed_sector_write", test_failed_sector_write },
+    { NULL, NULL }
+};
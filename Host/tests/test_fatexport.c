@@ -0,0 +1,155 @@
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "HostTest.h"
+#include "HostDrivers.h"
+#include "DiskAccess.h"
+#include "FatExport.h"
+
+#define IMAGE "fatexport.img"
+#define IMAGE_SECTORS 80000 // enough clusters for FAT32, not for all the files
+
+static void read_sector(uint32_t number, uint8_t *sector) {
+    FILE *image = fopen(IMAGE, "rb");
+    CHECK(image);
+    fseek(image, (long) number * HOST_SD_SECTOR_SIZE, SEEK_SET);
+    CHECK(fread(sector, 1, HOST_SD_SECTOR_SIZE, image) == HOST_SD_SECTOR_SIZE);
+    fclose(image);
+}
+
+static uint32_t get32(const uint8_t *bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static uint16_t get16(const uint8_t *bytes) {
+    return bytes[0] | bytes[1] << 8;
+}
+
+static void test_plan(void) {
+    struct FatExportVolume volume;
+
+    CHECK(!fat_export_plan(256, FAT_EXPORT_FILE_SECTORS, FAT_EXPORT_FILES, &volume));
+
+    // a small card gets fewer files
+    CHECK(fat_export_plan(IMAGE_SECTORS, FAT_EXPORT_FILE_SECTORS, FAT_EXPORT_FILES, &volume));
+    CHECK(volume.files > 0 && volume.files < FAT_EXPORT_FILES);
+    CHECK(volume.clusterSectors == 1); // 33 * 33 sectors only divide into single sector clusters
+    CHECK(volume.clusters >= FAT_EXPORT_MIN_CLUSTERS);
+    CHECK(volume.partition + volume.sectors <= IMAGE_SECTORS);
+    CHECK(volume.data == volume.partition + FAT_EXPORT_RESERVED + 2 * volume.fatSectors + volume.rootClusters);
+
+    // the biggest clusters that still make FAT32
+    CHECK(fat_export_plan(62333952, 2048, FAT_EXPORT_FILES, &volume)); // 32 GB
+    CHECK(volume.files == FAT_EXPORT_FILES);
+    CHECK(volume.clusterSectors == 8);
+    CHECK(volume.clusters == 65536 + volume.rootClusters);
+}
+
+static void test_format(void) {
+    struct FatExportVolume volume;
+    uint8_t sector[HOST_SD_SECTOR_SIZE];
+    char data[1000];
+    char back[sizeof(data)];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, IMAGE_SECTORS);
+    CHECK(fat_export_plan(IMAGE_SECTORS, FAT_EXPORT_FILE_SECTORS, FAT_EXPORT_FILES, &volume));
+    da_set_export(FAT_EXPORT_FILE_SECTORS, FAT_EXPORT_FILES);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK((uint32_t) da_get_export_files() == volume.files);
+    CHECK(da_get_export_file_size() == FAT_EXPORT_FILE_SECTORS * HOST_SD_SECTOR_SIZE);
+    CHECK(da_get_num_sectors() == volume.files * FAT_EXPORT_FILE_SECTORS);
+    CHECK(da_get_write_pos() == 0);
+    CHECK(da_get_generation() == 0); // the first session goes into SESS000.BIN
+
+    // one FAT32 partition
+    read_sector(0, sector);
+    CHECK(sector[510] == 0x55 && sector[511] == 0xAA);
+    CHECK(sector[446 + 4] == 0x0C);
+    CHECK(get32(sector + 446 + 8) == FAT_EXPORT_PARTITION && get32(sector + 446 + 12) == volume.sectors);
+
+    read_sector(FAT_EXPORT_PARTITION, sector);
+    CHECK(get16(sector + 11) == HOST_SD_SECTOR_SIZE && sector[13] == volume.clusterSectors);
+    CHECK(get16(sector + 14) == FAT_EXPORT_RESERVED && sector[16] == 2);
+    CHECK(get32(sector + 32) == volume.sectors && get32(sector + 36) == volume.fatSectors);
+    CHECK(memcmp(sector + 82, "FAT32   ", 8) == 0);
+    read_sector(FAT_EXPORT_PARTITION + 1, sector);
+    CHECK(get32(sector) == 0x41615252 && get32(sector + 484) == 0x61417272);
+
+    // the label, then the files
+    uint32_t first = 2 + volume.rootClusters;
+    read_sector(volume.data - volume.rootClusters, sector);
+    CHECK(memcmp(sector, "BACPAC     ", 11) == 0 && sector[11] == 0x08);
+    CHECK(memcmp(sector + 32, "SESS000 BIN", 11) == 0);
+    CHECK(get16(sector + 32 + 26) == first && get32(sector + 32 + 28) == FAT_EXPORT_FILE_SECTORS * HOST_SD_SECTOR_SIZE);
+    CHECK(memcmp(sector + 64, "SESS001 BIN", 11) == 0);
+    CHECK(get16(sector + 64 + 26) == first + FAT_EXPORT_FILE_SECTORS);
+
+    // every file is one run of clusters
+    uint32_t last = first + FAT_EXPORT_FILE_SECTORS - 1; // of SESS000.BIN
+    read_sector(FAT_EXPORT_PARTITION + FAT_EXPORT_RESERVED + (last - 1) / 128, sector);
+    CHECK(get32(sector + (last - 1) % 128 * 4) == last);
+    read_sector(FAT_EXPORT_PARTITION + FAT_EXPORT_RESERVED + last / 128, sector);
+    CHECK(get32(sector + last % 128 * 4) == 0x0FFFFFFF);
+
+    // the data ring is the files
+    for (int i = 0; i < (int) sizeof(data); i++) data[i] = i * 11;
+    CHECK(da_write(data, sizeof(data)) == DISK_SUCCESS);
+    da_set_write_pos(da_get_export_file_size());
+    CHECK(da_write("session", 7) == DISK_SUCCESS);
+    CHECK(da_close() == DISK_SUCCESS);
+    read_sector(volume.data, sector);
+    CHECK(memcmp(sector, data, sizeof(sector)) == 0);
+    read_sector(volume.data + FAT_EXPORT_FILE_SECTORS, sector);
+    CHECK(memcmp(sector, "session", 7) == 0);
+
+    // loading it again keeps the volume and the positions
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK((uint32_t) da_get_export_files() == volume.files);
+    CHECK((unsigned long) da_get_write_pos() == da_get_export_file_size() + 7);
+    CHECK(da_read(back, sizeof(back)) == DISK_SUCCESS);
+    CHECK(memcmp(back, data, sizeof(data)) == 0);
+    CHECK(da_close() == DISK_SUCCESS);
+    da_set_export(0, 0);
+}
+
+static void test_raw_card_waits(void) {
+    char data[600];
+    char back[sizeof(data)];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, IMAGE_SECTORS);
+    CHECK(da_load() == DISK_SUCCESS);
+    for (int i = 0; i < (int) sizeof(data); i++) data[i] = i * 13;
+    CHECK(da_write(data, sizeof(data)) == DISK_SUCCESS);
+    CHECK(da_close() == DISK_SUCCESS);
+
+    // unread data keeps the card raw
+    da_set_export(FAT_EXPORT_FILE_SECTORS, FAT_EXPORT_FILES);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_export_files() == 0);
+    CHECK(da_read(back, sizeof(back)) == DISK_SUCCESS);
+    CHECK(memcmp(back, data, sizeof(data)) == 0);
+    da_soft_commit();
+    CHECK(da_close() == DISK_SUCCESS);
+
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_export_files() > 0);
+    CHECK(da_get_data_size() == 0);
+    CHECK(da_close() == DISK_SUCCESS);
+
+    // with export off the volume is still used
+    da_set_export(0, 0);
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_export_files() > 0);
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+const struct HostTest fatexport_tests[] = {
+    { "fatexport_plan", test_plan },
+    { "fatexport_format", test_format },
+    { "fatexport_raw_card_waits", test_raw_card_waits },
+    { NULL, NULL }
+};
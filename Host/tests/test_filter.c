@@ -0,0 +1,61 @@
+#include "HostTest.h"
+#include "Filter.h"
+
+static void test_passthrough_when_off(void) {
+    struct FilterConfig config = { 0, 0, 1 };
+    float value = 123.456f;
+
+    filter_configure(&config);
+    CHECK(filter_process(0, &value));
+    CHECK(value == 123.456f);
+}
+
+static void test_median_rejects_spike(void) {
+    struct FilterConfig config = { 1, 0, 1 };
+    float values[] = { 100, 100, 5000, 100, 100 };
+
+    filter_configure(&config);
+    for (int i = 0; i < 5; i++) {
+        float value = values[i];
+        CHECK(filter_process(3, &value));
+        CHECK_NEAR(value, 100, 0.01);
+    }
+}
+
+static void test_decimation(void) {
+    struct FilterConfig config = { 0, 0, 3 };
+    int outputs = 0;
+
+    filter_configure(&config);
+    for (int i = 0; i < 9; i++) {
+        float value = 50;
+        outputs += filter_process(1, &value);
+    }
+    CHECK(outputs == 3);
+
+    // every output is the mean of the averages since the last one, a tone at the input rate doesn't alias
+    config.decimation = 2;
+    filter_configure(&config);
+    for (int i = 0; i < 8; i++) {
+        float value = (i & 1) ? 300 : -100;
+        if (filter_process(2, &value)) CHECK_NEAR(value, 100, 0.01);
+    }
+    filter_set_decimation(4);
+    for (int i = 0; i < 4; i++) {
+        float value = 10 * i;
+        CHECK(filter_process(2, &value) == (i == 3));
+        if (i == 3) CHECK_NEAR(value, 15, 0.01);
+    }
+    CHECK(filter_decimation_for_rate(10, 0) == 1);
+    CHECK(filter_decimation_for_rate(10, 2) == 5);
+
+    struct FilterConfig off = { 0, 0, 1 };
+    filter_configure(&off);
+}
+
+const struct HostTest filter_tests[] = {
+    { "filter_passthrough_when_off", test_passthrough_when_off },
+    { "filter_median_rejects_spike", test_median_rejects_spike },
+    { "filter_decimation", test_decimation },
+    { NULL, NULL }
+};
@@ -0,0 +1,50 @@
+#include <string.h>
+#include "HostTest.h"
+#include "LiveStream.h"
+
+static void test_drops_oldest_when_full(void) {
+    char frame[8];
+    char out[64];
+
+    livestream_clear();
+    livestream_enable(1);
+    for (int i = 0; i < LIVESTREAM_NUM_FRAMES + 1; i++) {
+        memset(frame, 'a' + i, sizeof(frame));
+        livestream_push(frame, sizeof(frame));
+    }
+    CHECK(livestream_get_dropped() == 1);
+
+    CHECK(livestream_peek(out, sizeof(frame)) == sizeof(frame));
+    CHECK(out[0] == 'b'); // 'a' was dropped
+    livestream_consume(sizeof(frame));
+
+    uint16_t len = livestream_peek(out, sizeof(out));
+    CHECK(len == sizeof(frame) * (LIVESTREAM_NUM_FRAMES - 1));
+    livestream_consume(len);
+    CHECK(livestream_is_empty());
+    livestream_enable(0);
+}
+
+static void test_partial_frames(void) {
+    char frame[10] = "0123456789";
+    char out[4];
+
+    livestream_clear();
+    livestream_enable(1);
+    livestream_push(frame, sizeof(frame));
+
+    CHECK(livestream_peek(out, sizeof(out)) == 4);
+    livestream_consume(4);
+    CHECK(livestream_peek(out, sizeof(out)) == 4);
+    CHECK(memcmp(out, "4567", 4) == 0);
+    livestream_release(); // not sent, the same bytes come again
+    CHECK(livestream_peek(out, sizeof(out)) == 4);
+    CHECK(memcmp(out, "4567", 4) == 0);
+    livestream_enable(0);
+}
+
+const struct HostTest livestream_tests[] = {
+    { "livestream_drops_oldest_when_full", test_drops_oldest_when_full },
+    { "livestream_partial_frames", test_partial_frames },
+    { NULL, NULL }
+};
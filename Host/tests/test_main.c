@@ -0,0 +1,51 @@
+/*
+ * test_main.c
+ *
+ * Runs every host test, or only the ones whose name contains argv[1].
+ */
+#include <string.h>
+#include "HostTest.h"
+#include "HostDrivers.h"
+
+static const struct HostTest *const suites[] = {
+    serializer_tests,
+    filter_tests,
+    scheduler_tests,
+    livestream_tests,
+    blockpool_tests,
+    profiler_tests,
+    telemetry_tests,
+    overflow_tests,
+    diskaccess_tests,
+    fatexport_tests,
+    transfer_tests,
+    sensors_tests, // keep last, it starts the storage task and the sensors
+};
+
+static int failed;
+
+void host_test_fail(const char *file, int line, const char *expr) {
+    printf("    %s:%d: CHECK(%s) failed\n", file, line, expr);
+    failed = 1;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : NULL;
+    int run = 0;
+    int failures = 0;
+
+    for (size_t s = 0; s < sizeof(suites) / sizeof(suites[0]); s++) {
+        for (const struct HostTest *test = suites[s]; test->name; test++) {
+            if (filter && !strstr(test->name, filter)) continue;
+
+            failed = 0;
+            test->fxn();
+            printf("%s %s\n", failed ? "FAIL" : "ok  ", test->name);
+            failures += failed;
+            run++;
+        }
+    }
+
+    printf("%d tests, %d failed\n", run, failures);
+    return failures ? 1 : 0;
+}
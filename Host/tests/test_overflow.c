@@ -0,0 +1,148 @@
+#include <stdint.h>
+#include <string.h>
+#include <ti/drivers/NVS.h>
+#include "HostTest.h"
+#include "HostDrivers.h"
+#include "Overflow.h"
+
+#define FRAME_LENGTH 69 // a dense frame
+#define RECORD_SIZE (OVERFLOW_RECORD_HEADER_SIZE + FRAME_LENGTH)
+#define FRAMES_PER_SECTOR ((HOST_NVS_SECTOR_SIZE - OVERFLOW_SECTOR_HEADER_SIZE) / RECORD_SIZE)
+
+static void make_frame(char *frame, uint32_t number) {
+    for (int i = 0; i < FRAME_LENGTH; i++) frame[i] = number * 7 + i;
+    memcpy(frame, &number, sizeof(number));
+}
+
+// pops the oldest frame, returns its number or -1
+static int64_t pop_frame(void) {
+    char expected[FRAME_LENGTH];
+    uint32_t number;
+    uint8_t length;
+    const char *frame = overflow_peek(&length);
+
+    if (frame == NULL || length != FRAME_LENGTH) return -1;
+    memcpy(&number, frame, sizeof(number));
+    make_frame(expected, number);
+    if (memcmp(frame, expected, FRAME_LENGTH) != 0) return -1;
+    overflow_pop();
+    return number;
+}
+
+static void test_order_and_reset(void) {
+    char frame[FRAME_LENGTH];
+
+    host_nvs_erase();
+    CHECK(overflow_init());
+    CHECK(overflow_get_frames() == 0);
+    CHECK(overflow_peek(&(uint8_t) { 0 }) == NULL);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        make_frame(frame, i);
+        if (i == 4) CHECK(overflow_push(frame, 20, frame + 20, FRAME_LENGTH - 20)); // the RAM ring wrapped
+        else CHECK(overflow_push(frame, FRAME_LENGTH, NULL, 0));
+    }
+    CHECK(overflow_get_frames() == 10);
+    for (int i = 0; i < 3; i++) CHECK(pop_frame() == i);
+
+    // a reset keeps what wasn't drained
+    CHECK(overflow_init());
+    CHECK(overflow_get_frames() == 7);
+    for (int i = 3; i < 10; i++) CHECK(pop_frame() == i);
+    CHECK(overflow_get_frames() == 0);
+    CHECK(pop_frame() == -1);
+
+    CHECK(overflow_init());
+    CHECK(overflow_get_frames() == 0);
+}
+
+static void test_full_and_wraps(void) {
+    char frame[FRAME_LENGTH];
+    uint32_t pushed = 0, popped = 0;
+
+    host_nvs_erase();
+    CHECK(overflow_init());
+
+    // the sector with the oldest frames isn't erased
+    make_frame(frame, pushed);
+    while (overflow_push(frame, FRAME_LENGTH, NULL, 0)) make_frame(frame, ++pushed);
+    CHECK(pushed == FRAMES_PER_SECTOR * HOST_NVS_SECTORS);
+    CHECK(overflow_get_frames() == pushed);
+
+    // a sector is reused once all of its frames are drained, around the region a few times
+    uint32_t erases = host_nvs_get_erases();
+    for (int lap = 0; lap < 5; lap++) {
+        CHECK(pop_frame() == popped);
+        popped++;
+        make_frame(frame, pushed);
+        CHECK(!overflow_push(frame, FRAME_LENGTH, NULL, 0));
+        for (int i = 1; i < FRAMES_PER_SECTOR; i++) CHECK(pop_frame() == popped++);
+        for (int i = 0; i < FRAMES_PER_SECTOR; i++) {
+            make_frame(frame, pushed);
+            CHECK(overflow_push(frame, FRAME_LENGTH, NULL, 0));
+            pushed++;
+        }
+    }
+    CHECK(host_nvs_get_erases() == erases + 5);
+
+    CHECK(overflow_init());
+    CHECK(overflow_get_frames() == pushed - popped);
+    while (popped < pushed) CHECK(pop_frame() == popped++);
+    CHECK(overflow_get_frames() == 0);
+}
+
+static void test_torn_record_skipped(void) {
+    char frame[FRAME_LENGTH];
+    NVS_Handle nvs;
+    uint8_t zero = 0;
+
+    host_nvs_erase();
+    CHECK(overflow_init());
+    for (uint32_t i = 0; i < 3; i++) {
+        make_frame(frame, i);
+        CHECK(overflow_push(frame, FRAME_LENGTH, NULL, 0));
+    }
+
+    // the second frame lost bits like a write cut short by a reset
+    nvs = NVS_open(0, NULL);
+    CHECK(NVS_write(nvs, OVERFLOW_SECTOR_HEADER_SIZE + RECORD_SIZE + OVERFLOW_RECORD_HEADER_SIZE + 10, &zero, 1, 0) == NVS_STATUS_SUCCESS);
+
+    CHECK(overflow_init());
+    CHECK(overflow_get_frames() == 2);
+    CHECK(pop_frame() == 0);
+    CHECK(pop_frame() == 2);
+    CHECK(overflow_get_frames() == 0);
+}
+
+static void test_failed_header_closes_sector(void) {
+    char frame[FRAME_LENGTH];
+
+    host_nvs_erase();
+    CHECK(overflow_init());
+    for (uint32_t i = 0; i < 2; i++) {
+        make_frame(frame, i);
+        CHECK(overflow_push(frame, FRAME_LENGTH, NULL, 0));
+    }
+
+    // the header is left half programmed, nothing more goes into that sector
+    host_nvs_fail_writes(1);
+    CHECK(!overflow_push(frame, FRAME_LENGTH, NULL, 0));
+    uint32_t erases = host_nvs_get_erases();
+    make_frame(frame, 2);
+    CHECK(overflow_push(frame, FRAME_LENGTH, NULL, 0));
+    CHECK(host_nvs_get_erases() == erases + 1);
+    CHECK(overflow_get_frames() == 3);
+
+    CHECK(overflow_init());
+    CHECK(overflow_get_frames() == 3);
+    for (int i = 0; i < 3; i++) CHECK(pop_frame() == i);
+    CHECK(overflow_get_frames() == 0);
+}
+
+const struct HostTest overflow_tests[] = {
+    { "overflow_order_and_reset", test_order_and_reset },
+    { "overflow_full_and_wraps", test_full_and_wraps },
+    { "overflow_torn_record_skipped", test_torn_record_skipped },
+    { "overflow_failed_header_closes_sector", test_failed_header_closes_sector },
+    { NULL, NULL }
+};
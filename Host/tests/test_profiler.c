@@ -0,0 +1,69 @@
+#include <string.h>
+#include "HostTest.h"
+#include "Profiler.h"
+#include "Diagnostics.h"
+
+static void test_stage_statistics(void) {
+    struct ProfilerStage stats;
+
+    profiler_reset();
+    profiler_record(PROFILER_ADC_READ, 10);  // below the first bin's range, still bin 0
+    profiler_record(PROFILER_ADC_READ, 100); // 64..127
+    profiler_record(PROFILER_ADC_READ, 190);
+    profiler_get_stage(PROFILER_ADC_READ, &stats);
+
+    CHECK(stats.count == 3);
+    CHECK(stats.min == 10);
+    CHECK(stats.max == 190);
+    CHECK(stats.mean == 100);
+    CHECK(stats.histogram[0] == 1);
+    CHECK(stats.histogram[2] == 1);
+    CHECK(stats.histogram[3] == 1);
+
+    profiler_record(PROFILER_ADC_READ, UINT32_MAX);
+    profiler_get_stage(PROFILER_ADC_READ, &stats);
+    CHECK(stats.histogram[PROFILER_HIST_BINS - 1] == 1);
+
+    profiler_get_stage(PROFILER_I2C, &stats);
+    CHECK(stats.count == 0 && stats.min == 0 && stats.mean == 0);
+}
+
+static void test_counts_overruns(void) {
+    struct ProfilerSummary summary;
+
+    profiler_reset();
+    profiler_set_period(1000);
+    profiler_tick_end(profiler_now() - 5000); // ran for five periods
+    profiler_get_summary(&summary);
+    CHECK(summary.overruns == 1);
+    CHECK(summary.maxTickCycles >= 5000);
+
+    profiler_reset();
+    profiler_set_period(UINT32_MAX / 4); // the host clock can't lag that far behind
+    profiler_tick_end(profiler_tick_begin());
+    profiler_tick_end(profiler_tick_begin());
+    profiler_get_summary(&summary);
+    CHECK(summary.ticks == 2);
+    CHECK(summary.overruns == 0);
+}
+
+static void test_diagnostics_pages(void) {
+    uint8_t page[DIAGNOSTICS_MAX_PAGE_SIZE];
+    struct ProfilerStage stats;
+
+    profiler_reset();
+    profiler_record(PROFILER_CONTROLLER, 42);
+    CHECK(diagnostics_read_page(DIAGNOSTICS_PAGE_PROFILER, page, sizeof(page)) == sizeof(struct ProfilerSummary));
+    CHECK(diagnostics_read_page(DIAGNOSTICS_PAGE_PROFILER_STAGE + PROFILER_CONTROLLER, page, sizeof(page)) == sizeof(stats));
+    memcpy(&stats, page, sizeof(stats));
+    CHECK(stats.count == 1 && stats.max == 42);
+    CHECK(diagnostics_read_page(DIAGNOSTICS_PAGE_PROFILER_STAGE + PROFILER_NUM_STAGES, page, sizeof(page)) == 0);
+    CHECK(diagnostics_read_page(DIAGNOSTICS_PAGE_PROFILER, page, 4) == 0); // doesn't fit
+}
+
+const struct HostTest profiler_tests[] = {
+    { "profiler_stage_statistics", test_stage_statistics },
+    { "profiler_counts_overruns", test_counts_overruns },
+    { "profiler_diagnostics_pages", test_diagnostics_pages },
+    { NULL, NULL }
+};
@@ -0,0 +1,35 @@
+#include "HostTest.h"
+#include "Scheduler.h"
+
+static void test_mode_blocks(void) {
+    const struct AcquisitionSlot table[] = {
+        { ACQ_MODE_EMG, 6, 2 },
+        { ACQ_MODE_EMG, 3, 1 },
+        { ACQ_MODE_IMPEDANCE, 5, 1 },
+    };
+
+    scheduler_setTable(table, 3);
+    CHECK(scheduler_current()->mode == ACQ_MODE_EMG);
+    CHECK(scheduler_frameDone() == 0); // first of two EMG frames
+    CHECK(scheduler_frameDone() == 0); // next slot is EMG as well
+    CHECK(scheduler_current()->cyclesPerOutput == 3);
+    CHECK(scheduler_frameDone() == 1);
+    CHECK(scheduler_current()->mode == ACQ_MODE_IMPEDANCE);
+    CHECK(scheduler_frameDone() == 1); // wraps around to EMG
+    CHECK(scheduler_current()->mode == ACQ_MODE_EMG);
+}
+
+static void test_invalid_slots_are_fixed_up(void) {
+    const struct AcquisitionSlot table[] = { { ACQ_MODE_IMPEDANCE, 0, 0 } };
+
+    scheduler_setTable(table, 1);
+    CHECK(scheduler_current()->cyclesPerOutput == 1);
+    CHECK(scheduler_current()->frames == 1);
+    CHECK(scheduler_frameDone() == 0);
+}
+
+const struct HostTest scheduler_tests[] = {
+    { "scheduler_mode_blocks", test_mode_blocks },
+    { "scheduler_invalid_slots_are_fixed_up", test_invalid_slots_are_fixed_up },
+    { NULL, NULL }
+};
@@ -0,0 +1,440 @@
+/*
+ * Runs the whole acquisition path: DACtimerCallback, impedanceCalc,
+ * averaging, serializer and the storage task writing to the card image.
+ */
+#include <string.h>
+#include <unistd.h>
+#include "HostTest.h"
+#include "HostDrivers.h"
+#include "sensors.h"
+#include "Storage.h"
+#include "Serializer.h"
+#include "Filter.h"
+#include "ImpedanceCalc.h"
+#include "Profiler.h"
+#include "PowerModel.h"
+#include "MemoryPlan.h"
+#include "bacpac_transfer.h"
+#include <ti/drivers/power/PowerCC26XX.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#define IMAGE "sensors.img"
+#define ADC_AT_TARGET 2750 // p controller target, the taps don't move
+#define TICKS_PER_ROUND (16 * 3) // one impedance read takes 3 DACtimerCallbacks
+
+static uint16_t constant_adc(void *arg, uint8_t muxAddress, uint8_t tap) {
+    return ADC_AT_TARGET;
+}
+
+// one tick at a time so the storage task keeps up like it does on the board
+static void run_ticks(uint32_t ticks) {
+    for (uint32_t i = 0; i < ticks; i++) {
+        host_timer_fire(1);
+        host_rtos_wait_idle();
+    }
+}
+
+static uint16_t frame_sequence; // sequence number of the last frame read
+
+// reads the next frame logged since the last call, returns its type or 0
+static uint8_t next_frame(float *values) {
+    char frame[SERIALIZER_MAX_FRAME_SIZE];
+
+    if (da_get_data_size() < (int) SERIALIZER_MAX_FRAME_SIZE) return 0;
+    if (da_read(frame, SERIALIZER_MAX_FRAME_SIZE) != DISK_SUCCESS) return 0;
+    memcpy(&frame_sequence, frame + 1 + sizeof(uint16_t), sizeof(uint16_t));
+    memcpy(values, frame + SERIALIZER_HEADER_SIZE, sizeof(float) * NUM_SENSORS);
+    return (uint8_t) frame[0];
+}
+
+static void test_records_impedance_frames(void) {
+    float values[NUM_SENSORS];
+    uint32_t frames = 0;
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 4096);
+    host_adc_set_source(constant_adc, NULL);
+    Storage_createTask();
+    host_rtos_wait_idle();
+
+    Sensors_init(); // default config runs the 48 hour code, the timers start right away
+    CHECK(host_timer_is_running());
+    CHECK(host_timer_get_load() == 48000000 / (800 * 3) - 1);
+
+    run_ticks(TICKS_PER_ROUND * 5 * 4);
+    Sensors_stop_timers();
+    host_rtos_wait_idle();
+
+    float expected = impedanceCalc(125, ADC_AT_TARGET);
+    uint8_t type;
+    while ((type = next_frame(values))) {
+        CHECK(type == SERIALIZER_FRAME_DENSE);
+        for (int i = 0; i < NUM_SENSORS; i++) CHECK_NEAR(values[i], expected, 0.01);
+        CHECK(frame_sequence == frames); // nothing lost
+        frames++;
+    }
+    CHECK(frames >= 3);
+    CHECK(host_i2c_get_tap() == 125);
+
+    struct PipelineStats stats;
+    Sensors_get_stats(&stats);
+    CHECK(stats.ticks == TICKS_PER_ROUND * 5 * 4);
+    CHECK(stats.elapsedMs == stats.ticks * 1000 / (800 * 3));
+    CHECK(stats.framesBuilt == frames);
+    CHECK(stats.framesStored == frames);
+    CHECK(stats.framesSkipped == 0 && stats.writeFailures == 0 && stats.adcFailures == 0);
+    CHECK(stats.deliveredRate == frames * 1000000 / stats.elapsedMs);
+
+    struct ProfilerSummary summary;
+    struct ProfilerStage stage;
+    profiler_get_summary(&summary);
+    CHECK(summary.ticks == TICKS_PER_ROUND * 5 * 4);
+    CHECK(summary.periodCycles == 48000000 / (800 * 3));
+    profiler_get_stage(PROFILER_ADC_READ, &stage);
+    CHECK(stage.count == 16 * 5 * 4); // one read per channel per round
+    profiler_get_stage(PROFILER_I2C, &stage);
+    CHECK(stage.count == 16 * 5 * 4);
+    profiler_get_stage(PROFILER_OUTPUT, &stage);
+    CHECK(stage.count > 0);
+}
+
+static void test_schedule_interleaves_modes(void) {
+    struct AcquisitionConfig config;
+    float values[NUM_SENSORS];
+    uint8_t types[8];
+    int frames = 0;
+
+    config_default(&config);
+    config.numSlots = 2;
+    config.slots[0] = (struct AcquisitionSlot) { ACQ_MODE_EMG, 3, 1 };
+    config.slots[1] = (struct AcquisitionSlot) { ACQ_MODE_IMPEDANCE, 2, 1 };
+    CHECK(Sensors_configure(&config));
+
+    Sensors_start_timers();
+    run_ticks(TICKS_PER_ROUND * 10);
+    Sensors_stop_timers();
+    host_rtos_wait_idle();
+
+    uint8_t type;
+    while ((type = next_frame(values)) && frames < 8) {
+        if (type & SERIALIZER_FRAME_EMG) CHECK_NEAR(values[0], ADC_AT_TARGET * 8.056640625, 0.5);
+        else CHECK_NEAR(values[0], impedanceCalc(125, ADC_AT_TARGET), 0.01);
+        types[frames++] = type;
+    }
+    CHECK(frames >= 4);
+    for (int i = 1; i < frames; i++) CHECK((types[i] ^ types[i - 1]) == SERIALIZER_FRAME_EMG); // modes alternate
+}
+
+static void test_config_reprograms_timer(void) {
+    struct AcquisitionConfig config;
+
+    config_default(&config);
+    config.muxFreq = 400;
+    Sensors_start_timers();
+    CHECK(Sensors_configure(&config));
+    CHECK(host_timer_is_running()); // restarted with the new load value
+    CHECK(host_timer_get_load() == 48000000 / (400 * 3) - 1);
+
+    config.muxFreq = 5000; // faster than the adc can sample
+    CHECK(!Sensors_configure(&config));
+    CHECK(Sensors_get_config()->muxFreq == 400);
+
+    // the power up mode stays until the next boot
+    config.muxFreq = 400;
+    config.flags = CONFIG_FLAG_FAT_EXPORT;
+    CHECK(Sensors_configure(&config));
+    CHECK(Sensors_get_config()->flags == CONFIG_FLAG_FOURTYEIGHT);
+    CHECK(host_timer_is_running());
+    Sensors_stop_timers();
+}
+
+// runs the DAC timer until the burst stops it, returns the ticks it took
+static uint32_t run_burst(void) {
+    uint32_t ticks = 0;
+
+    while (host_timer_is_running() && ticks < TICKS_PER_ROUND * 5 * 10) {
+        run_ticks(1);
+        ticks++;
+    }
+    return ticks;
+}
+
+static void test_duty_cycle_bursts(void) {
+    struct AcquisitionConfig config;
+    struct PowerEstimate estimate;
+    float values[NUM_SENSORS];
+    uint16_t timestamps[4];
+    int frames = 0;
+
+    config_default(&config);
+    config.burstPeriod = 2;
+    config.burstFrames = 2;
+    CHECK(Sensors_configure(&config));
+    while (next_frame(values)); // skip what the last tests logged
+
+    Sensors_start_timers();
+    CHECK(host_timer_is_running());
+    CHECK(host_power_get_constraint(PowerCC26XX_SB_DISALLOW) == 1);
+    host_clock_advance(5000); // 50 ms
+    CHECK(run_burst() == TICKS_PER_ROUND * 5 * 2 + 1); // two frames, then the tick that ends the burst
+    CHECK(host_power_get_constraint(PowerCC26XX_SB_DISALLOW) == 0);
+    CHECK(host_pin_get(IOID_28) == 1); // mux off
+    CHECK(power_get_state() == POWER_STATE_STANDBY);
+
+    host_clock_advance(200000 - 5000); // the next burst is due 2 s after the first
+    CHECK(host_timer_is_running());
+    CHECK(host_power_get_constraint(PowerCC26XX_SB_DISALLOW) == 1);
+    CHECK(run_burst() == TICKS_PER_ROUND * 5 * 2 + 1);
+    host_rtos_wait_idle();
+
+    char frame[SERIALIZER_MAX_FRAME_SIZE];
+    while (frames < 4 && da_get_data_size() >= (int) SERIALIZER_MAX_FRAME_SIZE && da_read(frame, sizeof(frame)) == DISK_SUCCESS) {
+        memcpy(&timestamps[frames++], frame + 1, sizeof(uint16_t));
+    }
+    CHECK(frames == 4);
+    CHECK(timestamps[1] < 2 && timestamps[2] == 2); // seconds since the recording started
+
+    power_get(&estimate);
+    CHECK(estimate.stateMs[POWER_STATE_ACQUIRING] == 50);
+    CHECK(estimate.stateMs[POWER_STATE_STANDBY] == 1950);
+    CHECK(estimate.recordingUa == (50 * POWER_ACQUIRING_UA + 1950 * POWER_STANDBY_UA) / 2000);
+
+    // starting again during a burst doesn't take the constraint twice
+    host_clock_advance(200000);
+    CHECK(host_power_get_constraint(PowerCC26XX_SB_DISALLOW) == 1);
+    Sensors_start_timers();
+    CHECK(host_power_get_constraint(PowerCC26XX_SB_DISALLOW) == 1);
+
+    // stopping during a burst gives the constraint back
+    Sensors_stop_timers();
+    CHECK(host_power_get_constraint(PowerCC26XX_SB_DISALLOW) == 0);
+    CHECK(power_get_state() == POWER_STATE_IDLE);
+    host_clock_advance(400000);
+    CHECK(!host_timer_is_running()); // no more bursts
+
+    config.burstFrames = 40; // longer than the period at 800 reads per second
+    CHECK(!Sensors_configure(&config));
+    config_default(&config);
+    config.flags |= CONFIG_FLAG_CALIBRATE; // one power up mode at a time
+    CHECK(!Sensors_configure(&config));
+
+    // a version 1 config saved in SNV keeps its settings and records continuously
+    config_default(&config);
+    config.flags = CONFIG_FLAG_CALIBRATE;
+    config.muxFreq = 400;
+    config.version = 1;
+    memset((char*) &config + CONFIG_V1_SIZE, 0xFF, CONFIG_SIZE - CONFIG_V1_SIZE); // past the end of the saved item
+    CHECK(!Sensors_configure(&config));
+    CHECK(config_upgrade(&config));
+    CHECK(config.version == CONFIG_VERSION && config.flags == CONFIG_FLAG_CALIBRATE && config.muxFreq == 400);
+    CHECK(config.burstPeriod == 0 && config.burstFrames == 0);
+    CHECK(config.filterIirShift == 0 && config.filterOutputRate == 0 && config.keyframeInterval == 600);
+    CHECK(config_validate(&config));
+
+    // a version 2 one keeps its bursts and logs every frame unfiltered
+    config_default(&config);
+    config.burstPeriod = 60;
+    config.burstFrames = 2;
+    config.version = 2;
+    memset((char*) &config + CONFIG_V2_SIZE, 0xFF, CONFIG_SIZE - CONFIG_V2_SIZE);
+    CHECK(config_upgrade(&config));
+    CHECK(config.version == CONFIG_VERSION && config.burstPeriod == 60 && config.burstFrames == 2);
+    CHECK(config.filterMedian == 0 && config.filterIirShift == 0 && config.filterOutputRate == 0);
+    CHECK(config.deadband == 50 && config.keyframeInterval == 600 && config.heartbeatInterval == 50);
+    CHECK(config_validate(&config));
+
+    // filter and deadband settings out of range
+    config_default(&config);
+    config.filterIirShift = FILTER_MAX_SHIFT + 1;
+    CHECK(!config_validate(&config));
+    config_default(&config);
+    config.filterOutputRate = config.muxFreq + 1;
+    CHECK(!config_validate(&config));
+    config_default(&config);
+    config.flags |= CONFIG_FLAG_DEADBAND;
+    config.keyframeInterval = 0;
+    CHECK(!config_validate(&config));
+    config.version = CONFIG_VERSION + 1;
+    CHECK(!config_upgrade(&config));
+    config_default(&config);
+    CHECK(Sensors_configure(&config));
+}
+
+static void test_storage_requests(void) {
+    char packet[BACPAC_TRANSFER_PACKET_LENGTH];
+    char expected[BACPAC_TRANSFER_PACKET_LENGTH];
+    volatile int result;
+    Semaphore_Struct doneStruct;
+    int length;
+
+    Sensors_start_timers();
+    run_ticks(TICKS_PER_ROUND * 5 * 2);
+    Sensors_stop_timers();
+    host_rtos_wait_idle();
+
+    // the storage task reads the packet, the offload gets it on a later call
+    CHECK(BacpacTransfer_initialize() == da_get_data_size());
+    uint32_t position = da_get_read_pos();
+    CHECK(da_read_at(position, expected, sizeof(expected)) == DISK_SUCCESS);
+    BacpacTransfer_success();
+    while ((length = BacpacTransfer_next(packet)) == BACPAC_TRANSFER_BUSY) host_rtos_wait_idle();
+    CHECK(length == sizeof(packet));
+    CHECK(memcmp(packet, expected, sizeof(packet)) == 0);
+    CHECK((uint32_t) da_get_read_pos() == position + sizeof(packet));
+    BacpacTransfer_error();
+
+    // requests are done in order, then the semaphore is posted
+    Semaphore_construct(&doneStruct, 0, NULL);
+    struct StorageRequest read = { STORAGE_READ, DA_CURSOR_DEFAULT, sizeof(packet), position, packet, &result, NULL };
+    struct StorageRequest commit = { STORAGE_COMMIT, DA_CURSOR_DEFAULT, 0, 0, NULL, NULL, Semaphore_handle(&doneStruct) };
+    memset(packet, 0, sizeof(packet));
+    CHECK(Storage_submit(&read) == DISK_SUCCESS);
+    CHECK(Storage_submit(&commit) == DISK_SUCCESS);
+    Semaphore_pend(Semaphore_handle(&doneStruct), BIOS_WAIT_FOREVER);
+    CHECK(result == DISK_SUCCESS);
+    CHECK(memcmp(packet, expected, sizeof(packet)) == 0);
+
+    // a clear that finds the queue full goes out later, on the cursor the central gave up on
+    commit.done = NULL;
+    CHECK(BacpacTransfer_initialize() > 0);
+    UInt key = Hwi_disable(); // keeps the storage task from taking requests off the queue
+    for (int i = 0; i < MEMORY_STORAGE_QUEUE_LENGTH; i++) CHECK(Storage_submit(&commit) == DISK_SUCCESS);
+    BacpacTransfer_failure();
+    CHECK(Storage_submit(&commit) == DISK_BUSY);
+    Hwi_restore(key);
+    host_rtos_wait_idle();
+    CHECK(da_get_data_size() > 0);
+    CHECK(da_set_cursor(1) == DISK_SUCCESS); // the next central
+    int size = da_get_data_size();
+    CHECK(size > 0);
+    CHECK(BacpacTransfer_poll() == 0);
+    host_rtos_wait_idle();
+    CHECK(da_get_data_size() == size);
+    CHECK(da_set_cursor(DA_CURSOR_DEFAULT) == DISK_SUCCESS);
+    CHECK(da_get_data_size() == 0);
+    CHECK(da_clear_cursor(1) == DISK_SUCCESS);
+}
+
+static Semaphore_Struct mountGateStruct;
+static int mountFxnStatus;
+static int mountStatusInFxn;
+
+// keeps the storage task in the mount like a slow card
+static void slow_mount(int status) {
+    mountFxnStatus = status;
+    mountStatusInFxn = Storage_getMountStatus();
+    Semaphore_pend(Semaphore_handle(&mountGateStruct), BIOS_WAIT_FOREVER);
+}
+
+static void test_frames_wait_for_mount(void) {
+    struct StorageRequest clear = { STORAGE_CLEAR, DA_CURSOR_DEFAULT, 0, 0, NULL, NULL, NULL };
+    struct StorageRequest commit = { STORAGE_COMMIT, DA_CURSOR_DEFAULT, 0, 0, NULL, NULL, NULL };
+    struct PipelineStats stats;
+    float values[NUM_SENSORS];
+    uint32_t frames = 0;
+
+    // nothing left to read, the frames below are the whole log
+    CHECK(Storage_submit(&clear) == DISK_SUCCESS);
+    CHECK(Storage_submit(&commit) == DISK_SUCCESS);
+    host_rtos_wait_idle();
+
+    Semaphore_construct(&mountGateStruct, 0, NULL);
+    Storage_setMountFxn(slow_mount);
+    CHECK(Storage_mount() == DISK_SUCCESS);
+    host_rtos_wait_idle();
+    CHECK(Storage_getMountStatus() == STORAGE_PENDING);
+
+    // sensing runs while the card mounts, the frames wait in RAM
+    Sensors_start_timers();
+    run_ticks(TICKS_PER_ROUND * 5 * 3);
+    CHECK(Storage_framesWaiting() > 0);
+    Sensors_get_stats(&stats);
+    CHECK(stats.framesBuilt > 1 && stats.framesStored == 0);
+
+    Semaphore_post(Semaphore_handle(&mountGateStruct));
+    host_rtos_wait_idle();
+    CHECK(mountFxnStatus == DISK_SUCCESS && mountStatusInFxn == STORAGE_PENDING);
+    CHECK(Storage_getMountStatus() == DISK_SUCCESS);
+    CHECK(Semaphore_pend(storage_ready, 0));
+    CHECK(Storage_framesWaiting() == 0);
+
+    run_ticks(TICKS_PER_ROUND * 5);
+    Sensors_stop_timers();
+    host_rtos_wait_idle();
+    Storage_setMountFxn(NULL);
+
+    // every frame made it, in order
+    while (next_frame(values)) {
+        CHECK(frame_sequence == frames);
+        frames++;
+    }
+    Sensors_get_stats(&stats);
+    CHECK(frames == stats.framesBuilt);
+    CHECK(stats.framesStored == frames && stats.framesDeferred > 0);
+    CHECK(stats.framesSkipped == 0 && stats.writeFailures == 0);
+}
+
+static void test_overflow_without_card(void) {
+    struct StorageRequest clear = { STORAGE_CLEAR, DA_CURSOR_DEFAULT, 0, 0, NULL, NULL, NULL };
+    struct StorageRequest commit = { STORAGE_COMMIT, DA_CURSOR_DEFAULT, 0, 0, NULL, NULL, NULL };
+    struct PipelineStats stats;
+    float values[NUM_SENSORS];
+    uint32_t frames = 0;
+
+    CHECK(Storage_submit(&clear) == DISK_SUCCESS);
+    CHECK(Storage_submit(&commit) == DISK_SUCCESS);
+    host_rtos_wait_idle();
+
+    // no card, the frames go to the internal flash
+    host_sd_set_present(false);
+    CHECK(Storage_mount() == DISK_SUCCESS);
+    host_rtos_wait_idle();
+    CHECK(Storage_getMountStatus() == DISK_FAILED_INIT);
+    CHECK(Semaphore_pend(storage_ready, 0));
+    Sensors_start_timers();
+    run_ticks(TICKS_PER_ROUND * 5 * 4);
+    Sensors_get_stats(&stats);
+    CHECK(stats.framesOverflowed > 0 && stats.overflowFrames == stats.framesOverflowed);
+    CHECK(stats.framesStored == 0 && stats.writeFailures == 0);
+
+    // the card is back, the storage task mounts it 10 s after the last try, then it fails a few writes while recording
+    host_sd_set_present(true);
+    host_clock_advance(500000);
+    run_ticks(TICKS_PER_ROUND * 5);
+    host_rtos_wait_idle();
+    CHECK(Storage_getMountStatus() == DISK_FAILED_INIT);
+    host_clock_advance(500000);
+    run_ticks(TICKS_PER_ROUND * 5);
+    host_rtos_wait_idle();
+    CHECK(Storage_getMountStatus() == DISK_SUCCESS);
+    CHECK(Semaphore_pend(storage_ready, 0));
+    Sensors_get_stats(&stats);
+    CHECK(stats.overflowFrames == 0 && stats.overflowDrained == stats.framesOverflowed);
+    uint32_t overflowed = stats.framesOverflowed;
+    host_sd_fail_writes(3);
+    run_ticks(TICKS_PER_ROUND * 5 * 20);
+    Sensors_stop_timers();
+    host_rtos_wait_idle();
+
+    // every frame made it, in order
+    while (next_frame(values)) {
+        CHECK(frame_sequence == frames);
+        frames++;
+    }
+    Sensors_get_stats(&stats);
+    CHECK(frames == stats.framesBuilt && stats.framesStored == frames);
+    CHECK(stats.framesOverflowed > overflowed && stats.overflowDrained == stats.framesOverflowed);
+    CHECK(stats.overflowFrames == 0 && stats.writeFailures == 0 && stats.framesSkipped == 0);
+}
+
+const struct HostTest sensors_tests[] = {
+    { "sensors_records_impedance_frames", test_records_impedance_frames },
+    { "sensors_schedule_interleaves_modes", test_schedule_interleaves_modes },
+    { "sensors_config_reprograms_timer", test_config_reprograms_timer },
+    { "sensors_duty_cycle_bursts", test_duty_cycle_bursts },
+    { "sensors_storage_requests", test_storage_requests },
+    { "sensors_frames_wait_for_mount", test_frames_wait_for_mount },
+    { "sensors_overflow_without_card", test_overflow_without_card },
+    { NULL, NULL }
+};
@@ -0,0 +1,97 @@
+#include <string.h>
+#include "HostTest.h"
+#include "Serializer.h"
+
+static void fill_frame(float base) {
+    serializer_setTimestamp(1234);
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) serializer_addImpedance(base + i);
+}
+
+static void test_dense_frame_layout(void) {
+    char buffer[SERIALIZER_MAX_FRAME_SIZE];
+    uint16_t timestamp;
+    float value;
+
+    serializer_clear();
+    serializer_setMode(SERIALIZER_MODE_IMPEDANCE);
+    fill_frame(100);
+    CHECK(serializer_isFull());
+
+    CHECK(serializer_serialize(buffer) == SERIALIZER_MAX_FRAME_SIZE);
+    CHECK(buffer[0] == SERIALIZER_FRAME_DENSE);
+    memcpy(&timestamp, buffer + 1, sizeof(timestamp));
+    CHECK(timestamp == 1234);
+    memcpy(&value, buffer + SERIALIZER_HEADER_SIZE + 3 * sizeof(float), sizeof(float));
+    CHECK(value == 103);
+}
+
+static void test_sequence_numbers(void) {
+    char buffer[SERIALIZER_MAX_FRAME_SIZE];
+    uint16_t sequence;
+
+    serializer_clear();
+    serializer_setMode(SERIALIZER_MODE_IMPEDANCE);
+    for (uint16_t frame = 0; frame < 3; frame++) {
+        fill_frame(0);
+        serializer_serialize(buffer);
+        memcpy(&sequence, buffer + 1 + sizeof(uint16_t), sizeof(sequence));
+        CHECK(sequence == frame);
+    }
+
+    serializer_clear(); // a new recording starts over
+    fill_frame(0);
+    serializer_serialize(buffer);
+    memcpy(&sequence, buffer + 1 + sizeof(uint16_t), sizeof(sequence));
+    CHECK(sequence == 0);
+}
+
+static void test_emg_frames_are_flagged(void) {
+    char buffer[SERIALIZER_MAX_FRAME_SIZE];
+
+    serializer_clear();
+    serializer_setMode(SERIALIZER_MODE_EMG);
+    fill_frame(0);
+    serializer_serialize(buffer);
+    serializer_setMode(SERIALIZER_MODE_IMPEDANCE);
+
+    CHECK((uint8_t) buffer[0] == (SERIALIZER_FRAME_EMG | SERIALIZER_FRAME_DENSE));
+}
+
+static void test_deadband_sparse_and_heartbeat(void) {
+    char buffer[SERIALIZER_MAX_FRAME_SIZE];
+    struct DeadbandConfig config = { 10.0f, 100, 3 };
+    uint16_t mask;
+
+    serializer_clear();
+    serializer_setMode(SERIALIZER_MODE_IMPEDANCE);
+    serializer_setDeadband(&config);
+
+    fill_frame(100);
+    CHECK(serializer_serializeDeadband(buffer) == SERIALIZER_MAX_FRAME_SIZE); // first frame is a keyframe
+
+    fill_frame(100);
+    CHECK(serializer_serializeDeadband(buffer) == 0);
+    fill_frame(100);
+    CHECK(serializer_serializeDeadband(buffer) == 0);
+    fill_frame(100);
+    CHECK(serializer_serializeDeadband(buffer) == SERIALIZER_HEADER_SIZE);
+    CHECK(buffer[0] == SERIALIZER_FRAME_HEARTBEAT);
+
+    serializer_setTimestamp(1);
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) serializer_addImpedance(i == 5 ? 200 : 100 + i);
+    CHECK(serializer_serializeDeadband(buffer) == SERIALIZER_HEADER_SIZE + sizeof(uint16_t) + sizeof(float));
+    CHECK(buffer[0] == SERIALIZER_FRAME_SPARSE);
+    memcpy(&mask, buffer + SERIALIZER_HEADER_SIZE, sizeof(mask));
+    CHECK(mask == (1 << 5));
+
+    struct DeadbandConfig off = { 0, 1, 1 };
+    serializer_setDeadband(&off);
+}
+
+const struct HostTest serializer_tests[] = {
+    { "serializer_dense_frame_layout", test_dense_frame_layout },
+    { "serializer_sequence_numbers", test_sequence_numbers },
+    { "serializer_emg_frames_are_flagged", test_emg_frames_are_flagged },
+    { "serializer_deadband_sparse_and_heartbeat", test_deadband_sparse_and_heartbeat },
+    { NULL, NULL }
+};
@@ -0,0 +1,53 @@
+#include <string.h>
+#include "HostTest.h"
+#include "HostDrivers.h"
+#include "Telemetry.h"
+#include "Diagnostics.h"
+
+static void test_tasks_and_heap(void) {
+    static Task_Struct task;
+    struct Telemetry telemetry;
+    uint8_t page[DIAGNOSTICS_MAX_PAGE_SIZE];
+    char line[80];
+
+    task.stackSize = 512;
+    telemetry_get(&telemetry);
+    uint8_t index = telemetry.numTasks;
+    telemetry_register_task(&task, "storage");
+
+    host_task_set_stats(&task, 300, 25, 100);
+    host_task_set_stats(Task_getIdleTask(), 0, 60, 100);
+    telemetry_heap(4000, 1000, 800);
+    telemetry_heap(4000, 600, 500);
+    telemetry_heap(4000, 2000, 500);
+    CHECK(telemetry_poll());
+    CHECK(!telemetry_poll()); // not again before TELEMETRY_PERIOD
+
+    // the stack peak stays when the task uses less later
+    host_task_set_stats(&task, 200, 5, 100);
+    telemetry_sample();
+
+    telemetry_get(&telemetry);
+    CHECK(telemetry.numTasks == index + 1);
+    CHECK(telemetry.samples == 2);
+    CHECK(telemetry.cpuLoad == 400);
+    CHECK(memcmp(telemetry.tasks[index].name, "stor", TELEMETRY_NAME_LENGTH) == 0);
+    CHECK(telemetry.tasks[index].stackSize == 512);
+    CHECK(telemetry.tasks[index].stackPeak == 300);
+    CHECK(telemetry.tasks[index].load == 50);
+    CHECK(telemetry.tasks[index].peakLoad == 250);
+    CHECK(telemetry.heap.totalFree == 2000);
+    CHECK(telemetry.heap.minFree == 600);
+    CHECK(telemetry.heap.fragmentation == 750);
+
+    CHECK(diagnostics_read_page(DIAGNOSTICS_PAGE_TELEMETRY, page, sizeof(page)) == sizeof(telemetry));
+    CHECK(memcmp(page, &telemetry, sizeof(telemetry)) == 0);
+
+    telemetry_format(line, index);
+    CHECK(strcmp(line, "stor: stack 300 of 512, load 5.0% peak 25.0%\n") == 0);
+}
+
+const struct HostTest telemetry_tests[] = {
+    { "telemetry_tasks_and_heap", test_tasks_and_heap },
+    { NULL, NULL }
+};
@@ -0,0 +1,178 @@
+#include <string.h>
+#include <unistd.h>
+#include "HostTest.h"
+#include "HostDrivers.h"
+#include "DiskAccess.h"
+#include "bacpac_transfer.h"
+
+#define IMAGE "transfer.img"
+
+// sends packets until the chunk is full or the data runs out, returns the bytes sent
+static int send_chunk(char *buffer) {
+    char packet[BACPAC_TRANSFER_PACKET_LENGTH];
+    int sent = 0;
+    int length;
+
+    while ((length = BacpacTransfer_next(packet)) > 0) {
+        memcpy(buffer + sent, packet, length);
+        sent += length;
+    }
+    return sent;
+}
+
+static void test_pattern_records(void) {
+    uint8_t record[BACPAC_PATTERN_RECORD_LENGTH];
+    uint32_t sequence;
+
+    BacpacTransfer_fillPattern((char *) record, 5 * BACPAC_PATTERN_RECORD_LENGTH, sizeof(record));
+    CHECK(BacpacTransfer_checkRecord(record, &sequence));
+    CHECK(sequence == 5);
+
+    // a record split across two reads is the same record
+    char split[BACPAC_PATTERN_RECORD_LENGTH];
+    BacpacTransfer_fillPattern(split, 5 * BACPAC_PATTERN_RECORD_LENGTH, 3);
+    BacpacTransfer_fillPattern(split + 3, 5 * BACPAC_PATTERN_RECORD_LENGTH + 3, sizeof(split) - 3);
+    CHECK(memcmp(split, record, sizeof(record)) == 0);
+
+    record[7] ^= 1;
+    CHECK(!BacpacTransfer_checkRecord(record, &sequence));
+    CHECK(BacpacTransfer_crc16((const uint8_t *) "123456789", 9) == 0x29B1);
+}
+
+static void test_pattern_chunks(void) {
+    static char received[2000];
+    struct BacpacTransferStats stats;
+    int size = BacpacTransfer_initializePattern(1500);
+
+    CHECK(size == 1504); // whole records
+
+    CHECK(!BacpacTransfer_success()); // the central's first success starts the transfer
+    CHECK(send_chunk(received) == BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(BacpacTransfer_next(received) == BACPAC_TRANSFER_IDLE); // waits for the central
+
+    // the central asks for the chunk again
+    BacpacTransfer_error();
+    CHECK(send_chunk(received) == BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(!BacpacTransfer_success());
+    CHECK(send_chunk(received + BACPAC_TRANSFER_CHUNK_LENGTH) == BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(!BacpacTransfer_success());
+    CHECK(send_chunk(received + 2 * BACPAC_TRANSFER_CHUNK_LENGTH) == size - 2 * BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(BacpacTransfer_success());
+    CHECK(BacpacTransfer_next(received) == BACPAC_TRANSFER_IDLE);
+
+    for (int r = 0; r < size / BACPAC_PATTERN_RECORD_LENGTH; r++) {
+        uint32_t sequence;
+        CHECK(BacpacTransfer_checkRecord((uint8_t *) received + r * BACPAC_PATTERN_RECORD_LENGTH, &sequence));
+        CHECK(sequence == (uint32_t) r);
+    }
+
+    BacpacTransfer_getStats(&stats);
+    CHECK(stats.bytes == (uint32_t) size);
+    CHECK(stats.chunks == 3);
+    CHECK(stats.retries == 1);
+}
+
+static void test_pattern_sdus(void) {
+    static char received[1300];
+    struct BacpacTransferStats stats;
+    int size = BacpacTransfer_initializePattern(1200);
+
+    BacpacTransfer_success();
+    CHECK(BacpacTransfer_nextSdu(received, BACPAC_TRANSFER_SDU_LENGTH) == BACPAC_TRANSFER_SDU_LENGTH);
+    CHECK(BacpacTransfer_nextSdu(received, BACPAC_TRANSFER_SDU_LENGTH) == BACPAC_TRANSFER_IDLE); // one SDU per chunk
+
+    // the SDU didn't make it, the same bytes go out again
+    BacpacTransfer_error();
+    CHECK(BacpacTransfer_nextSdu(received, BACPAC_TRANSFER_SDU_LENGTH) == BACPAC_TRANSFER_SDU_LENGTH);
+    CHECK(!BacpacTransfer_success());
+    CHECK(BacpacTransfer_nextSdu(received + BACPAC_TRANSFER_SDU_LENGTH, BACPAC_TRANSFER_SDU_LENGTH) == BACPAC_TRANSFER_SDU_LENGTH);
+    CHECK(!BacpacTransfer_success());
+    CHECK(BacpacTransfer_nextSdu(received + 2 * BACPAC_TRANSFER_SDU_LENGTH, BACPAC_TRANSFER_SDU_LENGTH) == size - 2 * BACPAC_TRANSFER_SDU_LENGTH);
+    CHECK(BacpacTransfer_success());
+
+    for (int r = 0; r < size / BACPAC_PATTERN_RECORD_LENGTH; r++) {
+        uint32_t sequence;
+        CHECK(BacpacTransfer_checkRecord((uint8_t *) received + r * BACPAC_PATTERN_RECORD_LENGTH, &sequence));
+        CHECK(sequence == (uint32_t) r);
+    }
+    BacpacTransfer_getStats(&stats);
+    CHECK(stats.bytes == (uint32_t) size && stats.chunks == 3 && stats.retries == 1);
+}
+
+static void test_disk_commit(void) {
+    char data[700];
+    char received[BACPAC_TRANSFER_CHUNK_LENGTH];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_load() == DISK_SUCCESS);
+    for (int i = 0; i < (int) sizeof(data); i++) data[i] = i * 3;
+    CHECK(da_write(data, sizeof(data)) == DISK_SUCCESS);
+
+    CHECK(BacpacTransfer_initialize() == sizeof(data));
+    BacpacTransfer_success();
+    CHECK(send_chunk(received) == BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(memcmp(received, data, sizeof(received)) == 0);
+    CHECK(!BacpacTransfer_success());
+    CHECK(send_chunk(received) == sizeof(data) - BACPAC_TRANSFER_CHUNK_LENGTH);
+
+    // losing the last chunk sends it again instead of committing
+    BacpacTransfer_error();
+    CHECK(send_chunk(received) == sizeof(data) - BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(memcmp(received, data + BACPAC_TRANSFER_CHUNK_LENGTH, sizeof(data) - BACPAC_TRANSFER_CHUNK_LENGTH) == 0);
+    CHECK(BacpacTransfer_success());
+    CHECK(da_get_data_size() == 0);
+
+    // the read position was committed to sector 0
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_read_pos() == sizeof(data));
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+static void test_disk_resume(void) {
+    static char data[9000];
+    char received[BACPAC_TRANSFER_CHUNK_LENGTH];
+
+    unlink(IMAGE);
+    host_sd_set_image(IMAGE, 256);
+    CHECK(da_load() == DISK_SUCCESS);
+    for (int i = 0; i < (int) sizeof(data); i++) data[i] = i * 5;
+    CHECK(da_write(data, sizeof(data)) == DISK_SUCCESS);
+
+    CHECK(BacpacTransfer_initialize() == sizeof(data));
+    BacpacTransfer_success();
+    CHECK(send_chunk(received) == BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(!BacpacTransfer_success());
+    send_chunk(received);
+
+    // disconnected before the second chunk was acknowledged
+    CHECK(BacpacTransfer_resume() == sizeof(data) - BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(BacpacTransfer_getPosition() == BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(send_chunk(received) == BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(memcmp(received, data + BACPAC_TRANSFER_CHUNK_LENGTH, sizeof(received)) == 0);
+
+    // initialize doesn't skip the unacknowledged chunk either
+    CHECK(BacpacTransfer_initialize() == sizeof(data) - BACPAC_TRANSFER_CHUNK_LENGTH);
+    BacpacTransfer_success();
+    for (int c = 1; c <= BACPAC_TRANSFER_CHECKPOINT_CHUNKS; c++) {
+        CHECK(send_chunk(received) == BACPAC_TRANSFER_CHUNK_LENGTH);
+        CHECK(memcmp(received, data + c * BACPAC_TRANSFER_CHUNK_LENGTH, sizeof(received)) == 0);
+        CHECK(!BacpacTransfer_success());
+    }
+    send_chunk(received);
+
+    // after a reset the transfer starts from the checkpoint, taken at the 16th acknowledgement
+    CHECK(da_load() == DISK_SUCCESS);
+    CHECK(da_get_read_pos() == (BACPAC_TRANSFER_CHECKPOINT_CHUNKS + 1) * BACPAC_TRANSFER_CHUNK_LENGTH);
+    CHECK(da_get_data_size() == (int) sizeof(data) - da_get_read_pos());
+    CHECK(da_close() == DISK_SUCCESS);
+}
+
+const struct HostTest transfer_tests[] = {
+    { "transfer_pattern_records", test_pattern_records },
+    { "transfer_pattern_chunks", test_pattern_chunks },
+    { "transfer_pattern_sdus", test_pattern_sdus },
+    { "transfer_disk_commit", test_disk_commit },
+    { "transfer_disk_resume", test_disk_resume },
+    { NULL, NULL }
+};
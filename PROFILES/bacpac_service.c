@@ -49,6 +49,7 @@
 #include "bacpac_service.h"
 #include "Sensors/sensors.h"
 #include "Sensors/DiskAccess.h"
+#include "Sensors/LiveStream.h"
 
 /*********************************************************************
  * MACROS
@@ -71,6 +72,11 @@ Semaphore_Handle bacpac_channel_success_mutex;
 Semaphore_Handle bacpac_channel_error_mutex;
 Semaphore_Handle bacpac_channel_initialize_mutex;
 Semaphore_Handle bacpac_channel_failure_mutex;
+Semaphore_Handle bacpac_config_mutex;
+Semaphore_Handle bacpac_diagnostics_mutex;
+Semaphore_Handle bacpac_benchmark_mutex;
+Semaphore_Handle bacpac_pattern_mutex;
+Semaphore_Handle bacpac_resume_mutex;
 
 // bacpac_service Service UUID
 CONST uint8_t bacpac_serviceUUID[ATT_BT_UUID_SIZE] =
@@ -98,8 +104,22 @@ CONST uint8_t bacpac_service_VersionUUID[ATT_UUID_SIZE] =
 {
   TI_BASE_UUID_128(BACPAC_SERVICE_VERSION_UUID)
 };
+// live UUID
+CONST uint8_t bacpac_service_LiveUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(BACPAC_SERVICE_LIVE_UUID)
+};
+// config UUID
+CONST uint8_t bacpac_service_ConfigUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(BACPAC_SERVICE_CONFIG_UUID)
+};
+// diagnostics UUID
+CONST uint8_t bacpac_service_DiagnosticsUUID[ATT_UUID_SIZE] =
+{
+  TI_BASE_UUID_128(BACPAC_SERVICE_DIAGNOSTICS_UUID)
+};
 
-int remaining_data = -1;
 /*********************************************************************
  * LOCAL VARIABLES
  */
@@ -147,11 +167,45 @@ static uint8 bacpac_service_ExercisingDesc[11] = "Exercising";
 static uint8_t bacpac_service_VersionProps = GATT_PROP_READ;
 
 // Characteristic "Version" Value variable
-static uint8_t bacpac_service_VersionVal[BACPAC_SERVICE_VERSION_LEN] = {'B', 'A', 'C', '-','1', '.', '0', 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static uint8_t bacpac_service_VersionVal[BACPAC_SERVICE_VERSION_LEN] = {'B', 'A', 'C', '-','1', '.', '2', 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 // Characteristic "Version" description
 static uint8 bacpac_service_VersionDesc[8] = "Version";
 
+// Characteristic "Live" Properties (for declaration)
+static uint8_t bacpac_service_LiveProps = GATT_PROP_NOTIFY;
+
+// Characteristic "Live" Value variable. Frames are notified straight from the
+// live stream ring, so this is only a placeholder for the attribute table.
+static uint8_t bacpac_service_LiveVal[1] = { 0 };
+
+// Characteristic "Live" description
+static uint8 bacpac_service_LiveDesc[5] = "Live";
+
+// Characteristic "Live" CCCD
+static gattCharCfg_t *bacpac_service_LiveConfig;
+
+// Characteristic "Config" Properties (for declaration)
+static uint8_t bacpac_service_ConfigProps = GATT_PROP_READ | GATT_PROP_WRITE;
+
+// Characteristic "Config" Value variable. Holds the running acquisition config,
+// written configs are applied by the application task.
+static uint8_t bacpac_service_ConfigVal[BACPAC_SERVICE_CONFIG_LEN] = { 0 };
+
+// Characteristic "Config" description
+static uint8 bacpac_service_ConfigDesc[7] = "Config";
+
+// Characteristic "Diagnostics" Properties (for declaration)
+static uint8_t bacpac_service_DiagnosticsProps = GATT_PROP_READ | GATT_PROP_WRITE;
+
+// Characteristic "Diagnostics" Value variable. A written page number is
+// replaced by that page once the application task has filled it in.
+static uint8_t bacpac_service_DiagnosticsVal[BACPAC_SERVICE_DIAGNOSTICS_LEN] = { 0 };
+static uint16_t bacpac_service_DiagnosticsValLen = 1;
+
+// Characteristic "Diagnostics" description
+static uint8 bacpac_service_DiagnosticsDesc[12] = "Diagnostics";
+
 
 
 
@@ -159,7 +213,7 @@ static uint8 bacpac_service_VersionDesc[8] = "Version";
 * Profile Attributes - Table
 */
 
-static gattAttribute_t bacpac_serviceAttrTbl[14] =
+static gattAttribute_t bacpac_serviceAttrTbl[24] =
 {
   // bacpac_service Service Declaration
   {
@@ -259,8 +313,88 @@ static gattAttribute_t bacpac_serviceAttrTbl[14] =
         0,
         bacpac_service_VersionDesc
       },
+    // Live Characteristic Declaration
+    {
+      { ATT_BT_UUID_SIZE, characterUUID },
+      GATT_PERMIT_READ,
+      0,
+      &bacpac_service_LiveProps
+    },
+      // Live Characteristic Value
+      {
+        { ATT_UUID_SIZE, bacpac_service_LiveUUID },
+        0,
+        0,
+        bacpac_service_LiveVal
+      },
+      // Live Description
+      {
+        { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ,
+        0,
+        bacpac_service_LiveDesc
+      },
+      // Live CCCD
+      {
+        { ATT_BT_UUID_SIZE, clientCharCfgUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+        0,
+        (uint8 *)&bacpac_service_LiveConfig
+      },
+    // Config Characteristic Declaration
+    {
+      { ATT_BT_UUID_SIZE, characterUUID },
+      GATT_PERMIT_READ,
+      0,
+      &bacpac_service_ConfigProps
+    },
+      // Config Characteristic Value
+      {
+        { ATT_UUID_SIZE, bacpac_service_ConfigUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+        0,
+        bacpac_service_ConfigVal
+      },
+      // Config Description
+      {
+        { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ,
+        0,
+        bacpac_service_ConfigDesc
+      },
+    // Diagnostics Characteristic Declaration
+    {
+      { ATT_BT_UUID_SIZE, characterUUID },
+      GATT_PERMIT_READ,
+      0,
+      &bacpac_service_DiagnosticsProps
+    },
+      // Diagnostics Characteristic Value
+      {
+        { ATT_UUID_SIZE, bacpac_service_DiagnosticsUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+        0,
+        bacpac_service_DiagnosticsVal
+      },
+      // Diagnostics Description
+      {
+        { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ,
+        0,
+        bacpac_service_DiagnosticsDesc
+      },
 };
 
+// Index of the Channel and Live values in the attribute table, used to get their handles
+#define BACPAC_SERVICE_CHANNEL_VALUE_IDX  2
+#define BACPAC_SERVICE_LIVE_VALUE_IDX     15
+
+// Connection that subscribed to Channel notifications, set when its CCCD is written.
+// A bonded central gets its CCCDs restored without a write, AllocChannel looks it up then.
+static uint16_t bacpac_service_ChannelConnHandle = LINKDB_CONNHANDLE_INVALID;
+// Channel notification being filled between AllocChannel and NotifyChannel
+static attHandleValueNoti_t bacpac_service_ChannelNoti;
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -301,8 +435,15 @@ extern bStatus_t Bacpac_service_AddService( uint8_t rspTaskId )
      return ( bleMemAllocError );
    }
 
+   bacpac_service_LiveConfig = (gattCharCfg_t *)ICall_malloc( sizeof(gattCharCfg_t) * linkDBNumConns );
+   if ( bacpac_service_LiveConfig == NULL )
+   {
+     return ( bleMemAllocError );
+   }
+
    // Initialize Client Characteristic Configuration attributes
    GATTServApp_InitCharCfg( LINKDB_CONNHANDLE_INVALID, bacpac_service_ChannelConfig );
+   GATTServApp_InitCharCfg( LINKDB_CONNHANDLE_INVALID, bacpac_service_LiveConfig );
 
 
    // Register GATT attribute list and CBs with GATT Server App
@@ -390,6 +531,29 @@ bStatus_t Bacpac_service_SetParameter( uint8_t param, uint16_t len, void *value
       }
       break;
 
+    case BACPAC_SERVICE_CONFIG_ID:
+      if ( len == BACPAC_SERVICE_CONFIG_LEN )
+      {
+        memcpy(bacpac_service_ConfigVal, value, len);
+      }
+      else
+      {
+        ret = bleInvalidRange;
+      }
+      break;
+
+    case BACPAC_SERVICE_DIAGNOSTICS_ID:
+      if ( len > 0 && len <= BACPAC_SERVICE_DIAGNOSTICS_LEN )
+      {
+        memcpy(bacpac_service_DiagnosticsVal, value, len);
+        bacpac_service_DiagnosticsValLen = len;
+      }
+      else
+      {
+        ret = bleInvalidRange;
+      }
+      break;
+
     default:
       ret = INVALIDPARAMETER;
       break;
@@ -424,6 +588,17 @@ bStatus_t Bacpac_service_GetParameter( uint8_t param, uint16_t *len, void *value
       memcpy(value, bacpac_service_VersionVal, BACPAC_SERVICE_VERSION_LEN);
       break;
 
+    case BACPAC_SERVICE_CONFIG_ID:
+      *len = BACPAC_SERVICE_CONFIG_LEN;
+      memcpy(value, bacpac_service_ConfigVal, BACPAC_SERVICE_CONFIG_LEN);
+      break;
+
+    case BACPAC_SERVICE_DIAGNOSTICS_ID:
+      // the requested page number
+      *len = 1;
+      memcpy(value, bacpac_service_DiagnosticsVal, 1);
+      break;
+
     default:
       ret = INVALIDPARAMETER;
       break;
@@ -432,6 +607,184 @@ bStatus_t Bacpac_service_GetParameter( uint8_t param, uint16_t *len, void *value
 }
 
 
+/*
+ * Bacpac_service_GetLivePayloadSize - Number of bytes that fit in one Live
+ *          notification for the subscribed connection, 0 if nobody is subscribed.
+ */
+uint16_t Bacpac_service_GetLivePayloadSize(void)
+{
+  for ( uint8_t i = 0; i < linkDBNumConns; i++ )
+  {
+    uint16_t connHandle = bacpac_service_LiveConfig[i].connHandle;
+
+    if ( connHandle != LINKDB_CONNHANDLE_INVALID &&
+         ( bacpac_service_LiveConfig[i].value & GATT_CLIENT_CFG_NOTIFY ) )
+    {
+      // 3 bytes of every ATT PDU go to the opcode and handle
+      return MIN( ATT_GetMTU( connHandle ) - 3, BACPAC_SERVICE_LIVE_LEN );
+    }
+  }
+  return 0;
+}
+
+/*
+ * Bacpac_service_NotifyLive - Send one Live notification to every subscribed
+ *          connection.
+ */
+bStatus_t Bacpac_service_NotifyLive(uint8_t *pValue, uint16_t len)
+{
+  bStatus_t status = bleNotConnected;
+  uint8_t delivered = FALSE;
+
+  for ( uint8_t i = 0; i < linkDBNumConns; i++ )
+  {
+    uint16_t connHandle = bacpac_service_LiveConfig[i].connHandle;
+    attHandleValueNoti_t noti;
+
+    if ( connHandle == LINKDB_CONNHANDLE_INVALID ||
+         !( bacpac_service_LiveConfig[i].value & GATT_CLIENT_CFG_NOTIFY ) )
+    {
+      continue;
+    }
+
+    // A connection that can't take the frame misses it, the others still get
+    // it. Stopping here would make the caller resend it to the ones before.
+    noti.pValue = (uint8 *)GATT_bm_alloc( connHandle, ATT_HANDLE_VALUE_NOTI, len, NULL );
+    if ( noti.pValue == NULL )
+    {
+      status = bleMemAllocError;
+      continue;
+    }
+
+    noti.handle = bacpac_serviceAttrTbl[BACPAC_SERVICE_LIVE_VALUE_IDX].handle;
+    noti.len = len;
+    memcpy( noti.pValue, pValue, len );
+
+    status = GATT_Notification( connHandle, &noti, FALSE );
+    if ( status != SUCCESS )
+    {
+      GATT_bm_free( (gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI );
+    }
+    else
+    {
+      delivered = TRUE;
+    }
+  }
+
+  // the caller keeps the frame and retries only when nobody got it
+  return ( delivered ? SUCCESS : status );
+}
+
+
+/*
+ * Bacpac_service_SetCapabilities - Advertise optional features in the
+ *          Version characteristic.
+ */
+void Bacpac_service_SetCapabilities(uint8_t caps, uint16_t psm)
+{
+  bacpac_service_VersionVal[BACPAC_SERVICE_VERSION_CAPS_OFFSET] = caps;
+  bacpac_service_VersionVal[BACPAC_SERVICE_VERSION_PSM_OFFSET] = LO_UINT16( psm );
+  bacpac_service_VersionVal[BACPAC_SERVICE_VERSION_PSM_OFFSET + 1] = HI_UINT16( psm );
+}
+
+/*
+ * bacpac_service_FindChannelSubscriber - A connection that is up and has
+ *          Channel notifications enabled, LINKDB_CONNHANDLE_INVALID if none.
+ */
+static uint16_t bacpac_service_FindChannelSubscriber(void)
+{
+  for ( uint8_t i = 0; i < linkDBNumConns; i++ )
+  {
+    uint16_t connHandle = bacpac_service_ChannelConfig[i].connHandle;
+
+    if ( connHandle != LINKDB_CONNHANDLE_INVALID &&
+         ( bacpac_service_ChannelConfig[i].value & GATT_CLIENT_CFG_NOTIFY ) &&
+         linkDB_Up( connHandle ) )
+    {
+      return ( connHandle );
+    }
+  }
+  return ( LINKDB_CONNHANDLE_INVALID );
+}
+
+/*
+ * Bacpac_service_AllocChannel - Get a stack buffer for the next Channel
+ *          notification so the data can be read straight into it. A buffer
+ *          that was neither sent nor freed is handed out again.
+ */
+bStatus_t Bacpac_service_AllocChannel(uint8_t **ppValue)
+{
+  uint16_t connHandle = bacpac_service_ChannelConnHandle;
+
+  *ppValue = bacpac_service_ChannelNoti.pValue;
+  if ( *ppValue != NULL )
+  {
+    return ( SUCCESS );
+  }
+  if ( connHandle == LINKDB_CONNHANDLE_INVALID || !linkDB_Up( connHandle ) )
+  {
+    connHandle = bacpac_service_FindChannelSubscriber();
+    bacpac_service_ChannelConnHandle = connHandle;
+    if ( connHandle == LINKDB_CONNHANDLE_INVALID )
+    {
+      return ( bleNotConnected );
+    }
+  }
+
+  bacpac_service_ChannelNoti.pValue = (uint8 *)GATT_bm_alloc( connHandle, ATT_HANDLE_VALUE_NOTI,
+                                                              BACPAC_SERVICE_CHANNEL_LEN, NULL );
+  if ( bacpac_service_ChannelNoti.pValue == NULL )
+  {
+    return ( bleMemAllocError );
+  }
+
+  bacpac_service_ChannelNoti.handle = bacpac_serviceAttrTbl[BACPAC_SERVICE_CHANNEL_VALUE_IDX].handle;
+  bacpac_service_ChannelNoti.len = BACPAC_SERVICE_CHANNEL_LEN;
+  *ppValue = bacpac_service_ChannelNoti.pValue;
+  return ( SUCCESS );
+}
+
+/*
+ * Bacpac_service_NotifyChannel - Send the buffer of Bacpac_service_AllocChannel.
+ *          The buffer is kept when the stack doesn't take it, unless the
+ *          subscriber is gone.
+ */
+bStatus_t Bacpac_service_NotifyChannel(void)
+{
+  bStatus_t status;
+
+  if ( bacpac_service_ChannelNoti.pValue == NULL )
+  {
+    return ( INVALIDPARAMETER );
+  }
+
+  status = GATT_Notification( bacpac_service_ChannelConnHandle, &bacpac_service_ChannelNoti, FALSE );
+  if ( status == SUCCESS )
+  {
+    bacpac_service_ChannelNoti.pValue = NULL; // owned by the stack now
+  }
+  else if ( !linkDB_Up( bacpac_service_ChannelConnHandle ) )
+  {
+    Bacpac_service_FreeChannel();
+    status = bleNotConnected;
+  }
+  return ( status );
+}
+
+/*
+ * Bacpac_service_FreeChannel - Give back the buffer of Bacpac_service_AllocChannel
+ *          without sending it.
+ */
+void Bacpac_service_FreeChannel(void)
+{
+  if ( bacpac_service_ChannelNoti.pValue != NULL )
+  {
+    GATT_bm_free( (gattMsg_t *)&bacpac_service_ChannelNoti, ATT_HANDLE_VALUE_NOTI );
+    bacpac_service_ChannelNoti.pValue = NULL;
+  }
+}
+
+
 /*********************************************************************
  * @fn          bacpac_service_ReadAttrCB
  *
@@ -465,7 +818,6 @@ if ( ! memcmp(pAttr->type.uuid, bacpac_service_ChannelUUID, pAttr->type.len) )
       *pLen = MIN(maxLen, BACPAC_SERVICE_CHANNEL_LEN - offset);  // Transmit as much as possible
       memcpy(pValue, pAttr->pValue + offset, *pLen);
       //hello_world();
-      //if (remaining_data > 0) Semaphore_post(bacpac_channel_mutex);
     }
   }
   // See if request is regarding the Transferring Characteristic Value
@@ -507,6 +859,32 @@ else if ( ! memcmp(pAttr->type.uuid, bacpac_service_VersionUUID, pAttr->type.len
       memcpy(pValue, pAttr->pValue + offset, *pLen);
     }
   }
+  // See if request is regarding the Config Characteristic Value
+else if ( ! memcmp(pAttr->type.uuid, bacpac_service_ConfigUUID, pAttr->type.len) )
+  {
+    if ( offset > BACPAC_SERVICE_CONFIG_LEN )  // Prevent malicious ATT ReadBlob offsets.
+    {
+      status = ATT_ERR_INVALID_OFFSET;
+    }
+    else
+    {
+      *pLen = MIN(maxLen, BACPAC_SERVICE_CONFIG_LEN - offset);  // Transmit as much as possible
+      memcpy(pValue, pAttr->pValue + offset, *pLen);
+    }
+  }
+  // See if request is regarding the Diagnostics Characteristic Value
+  else if ( ! memcmp(pAttr->type.uuid, bacpac_service_DiagnosticsUUID, pAttr->type.len) )
+  {
+    if ( offset > bacpac_service_DiagnosticsValLen )  // Prevent malicious ATT ReadBlob offsets.
+    {
+      status = ATT_ERR_INVALID_OFFSET;
+    }
+    else
+    {
+      *pLen = MIN(maxLen, bacpac_service_DiagnosticsValLen - offset);  // Transmit as much as possible
+      memcpy(pValue, pAttr->pValue + offset, *pLen);
+    }
+  }
   else
   {
     // If we get here, that means you've forgotten to add an if clause for a
@@ -546,6 +924,24 @@ static bStatus_t bacpac_service_WriteAttrCB( uint16_t connHandle, gattAttribute_
     // Allow only notifications.
     status = GATTServApp_ProcessCCCWriteReq( connHandle, pAttr, pValue, len,
                                              offset, GATT_CLIENT_CFG_NOTIFY);
+
+    // Only fill the live ring while somebody listens to it
+    if ( status == SUCCESS && pAttr->pValue == (uint8 *)&bacpac_service_LiveConfig )
+    {
+      livestream_enable( BUILD_UINT16( pValue[0], pValue[1] ) & GATT_CLIENT_CFG_NOTIFY );
+    }
+    // Resolve the Channel subscriber once instead of on every offload packet
+    else if ( status == SUCCESS && pAttr->pValue == (uint8 *)&bacpac_service_ChannelConfig )
+    {
+      if ( BUILD_UINT16( pValue[0], pValue[1] ) & GATT_CLIENT_CFG_NOTIFY )
+      {
+        bacpac_service_ChannelConnHandle = connHandle;
+      }
+      else if ( connHandle == bacpac_service_ChannelConnHandle )
+      {
+        bacpac_service_ChannelConnHandle = LINKDB_CONNHANDLE_INVALID;
+      }
+    }
   }
   // See if request is regarding the Transferring Characteristic Value
   else if ( ! memcmp(pAttr->type.uuid, bacpac_service_TransferringUUID, pAttr->type.len) )
@@ -557,6 +953,9 @@ static bStatus_t bacpac_service_WriteAttrCB( uint16_t connHandle, gattAttribute_
     else
     {
       // Copy pValue into the variable we point to from the attribute table.
+      // A new command clears the arguments of the last one.
+      if ( offset == 0 )
+        memset(pAttr->pValue, 0, BACPAC_SERVICE_TRANSFERRING_LEN);
       memcpy(pAttr->pValue + offset, pValue, len);
 
       switch (pAttr->pValue[0]){
@@ -574,6 +973,19 @@ static bStatus_t bacpac_service_WriteAttrCB( uint16_t connHandle, gattAttribute_
       case 0x0a:
           Semaphore_post(bacpac_channel_failure_mutex);
           break;
+      case 0x0b:
+          // benchmark the SD card, results on the Diagnostics characteristic
+          Semaphore_post(bacpac_benchmark_mutex);
+          break;
+      case 0x0c:
+          // send a synthetic pattern over the Channel characteristic
+          if ( offset + len == BACPAC_SERVICE_TRANSFERRING_LEN || (offset == 0 && len == 1) )
+            Semaphore_post(bacpac_pattern_mutex);
+          break;
+      case 0x0d:
+          // pick the transfer up again after a disconnect
+          Semaphore_post(bacpac_resume_mutex);
+          break;
       };
       // Only notify application if entire expected value is written
       if ( offset + len == BACPAC_SERVICE_TRANSFERRING_LEN)
@@ -599,6 +1011,43 @@ static bStatus_t bacpac_service_WriteAttrCB( uint16_t connHandle, gattAttribute_
         paramID = BACPAC_SERVICE_EXERCISING_ID;
     }
   }
+  // See if request is regarding the Config Characteristic Value
+  else if ( ! memcmp(pAttr->type.uuid, bacpac_service_ConfigUUID, pAttr->type.len) )
+  {
+    if ( offset + len > BACPAC_SERVICE_CONFIG_LEN )
+    {
+      status = ATT_ERR_INVALID_OFFSET;
+    }
+    else
+    {
+      // Copy pValue into the variable we point to from the attribute table.
+      memcpy(pAttr->pValue + offset, pValue, len);
+
+      // The config is bigger than one ATT payload at the default MTU, so it
+      // can arrive as a long write. Apply it once the last part is in.
+      if ( offset + len == BACPAC_SERVICE_CONFIG_LEN)
+      {
+        Semaphore_post(bacpac_config_mutex);
+        paramID = BACPAC_SERVICE_CONFIG_ID;
+      }
+    }
+  }
+  // See if request is regarding the Diagnostics Characteristic Value
+  else if ( ! memcmp(pAttr->type.uuid, bacpac_service_DiagnosticsUUID, pAttr->type.len) )
+  {
+    if ( offset != 0 || len != 1 )
+    {
+      status = ATT_ERR_INVALID_VALUE_SIZE;
+    }
+    else
+    {
+      // Keep only the page number until the application task has filled the page in
+      pAttr->pValue[0] = pValue[0];
+      bacpac_service_DiagnosticsValLen = 1;
+      Semaphore_post(bacpac_diagnostics_mutex);
+      paramID = BACPAC_SERVICE_DIAGNOSTICS_ID;
+    }
+  }
   else
   {
     // If we get here, that means you've forgotten to add an if clause for a
@@ -50,12 +50,18 @@ extern "C"
  */
 
 #include <ti/sysbios/knl/Semaphore.h>
+#include "Sensors/Config.h"
+#include "Sensors/Diagnostics.h"
 extern Semaphore_Handle bacpac_channel_mutex;
 extern Semaphore_Handle bacpac_channel_success_mutex;
 extern Semaphore_Handle bacpac_channel_error_mutex;
 extern Semaphore_Handle bacpac_channel_failure_mutex;
 extern Semaphore_Handle bacpac_channel_initialize_mutex;
-extern int remaining_data;
+extern Semaphore_Handle bacpac_config_mutex;
+extern Semaphore_Handle bacpac_diagnostics_mutex;
+extern Semaphore_Handle bacpac_benchmark_mutex;
+extern Semaphore_Handle bacpac_pattern_mutex;
+extern Semaphore_Handle bacpac_resume_mutex;
 
 /*********************************************************************
 * CONSTANTS
@@ -71,7 +77,7 @@ extern int remaining_data;
 //  Characteristic defines
 #define BACPAC_SERVICE_TRANSFERRING_ID   1
 #define BACPAC_SERVICE_TRANSFERRING_UUID 0xBAC2
-#define BACPAC_SERVICE_TRANSFERRING_LEN  1
+#define BACPAC_SERVICE_TRANSFERRING_LEN  5  // command, then the uint32 pattern size for 0x0c or the read cursor for 0x07 and 0x0d
 
 //  Characteristic defines
 #define BACPAC_SERVICE_EXERCISING_ID   2
@@ -82,6 +88,25 @@ extern int remaining_data;
 #define BACPAC_SERVICE_VERSION_ID   3
 #define BACPAC_SERVICE_VERSION_UUID 0xBAC4
 #define BACPAC_SERVICE_VERSION_LEN  16
+// Version is a NUL terminated string, the bytes after it say what the firmware supports
+#define BACPAC_SERVICE_VERSION_CAPS_OFFSET  8   // uint8_t BACPAC_SERVICE_CAP_* flags
+#define BACPAC_SERVICE_VERSION_PSM_OFFSET   10  // uint16_t PSM of the offload channel, little endian
+#define BACPAC_SERVICE_CAP_L2CAP_COC        0x01
+
+//  Characteristic defines
+#define BACPAC_SERVICE_LIVE_ID      4
+#define BACPAC_SERVICE_LIVE_UUID    0xBAC5
+#define BACPAC_SERVICE_LIVE_LEN     160 // largest notification we build, capped again by the ATT MTU
+
+//  Characteristic defines
+#define BACPAC_SERVICE_CONFIG_ID    5
+#define BACPAC_SERVICE_CONFIG_UUID  0xBAC6
+#define BACPAC_SERVICE_CONFIG_LEN   CONFIG_SIZE // struct AcquisitionConfig
+
+//  Characteristic defines
+#define BACPAC_SERVICE_DIAGNOSTICS_ID   6
+#define BACPAC_SERVICE_DIAGNOSTICS_UUID 0xBAC7
+#define BACPAC_SERVICE_DIAGNOSTICS_LEN  (DIAGNOSTICS_MAX_PAGE_SIZE + 1) // page number, then the page
 
 /*********************************************************************
  * TYPEDEFS
@@ -149,6 +174,58 @@ extern bStatus_t Bacpac_service_SetParameter(uint8_t param, uint16_t len, void *
  */
 extern bStatus_t Bacpac_service_GetParameter(uint8_t param, uint16_t *len, void *value);
 
+/*
+ * Bacpac_service_GetLivePayloadSize - Number of bytes that fit in one Live
+ *          notification for the subscribed connection, 0 if nobody is subscribed.
+ */
+extern uint16_t Bacpac_service_GetLivePayloadSize(void);
+
+/*
+ * Bacpac_service_NotifyLive - Send one Live notification to every subscribed
+ *          connection.
+ *
+ *    pValue - frame bytes to send
+ *    len - number of bytes, at most Bacpac_service_GetLivePayloadSize()
+ *
+ *    Returns SUCCESS when the stack accepted the notification for at least
+ *    one connection, a connection that was out of buffers misses the frame.
+ *    Otherwise the caller can keep the bytes queued and retry.
+ */
+extern bStatus_t Bacpac_service_NotifyLive(uint8_t *pValue, uint16_t len);
+
+/*
+ * Bacpac_service_SetCapabilities - Advertise optional features in the
+ *          Version characteristic.
+ *
+ *    caps - BACPAC_SERVICE_CAP_* flags
+ *    psm - PSM of the L2CAP offload channel, 0 without BACPAC_SERVICE_CAP_L2CAP_COC
+ */
+extern void Bacpac_service_SetCapabilities(uint8_t caps, uint16_t psm);
+
+/*
+ * Bacpac_service_AllocChannel - Get a stack buffer of BACPAC_SERVICE_CHANNEL_LEN
+ *          bytes for the next Channel notification. The offload fills it in
+ *          place and sends it with Bacpac_service_NotifyChannel, or gives it
+ *          back with Bacpac_service_FreeChannel. One buffer at a time.
+ *
+ *    ppValue - set to the buffer, NULL when none was allocated
+ *
+ *    Returns bleNotConnected when nobody is subscribed to Channel and
+ *    bleMemAllocError when the stack is out of buffers.
+ */
+extern bStatus_t Bacpac_service_AllocChannel(uint8_t **ppValue);
+
+/*
+ * Bacpac_service_NotifyChannel - Send the buffer of Bacpac_service_AllocChannel
+ *          to the subscribed connection. When the stack doesn't take it the
+ *          buffer and its bytes are kept, AllocChannel hands it out again to
+ *          send it once more. It is freed and bleNotConnected returned once
+ *          the subscriber's link is down.
+ */
+extern bStatus_t Bacpac_service_NotifyChannel(void);
+
+extern void Bacpac_service_FreeChannel(void);
+
 
 extern Semaphore_Handle bacpac_channel_mutex;
 /*********************************************************************
@@ -67,6 +67,7 @@
 #include "icall_ble_api.h"
 
 #include "peripheral.h"
+#include "Sensors/Telemetry.h"
 
 /*********************************************************************
  * MACROS
@@ -828,6 +829,7 @@ void GAPRole_createTask(void)
   taskParams.priority = GAPROLE_TASK_PRIORITY;
 
   Task_construct(&gapRoleTask, gapRole_taskFxn, &taskParams, NULL);
+  telemetry_register_task(Task_handle(&gapRoleTask), "gap");
 }
 
 /*********************************************************************
@@ -0,0 +1,54 @@
+#include "BlockPool.h"
+#include <stddef.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+static union {
+    uint32_t align;
+    char bytes[BLOCKPOOL_NUM_BLOCKS][BLOCKPOOL_BLOCK_SIZE];
+} pool;
+
+static uint8_t run_length[BLOCKPOOL_NUM_BLOCKS]; // blocks taken starting at this one, 0 when free
+static uint8_t free_blocks = BLOCKPOOL_NUM_BLOCKS;
+static uint8_t min_free = BLOCKPOOL_NUM_BLOCKS;
+
+void* blockpool_alloc(uint8_t count) {
+    void* block = NULL;
+    uint8_t start = 0;
+    uint8_t i;
+
+    if (count == 0 || count > BLOCKPOOL_NUM_BLOCKS) return NULL;
+
+    UInt key = Hwi_disable();
+    while (start + count <= BLOCKPOOL_NUM_BLOCKS && !block) {
+        for (i = 0; i < count && !run_length[start + i]; i++);
+        if (i == count) {
+            for (i = 0; i < count; i++) run_length[start + i] = count - i;
+            free_blocks -= count;
+            if (free_blocks < min_free) min_free = free_blocks;
+            block = pool.bytes[start];
+        }
+        else start += i + run_length[start + i]; // skip past the taken run
+    }
+    Hwi_restore(key);
+
+    return block;
+}
+
+void blockpool_free(void* block) {
+    if (!block) return;
+
+    uint8_t start = ((char*) block - pool.bytes[0]) / BLOCKPOOL_BLOCK_SIZE;
+    UInt key = Hwi_disable();
+    uint8_t count = run_length[start];
+    for (uint8_t i = 0; i < count; i++) run_length[start + i] = 0;
+    free_blocks += count;
+    Hwi_restore(key);
+}
+
+uint8_t blockpool_get_free() {
+    return free_blocks;
+}
+
+uint8_t blockpool_get_min_free() {
+    return min_free;
+}
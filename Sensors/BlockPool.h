@@ -0,0 +1,23 @@
+#ifndef BLOCKPOOL_H
+#define BLOCKPOOL_H
+
+#include <stdint.h>
+#include "MemoryPlan.h"
+
+// Fixed pool of MEMORY_POOL_BLOCKS blocks of MEMORY_SECTOR_SIZE bytes. A caller
+// can take several blocks in a row for multi-sector transfers. Safe to use
+// from any task.
+
+#define BLOCKPOOL_BLOCK_SIZE    MEMORY_SECTOR_SIZE
+#define BLOCKPOOL_NUM_BLOCKS    MEMORY_POOL_BLOCKS
+
+// count consecutive blocks, NULL when there aren't that many free in a row
+void* blockpool_alloc(uint8_t count);
+// gives back all the blocks taken with the alloc that returned block
+void blockpool_free(void* block);
+
+uint8_t blockpool_get_free();
+// fewest blocks ever free at once
+uint8_t blockpool_get_min_free();
+
+#endif
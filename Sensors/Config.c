@@ -0,0 +1,102 @@
+#include "Config.h"
+#include "Filter.h"
+
+// filter off and every frame logged, what the firmware did before version 3
+static void config_defaultFilter(struct AcquisitionConfig* config) {
+    config->flags &= ~CONFIG_FLAG_DEADBAND;
+    config->filterMedian = 0;
+    config->filterIirShift = 0;
+    config->filterOutputRate = 0;
+    config->deadband = 50;
+    config->keyframeInterval = 600;
+    config->heartbeatInterval = 50;
+}
+
+void config_default(struct AcquisitionConfig* config) {
+    config->version = CONFIG_VERSION;
+    config->flags = CONFIG_FLAG_FOURTYEIGHT;
+    config->muxFreq = 800;
+    config->lowCutsHigh = 2730;
+    config->highCutsHigh = 2770;
+    config->lowCutsLow = 2250;
+    config->highCutsLow = 2500;
+    config->lowCutsHighThree = 2200;
+    config->highCutsHighThree = 2700;
+    config->lowCutsLowThree = 1000;
+    config->highCutsLowThree = 2600;
+    /*
+     * Acquisition schedule. Each slot runs one mode for a number of full 16 channel frames before the next slot starts.
+     * Impedance reads one channel every 3 DACtimerCallbacks, EMG reads one on every DACtimerCallback (keep EMG
+     * cycles per output a multiple of 3). Interleaving fast EMG with slow impedance looks like
+     * { ACQ_MODE_EMG, 6, 8 }, { ACQ_MODE_IMPEDANCE, 5, 1 }
+     */
+    config->numSlots = 1;
+    config->reserved = 0;
+    for (uint8_t i = 0; i < CONFIG_MAX_SLOTS; i++) {
+        config->slots[i].mode = ACQ_MODE_IMPEDANCE;
+        config->slots[i].cyclesPerOutput = 5;
+        config->slots[i].frames = 1;
+    }
+    config->burstPeriod = 0;
+    config->burstFrames = 0;
+    config->reserved2 = 0;
+    config_defaultFilter(config);
+}
+
+uint8_t config_upgrade(struct AcquisitionConfig* config) {
+    switch (config->version) {
+    case 1:
+        config->burstPeriod = 0; // records continuously like it did before
+        config->burstFrames = 0;
+        config->reserved2 = 0;
+        // fall through
+    case 2:
+        config_defaultFilter(config);
+        // fall through
+    case CONFIG_VERSION:
+        config->version = CONFIG_VERSION;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// seconds one burst takes at the slowest slot of the schedule, rounded up
+static uint32_t config_burstSeconds(const struct AcquisitionConfig* config) {
+    uint32_t reads = 0;
+
+    for (uint8_t i = 0; i < config->numSlots; i++) {
+        uint32_t slotReads = (uint32_t) config->slots[i].cyclesPerOutput * 16;
+        if (config->slots[i].mode == ACQ_MODE_IMPEDANCE) slotReads *= 3; // 3 timer ticks per impedance read, EMG reads on every tick
+        if (slotReads > reads) reads = slotReads;
+    }
+    return (reads * config->burstFrames + config->muxFreq * 3 - 1) / (config->muxFreq * 3);
+}
+
+static uint8_t config_validCutoffs(uint16_t low, uint16_t high) {
+    return low <= high && high <= CONFIG_MAX_ADC;
+}
+
+uint8_t config_validate(const struct AcquisitionConfig* config) {
+    if (config->version != CONFIG_VERSION) return 0;
+    if ((config->flags & CONFIG_FLAG_CALIBRATE) && (config->flags & CONFIG_FLAG_FOURTYEIGHT)) return 0; // both start the timers on power up
+    if (config->muxFreq < CONFIG_MIN_MUXFREQ || config->muxFreq > CONFIG_MAX_MUXFREQ) return 0;
+    if (!config_validCutoffs(config->lowCutsHigh, config->highCutsHigh)) return 0;
+    if (!config_validCutoffs(config->lowCutsLow, config->highCutsLow)) return 0;
+    if (!config_validCutoffs(config->lowCutsHighThree, config->highCutsHighThree)) return 0;
+    if (!config_validCutoffs(config->lowCutsLowThree, config->highCutsLowThree)) return 0;
+    if (config->numSlots == 0 || config->numSlots > CONFIG_MAX_SLOTS) return 0;
+
+    for (uint8_t i = 0; i < config->numSlots; i++) {
+        if (config->slots[i].mode > ACQ_MODE_EMG) return 0;
+        if (config->slots[i].cyclesPerOutput == 0 || config->slots[i].frames == 0) return 0;
+    }
+    if (config->burstPeriod) {
+        if (config->burstPeriod > CONFIG_MAX_BURST_PERIOD || config->burstFrames == 0) return 0;
+        if (config_burstSeconds(config) >= config->burstPeriod) return 0; // bursts have to leave time to sleep
+    }
+    if (config->filterMedian > 1 || config->filterIirShift > FILTER_MAX_SHIFT) return 0;
+    if (config->filterOutputRate > config->muxFreq) return 0;
+    if ((config->flags & CONFIG_FLAG_DEADBAND) && (config->keyframeInterval == 0 || config->heartbeatInterval == 0)) return 0;
+    return 1;
+}
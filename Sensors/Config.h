@@ -0,0 +1,66 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Scheduler.h"
+
+// Runtime acquisition settings. The struct is sent as is over the BACPAC
+// Config characteristic and saved in SNV, so fields are laid out without
+// padding and only ever appended to (bump CONFIG_VERSION when they change).
+
+#define CONFIG_VERSION          3
+#define CONFIG_MAX_SLOTS        4
+
+#define CONFIG_FLAG_CALIBRATE   0x01 // run the calibration code instead of recording
+#define CONFIG_FLAG_FOURTYEIGHT 0x02 // 48 hour code, start recording to the SD card on power up
+#define CONFIG_FLAG_FAT_EXPORT  0x04 // record into the session files of a FAT32 volume, see FatExport.h
+#define CONFIG_FLAG_DEADBAND    0x08 // only write channels to the SD card when they leave the deadband, see Serializer.h
+// decide what Sensors_init does on power up, a running board keeps the ones it booted with
+#define CONFIG_FLAGS_BOOT       (CONFIG_FLAG_CALIBRATE | CONFIG_FLAG_FOURTYEIGHT | CONFIG_FLAG_FAT_EXPORT)
+
+#define CONFIG_MIN_MUXFREQ      16
+#define CONFIG_MAX_MUXFREQ      800  // limited by the adc sampling duration in CC2640R2_LAUNCHXL.c
+#define CONFIG_MAX_ADC          4095
+#define CONFIG_MAX_BURST_PERIOD 3600 // seconds
+
+struct AcquisitionConfig {
+    uint8_t version;             // CONFIG_VERSION
+    uint8_t flags;               // CONFIG_FLAG_*
+    uint16_t muxFreq;            // channels read per second, sets the GPTimer load value
+    uint16_t lowCutsHigh;        // p controller cutoffs for high tap values
+    uint16_t highCutsHigh;
+    uint16_t lowCutsLow;         // p controller cutoffs for low tap values
+    uint16_t highCutsLow;
+    uint16_t lowCutsHighThree;   // same cutoffs for the v1.31 board
+    uint16_t highCutsHighThree;
+    uint16_t lowCutsLowThree;
+    uint16_t highCutsLowThree;
+    uint8_t numSlots;            // acquisition schedule, see Scheduler.h
+    uint8_t reserved;
+    struct AcquisitionSlot slots[CONFIG_MAX_SLOTS];
+    // version 2: duty cycled recording. Every burstPeriod seconds the front end is powered for
+    // burstFrames full frames, in between the board can go to standby. 0 records continuously.
+    uint16_t burstPeriod;
+    uint8_t burstFrames;
+    uint8_t reserved2;
+    // version 3: filter in front of the serializer (Filter.h) and change triggered logging (CONFIG_FLAG_DEADBAND)
+    uint8_t filterMedian;        // 1 runs median-of-3 spike rejection on every average
+    uint8_t filterIirShift;      // smoothing of the first order IIR (y += (x - y) >> shift), 0 turns it off
+    uint16_t filterOutputRate;   // outputs per second per channel, each the mean of the averages since the last one. 0 outputs every average
+    uint16_t deadband;           // in ohms, or millivolts for EMG
+    uint16_t keyframeInterval;   // frames between two frames holding all 16 channels
+    uint16_t heartbeatInterval;  // frames without a change before a timestamp-only frame is written
+};
+
+#define CONFIG_SIZE sizeof(struct AcquisitionConfig)
+#define CONFIG_V1_SIZE offsetof(struct AcquisitionConfig, burstPeriod)
+#define CONFIG_V2_SIZE offsetof(struct AcquisitionConfig, filterMedian)
+
+void config_default(struct AcquisitionConfig* config);
+// fills in the fields appended after the version a saved config was written with, returns 0 for an unknown version
+uint8_t config_upgrade(struct AcquisitionConfig* config);
+// returns 1 when every field is in range and the config can be applied
+uint8_t config_validate(const struct AcquisitionConfig* config);
+
+#endif
@@ -0,0 +1,53 @@
+#include "Diagnostics.h"
+#include "Profiler.h"
+#include "sensors.h"
+#include "DiskAccess.h"
+#include "Telemetry.h"
+#include "PowerModel.h"
+#include <string.h>
+
+uint16_t diagnostics_read_page(uint8_t page, uint8_t* buffer, uint16_t maxLength) {
+    if (page == DIAGNOSTICS_PAGE_PROFILER) {
+        struct ProfilerSummary summary;
+        if (maxLength < sizeof(summary)) return 0;
+        profiler_get_summary(&summary);
+        memcpy(buffer, &summary, sizeof(summary));
+        return sizeof(summary);
+    }
+    if (page >= DIAGNOSTICS_PAGE_PROFILER_STAGE && page < DIAGNOSTICS_PAGE_PROFILER_STAGE + PROFILER_NUM_STAGES) {
+        struct ProfilerStage stats;
+        if (maxLength < sizeof(stats)) return 0;
+        profiler_get_stage(page - DIAGNOSTICS_PAGE_PROFILER_STAGE, &stats);
+        memcpy(buffer, &stats, sizeof(stats));
+        return sizeof(stats);
+    }
+    if (page == DIAGNOSTICS_PAGE_STATS) {
+        struct PipelineStats stats;
+        if (maxLength < sizeof(stats)) return 0;
+        Sensors_get_stats(&stats);
+        memcpy(buffer, &stats, sizeof(stats));
+        return sizeof(stats);
+    }
+    if (page == DIAGNOSTICS_PAGE_DISK_BENCHMARK) {
+        struct DiskBenchmark benchmark;
+        if (maxLength < sizeof(benchmark)) return 0;
+        da_get_benchmark(&benchmark);
+        memcpy(buffer, &benchmark, sizeof(benchmark));
+        return sizeof(benchmark);
+    }
+    if (page == DIAGNOSTICS_PAGE_TELEMETRY) {
+        struct Telemetry telemetry;
+        if (maxLength < sizeof(telemetry)) return 0;
+        telemetry_get(&telemetry);
+        memcpy(buffer, &telemetry, sizeof(telemetry));
+        return sizeof(telemetry);
+    }
+    if (page == DIAGNOSTICS_PAGE_POWER) {
+        struct PowerEstimate estimate;
+        if (maxLength < sizeof(estimate)) return 0;
+        power_get(&estimate);
+        memcpy(buffer, &estimate, sizeof(estimate));
+        return sizeof(estimate);
+    }
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdint.h>
+
+// Pages served by the BACPAC Diagnostics characteristic. A client writes the page
+// number, the application fills the value with the page number followed by the page.
+// Everything is little endian, as laid out in memory.
+
+#define DIAGNOSTICS_PAGE_PROFILER       0x00 // struct ProfilerSummary
+#define DIAGNOSTICS_PAGE_PROFILER_STAGE 0x01 // 0x01 + PROFILER_* stage, struct ProfilerStage
+#define DIAGNOSTICS_PAGE_STATS          0x10 // struct PipelineStats of the current recording
+#define DIAGNOSTICS_PAGE_DISK_BENCHMARK 0x20 // struct DiskBenchmark of the last da_benchmark
+#define DIAGNOSTICS_PAGE_TELEMETRY      0x30 // struct Telemetry of the last sample
+#define DIAGNOSTICS_PAGE_POWER          0x40 // struct PowerEstimate of the current recording
+
+#define DIAGNOSTICS_MAX_PAGE_SIZE       96
+
+// copies the page into buffer, returns its length or 0 for an unknown page
+uint16_t diagnostics_read_page(uint8_t page, uint8_t* buffer, uint16_t maxLength);
+
+#endif
@@ -2,104 +2,343 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include "BlockPool.h"
+#include "FatExport.h"
 
 static SD_Handle sdHandle;
 static unsigned long write_pos; // unsigned longs can't handle total possible positions in sd card. Need to switch to a write_sector and write_pos values
-static unsigned long read_pos; // same for read
 static unsigned int sector_size;
 static unsigned int num_sectors;
 static unsigned char dirty;
+static unsigned int cur_sector_num = -1; // sector in txn_buffer, -1 when there is none
 static unsigned long long total_size;
 static char* txn_buffer;
-
-static unsigned long soft_read_pos;
+static DaIndexFxn index_fxn;
+static unsigned char locked;
+static struct DiskBenchmark last_benchmark;
+static uint32_t generation; // of the superblock on the card
+
+// where the superblock copies, the data ring and the benchmark sectors are on the card, see da_load
+static unsigned long superblock_sector[2];
+static unsigned long data_sector;
+static unsigned long bench_sector;
+static struct FatExportVolume volume;
+static unsigned char exported;          // the card holds a FAT export volume, see FatExport.h
+static uint32_t export_file_sectors;    // da_set_export
+static uint16_t export_files;
+
+// every consumer reads the log at its own pace, the default cursor is always attached.
+// The application task selects, advances and commits its cursor while the storage task
+// writes, clears and checkpoints, so the cursors and write_pos are changed, and read more
+// than one field at a time, with interrupts off.
+struct DaCursor {
+    unsigned long read_pos;         // see write_pos
+    unsigned long soft_read_pos;
+    unsigned char attached;         // holds the log back until it has read it
+};
+static struct DaCursor cursors[DA_CURSORS] = { { 0, 0, 1 } };
+static struct DaCursor* cursor = &cursors[DA_CURSOR_DEFAULT];
 
 // read when there's nothing left to read and write when out of space errors
 // change function names to match sdraw
 
 int da_initialize() {
     SD_init();
-    soft_read_pos = 0;
+    cursor->soft_read_pos = 0;
     return DISK_SUCCESS;
 }
 
-int da_load() {
-    int delimiter = 0;
-    //int result = 0;
+// oldest position an attached cursor still has to read, nothing before it is needed anymore
+static unsigned long da_get_tail() {
+    UInt key = Hwi_disable();
+    unsigned long tail = write_pos;
+    int c;
 
-    sdHandle = SD_open(Board_SD0, NULL);
-    if (sdHandle == NULL) return DISK_NULL_HANDLE;
+    for (c = 0; c < DA_CURSORS; c++) {
+        if (cursors[c].attached && cursors[c].soft_read_pos < tail) tail = cursors[c].soft_read_pos;
+    }
+    Hwi_restore(key);
+    return tail;
+}
 
+static uint32_t da_crc32(const char* data, int length) {
+    uint32_t crc = 0xFFFFFFFF;
+    int bit;
 
-    int_fast8_t status = SD_initialize(sdHandle);
-    if (status != SD_STATUS_SUCCESS) return DISK_FAILED_INIT;
+    while (length--) {
+        crc ^= (uint8_t) *data++;
+        for (bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return ~crc;
+}
 
-    sector_size = SD_getSectorSize(sdHandle);
-    num_sectors = SD_getNumSectors(sdHandle) - 1;
-    txn_buffer = (char *) malloc(sector_size * sizeof(char));
-    total_size = sector_size * num_sectors;
-    status = SD_read(sdHandle, txn_buffer, 0, 1);
-//    print(txn_buffer);
-    if (status != SD_STATUS_SUCCESS) {
-        return DISK_FAILED_READ;
+// returns 1 and fills superblock when the sector in txn_buffer holds a valid copy
+static int da_check_superblock(struct DaSuperblock* superblock) {
+    uint32_t crc;
+
+    memcpy(superblock, txn_buffer, sizeof(*superblock));
+    if (superblock->magic != DA_SUPERBLOCK_MAGIC || superblock->version < DA_SUPERBLOCK_VERSION) return 0;
+    if (superblock->length < offsetof(struct DaSuperblock, crc) || superblock->length > DA_INDEX_EXTRA_OFFSET - sizeof(crc)) return 0;
+    memcpy(&crc, txn_buffer + superblock->length, sizeof(crc));
+    return crc == da_crc32(txn_buffer, superblock->length);
+}
+
+// the older of two valid copies loses, generations wrap around
+static int da_newer(const struct DaSuperblock* a, const struct DaSuperblock* b) {
+    return (int32_t) (a->generation - b->generation) > 0;
+}
+
+static void da_apply_superblock(const struct DaSuperblock* superblock) {
+    UInt key = Hwi_disable();
+    int c;
+
+    generation = superblock->generation;
+    write_pos = superblock->writePos;
+    for (c = 0; c < DA_CURSORS; c++) {
+        cursors[c].attached = c == DA_CURSOR_DEFAULT || (superblock->attached & (1 << c));
+        cursors[c].read_pos = cursors[c].attached ? superblock->readPos[c] : 0;
+        cursors[c].soft_read_pos = cursors[c].read_pos;
     }
+    Hwi_restore(key);
+}
 
-    int i = 0;
-    while (i < sector_size) {
-        if (txn_buffer[i] == ':') {
-            delimiter = i;
-            break;
+// the old ASCII index: "write_pos:read_pos" of the default cursor, then ";cursor:read_pos" for every other attached one
+static void da_parse_index() {
+    char* field = strchr(txn_buffer, ':');
+    UInt key = Hwi_disable();
+    int c;
+
+    for (c = 0; c < DA_CURSORS; c++) {
+        cursors[c].attached = (c == DA_CURSOR_DEFAULT);
+        cursors[c].read_pos = 0;
+    }
+    if (field && field < txn_buffer + DA_INDEX_EXTRA_OFFSET) {
+        write_pos = atoi(txn_buffer);
+        cursors[DA_CURSOR_DEFAULT].read_pos = atoi(field + 1);
+        while ((field = strchr(field, ';')) != NULL && field < txn_buffer + DA_INDEX_EXTRA_OFFSET) {
+            c = atoi(++field);
+            char* pos = strchr(field, ':');
+            if (c <= DA_CURSOR_DEFAULT || c >= DA_CURSORS || pos == NULL) break;
+            cursors[c].read_pos = atoi(pos + 1);
+            cursors[c].attached = 1;
         }
-        ++i;
     }
+    else write_pos = 0;
 
-    if (delimiter) {
-        write_pos = atoi(txn_buffer);
-        read_pos = atoi(txn_buffer + delimiter + 1);
+    for (c = 0; c < DA_CURSORS; c++) cursors[c].soft_read_pos = cursors[c].read_pos;
+    Hwi_restore(key);
+}
+
+// the raw layout has copy A in sector 0, then the data ring, copy B and the benchmark sectors at the end
+static void da_set_layout() {
+    if (exported) {
+        superblock_sector[0] = volume.superblock[0];
+        superblock_sector[1] = volume.superblock[1];
+        data_sector = volume.data;
+        num_sectors = volume.files * volume.fileSectors;
+        bench_sector = volume.bench;
     }
     else {
-        write_pos = 0;
-        read_pos = 0;
+        superblock_sector[0] = 0;
+        data_sector = 1;
+        num_sectors = SD_getNumSectors(sdHandle) - 1 - DA_RAW_TAIL_SECTORS;
+        superblock_sector[1] = data_sector + num_sectors;
+        bench_sector = superblock_sector[1] + 1;
+    }
+    total_size = sector_size * num_sectors;
+}
+
+// takes the newest valid superblock copy, or the old ASCII index in copy A
+static int da_load_superblock() {
+    struct DaSuperblock a, b;
+
+    if (SD_read(sdHandle, txn_buffer, superblock_sector[1], 1) != SD_STATUS_SUCCESS) return DISK_FAILED_READ;
+    int validB = da_check_superblock(&b);
+    if (SD_read(sdHandle, txn_buffer, superblock_sector[0], 1) != SD_STATUS_SUCCESS) return DISK_FAILED_READ;
+    int validA = da_check_superblock(&a);
+
+    if (validA && (!validB || da_newer(&a, &b))) da_apply_superblock(&a);
+    else if (validB) da_apply_superblock(&b);
+    else {
+        generation = 0;
+        txn_buffer[DA_INDEX_EXTRA_OFFSET - 1] = '\0';
+        da_parse_index();
+    }
+    return DISK_SUCCESS;
+}
+
+int da_load() {
+    //int result = 0;
+
+    if (sdHandle) SD_close(sdHandle); // loading again, e.g. a card that failed the last load
+    sdHandle = SD_open(Board_SD0, NULL);
+    if (sdHandle == NULL) return DISK_NULL_HANDLE;
+
+
+    int_fast8_t status = SD_initialize(sdHandle);
+    if (status != SD_STATUS_SUCCESS) {
+        // no card, everything else sees the null handle
+        SD_close(sdHandle);
+        sdHandle = NULL;
+        return DISK_FAILED_INIT;
     }
-    cur_sector_num = -1;
 
+    sector_size = SD_getSectorSize(sdHandle);
+    if (sector_size > BLOCKPOOL_BLOCK_SIZE) return DISK_NO_MEMORY;
+    if (txn_buffer == NULL) txn_buffer = (char *) blockpool_alloc(1); // kept across loads until da_close
+    if (txn_buffer == NULL) return DISK_NO_MEMORY;
+    cur_sector_num = -1;
     dirty = 0;
 
+    exported = sector_size == FAT_EXPORT_SECTOR_SIZE && fat_export_find(sdHandle, txn_buffer, &volume);
+    da_set_layout();
+    status = da_load_superblock();
+    if (status != DISK_SUCCESS) return status;
+
+    // a raw card becomes an export volume once nothing on it is left to read
+    if (!exported && export_files && sector_size == FAT_EXPORT_SECTOR_SIZE && da_get_tail() == write_pos
+            && fat_export_plan(SD_getNumSectors(sdHandle), export_file_sectors, export_files, &volume)) {
+        memset(txn_buffer, 0, sector_size); // a PC formatting the card later mustn't bring back the raw positions
+        if (SD_write(sdHandle, txn_buffer, superblock_sector[1], 1) != SD_STATUS_SUCCESS) return DISK_FAILED_WRITE;
+        status = fat_export_format(sdHandle, txn_buffer, &volume);
+        if (status != DISK_SUCCESS) return status;
+        exported = 1;
+        da_set_layout();
+        status = da_load_superblock();
+        if (status != DISK_SUCCESS) return status;
+    }
+
     return DISK_SUCCESS;
 }
 
+void da_set_export(uint32_t file_sectors, uint16_t files) {
+    export_file_sectors = file_sectors;
+    export_files = files;
+}
+
+int da_get_export_files() {
+    return exported ? volume.files : 0;
+}
+
+unsigned long da_get_export_file_size() {
+    return exported ? volume.fileSectors * sector_size : 0;
+}
+
 int da_clear() {
+    return da_clear_cursor(da_get_cursor());
+}
+
+int da_clear_cursor(int id) {
+    UInt key;
+    int c;
+
+    if (id < 0 || id >= DA_CURSORS) return DISK_BAD_CURSOR;
+
+    key = Hwi_disable();
+    // the other cursors keep their data, this one just skips to the end and lets go of the log
+    cursors[id].read_pos = write_pos;
+    cursors[id].soft_read_pos = write_pos;
+    if (id != DA_CURSOR_DEFAULT) cursors[id].attached = 0;
+    if (da_get_tail() != write_pos) {
+        Hwi_restore(key);
+        return DISK_SUCCESS;
+    }
+
     write_pos = 0;
-    read_pos = 0;
-    memset(txn_buffer, 0, sector_size);
+    for (c = 0; c < DA_CURSORS; c++) {
+        cursors[c].read_pos = 0;
+        cursors[c].soft_read_pos = 0;
+    }
+    Hwi_restore(key);
+    if (txn_buffer) memset(txn_buffer, 0, sector_size);
+    return DISK_SUCCESS;
+}
+
+int da_set_cursor(int id) {
+    UInt key;
+
+    if (id < 0 || id >= DA_CURSORS) return DISK_BAD_CURSOR;
+
+    key = Hwi_disable();
+    // reads the last cursor didn't commit are read again next time
+    cursor->read_pos = cursor->soft_read_pos;
+    cursor = &cursors[id];
+    if (!cursor->attached) {
+        cursor->soft_read_pos = da_get_tail();
+        cursor->read_pos = cursor->soft_read_pos;
+        cursor->attached = 1;
+    }
+    Hwi_restore(key);
     return DISK_SUCCESS;
 }
 
+int da_get_cursor() {
+    return cursor - cursors;
+}
+
 int da_close() {
     if (da_commit() != DISK_SUCCESS) return DISK_FAILED_WRITE;
 
-    free(txn_buffer);
+    blockpool_free(txn_buffer);
+    txn_buffer = NULL;
     SD_close(sdHandle);
+    sdHandle = NULL;
 
     return DISK_SUCCESS;
 }
 
-int da_commit() {
+// flushes the sector being written and writes the next superblock over the older copy, soft takes the read positions of the last soft commits
+static int da_write_index(unsigned char soft) {
+    struct DaSuperblock superblock;
     int_fast8_t result;
+    UInt key;
+    int c;
 
+    if (sdHandle == NULL || txn_buffer == NULL) return DISK_NULL_HANDLE;
     if (dirty != 0) {
-        result = SD_write(sdHandle, txn_buffer, cur_sector_num+1, 1);
+        result = SD_write(sdHandle, txn_buffer, data_sector + cur_sector_num, 1);
         if (result != SD_STATUS_SUCCESS) return -1;
         dirty = 0;
     }
     cur_sector_num = -1;
     memset(txn_buffer, 0, sector_size);
-    System_sprintf(txn_buffer, "%ld:%ld", write_pos, read_pos);
-    result = SD_write(sdHandle, txn_buffer, 0, 1);
+
+    memset(&superblock, 0, sizeof(superblock));
+    superblock.magic = DA_SUPERBLOCK_MAGIC;
+    superblock.version = DA_SUPERBLOCK_VERSION;
+    superblock.length = offsetof(struct DaSuperblock, crc);
+    superblock.generation = generation + 1;
+    key = Hwi_disable();
+    superblock.writePos = write_pos;
+    for (c = 0; c < DA_CURSORS; c++) {
+        if (!cursors[c].attached) continue;
+        superblock.attached |= 1 << c;
+        superblock.readPos[c] = soft ? cursors[c].soft_read_pos : cursors[c].read_pos;
+    }
+    Hwi_restore(key);
+    superblock.crc = da_crc32((const char*) &superblock, superblock.length);
+    memcpy(txn_buffer, &superblock, sizeof(superblock));
+
+    if (index_fxn) index_fxn(txn_buffer + DA_INDEX_EXTRA_OFFSET, sector_size - DA_INDEX_EXTRA_OFFSET);
+    result = SD_write(sdHandle, txn_buffer, superblock_sector[superblock.generation & 1], 1);
     if (result != SD_STATUS_SUCCESS) return DISK_FAILED_WRITE;
+    generation = superblock.generation;
     return DISK_SUCCESS;
 }
 
+int da_commit() {
+    return da_write_index(0);
+}
+
+int da_checkpoint() {
+    if (sdHandle == NULL) return DISK_NULL_HANDLE;
+    return da_write_index(1);
+}
+
 int da_get_sector(int sector) {
     int_fast8_t result;
     if (sdHandle == NULL) return DISK_NULL_HANDLE;
@@ -107,7 +346,7 @@ int da_get_sector(int sector) {
 
     if (dirty != 0) {
 //        System_sprintf(txn_buffer, "%ld:%ld", write_pos, read_pos);
-        result = SD_write(sdHandle, txn_buffer, cur_sector_num+1, 1);
+        result = SD_write(sdHandle, txn_buffer, data_sector + cur_sector_num, 1);
         if (result != SD_STATUS_SUCCESS) return DISK_FAILED_WRITE;
     }
 
@@ -123,12 +362,12 @@ int da_get_read_sector(int sector) {
     sector = sector % num_sectors;
 
     if (dirty != 0) {
-        result = SD_write(sdHandle, txn_buffer, cur_sector_num+1, 1);
+        result = SD_write(sdHandle, txn_buffer, data_sector + cur_sector_num, 1);
         if (result != SD_STATUS_SUCCESS) return DISK_FAILED_WRITE;
         dirty = 0;
     }
 
-    result = SD_read(sdHandle, txn_buffer, sector+1, 1);
+    result = SD_read(sdHandle, txn_buffer, data_sector + sector, 1);
     if (result != SD_STATUS_SUCCESS) return DISK_FAILED_READ;
     cur_sector_num = sector;
 
@@ -136,9 +375,10 @@ int da_get_read_sector(int sector) {
 }
 
 int da_write(char* buffer, int size) {
-    if (sdHandle == NULL) return DISK_NULL_HANDLE;
+    if (sdHandle == NULL || txn_buffer == NULL) return DISK_NULL_HANDLE;
     int result = 0;
-    //if (size > total_size - da_get_data_size()) return -1;
+    // the slowest attached cursor hasn't read what would be overwritten
+    if (write_pos + size - da_get_tail() > total_size) return DISK_FULL;
     int totalWritten = 0;
     while (size > 0) {
         if (write_pos / sector_size != cur_sector_num) {
@@ -148,7 +388,8 @@ int da_write(char* buffer, int size) {
                 return result;
             }
         }
-        int nwrite = (size > sector_size - (write_pos % sector_size)) ? sector_size - (write_pos % sector_size) : size;
+        int left = sector_size - (write_pos % sector_size); // in this sector
+        int nwrite = (size > left) ? left : size;
         memcpy(txn_buffer + (write_pos % sector_size), buffer + totalWritten, nwrite);
 
         dirty = 1;
@@ -161,23 +402,27 @@ int da_write(char* buffer, int size) {
 }
 
 int da_read(char* buffer, int size) {
+    int result = da_read_at(cursor->read_pos, buffer, size);
+    if (result == DISK_SUCCESS) da_advance(size);
+    return result;
+}
+
+int da_read_at(unsigned long position, char* buffer, int size) {
     if (sdHandle == NULL) return DISK_NULL_HANDLE;
     int result = 0;
     //if (size > da_get_data_size()) return -1;
     int totalRead = 0;
     while (size > 0) {
-        if (read_pos / sector_size != cur_sector_num) {
-            result = da_get_read_sector(read_pos / sector_size);
-            if (result < 0) {
-                read_pos -= totalRead;
-                return result;
-            }
+        if (position / sector_size != cur_sector_num) {
+            result = da_get_read_sector(position / sector_size);
+            if (result < 0) return result;
         }
 
-        int nread = (size > sector_size - (read_pos % sector_size)) ? sector_size - (read_pos % sector_size) : size;
-        memcpy(buffer + totalRead, txn_buffer + (read_pos % sector_size), nread);
+        int left = sector_size - (position % sector_size);
+        int nread = (size > left) ? left : size;
+        memcpy(buffer + totalRead, txn_buffer + (position % sector_size), nread);
 
-        read_pos += nread;
+        position += nread;
         totalRead += nread;
         size -= nread;
     }
@@ -185,8 +430,16 @@ int da_read(char* buffer, int size) {
     return DISK_SUCCESS;
 }
 
+void da_advance(int size) {
+    UInt key = Hwi_disable();
+    cursor->read_pos += size;
+    Hwi_restore(key);
+}
+
 int da_get_data_size() {
-    int size = write_pos - read_pos;
+    UInt key = Hwi_disable();
+    int size = write_pos - cursor->read_pos;
+    Hwi_restore(key);
     if (size < 0) size = total_size - size;
     return size;
 }
@@ -195,7 +448,7 @@ int da_get_cur_sector() {
 }
 
 int da_get_read_pos() {
-    return read_pos;
+    return cursor->read_pos;
 }
 
 int da_get_write_pos() {
@@ -205,6 +458,25 @@ void da_set_write_pos(int position) {
     write_pos = position;
 }
 
+void da_start_at(unsigned long position) {
+    UInt key = Hwi_disable();
+    int c;
+
+    for (c = 0; c < DA_CURSORS; c++) {
+        if (!cursors[c].attached) continue;
+        if (cursors[c].soft_read_pos == write_pos || cursors[c].soft_read_pos > position) {
+            cursors[c].soft_read_pos = position;
+            cursors[c].read_pos = position;
+        }
+    }
+    write_pos = position;
+    Hwi_restore(key);
+}
+
+uint32_t da_get_generation() {
+    return generation;
+}
+
 int da_get_sector_size() {
     return sector_size;
 }
@@ -214,12 +486,114 @@ unsigned int da_get_num_sectors(){
 }
 
 int da_soft_commit() {
-    soft_read_pos = read_pos;
-    return read_pos;
+    UInt key = Hwi_disable();
+    int position = cursor->soft_read_pos = cursor->read_pos;
+    Hwi_restore(key);
+    return position;
 }
 int da_soft_rollback() {
-    read_pos = soft_read_pos;
-    return read_pos;
+    UInt key = Hwi_disable();
+    int position = cursor->read_pos = cursor->soft_read_pos;
+    Hwi_restore(key);
+    return position;
+}
+
+void da_set_index_fxn(DaIndexFxn fxn) {
+    index_fxn = fxn;
+}
+
+void da_set_locked(unsigned char lock) {
+    locked = lock;
+}
+
+static uint32_t da_us(uint64_t ticks, uint32_t freq) {
+    return ticks * 1000000 / freq;
+}
+
+static uint32_t da_bytes_per_second(uint32_t bytes, uint64_t ticks, uint32_t freq) {
+    return ticks ? (uint32_t) ((uint64_t) bytes * freq / ticks) : 0;
+}
+
+static void da_bench_fill(char* buffer, unsigned int sector) {
+    for (unsigned int i = 0; i < sector_size; i++) buffer[i] = (char) (sector * 31 + i);
+}
+
+static int da_run_benchmark(struct DiskBenchmark* result, char* buffer) {
+    Types_FreqHz freq;
+    uint64_t total; // timestamp ticks, the timestamp is too coarse to add up microseconds
+    unsigned int first = bench_sector;
+    unsigned int i, s;
+
+    Timestamp_getFreq(&freq);
+    result->sectors = DA_BENCH_SECTORS;
+
+    // one sector per write, the way da_write flushes the transaction buffer
+    total = 0;
+    for (i = 0; i < DA_BENCH_SECTORS; i++) {
+        da_bench_fill(buffer, i);
+        uint32_t start = Timestamp_get32();
+        if (SD_write(sdHandle, buffer, first + i, 1) != SD_STATUS_SUCCESS) return DISK_FAILED_WRITE;
+        uint32_t ticks = Timestamp_get32() - start;
+        uint32_t us = da_us(ticks, freq.lo);
+
+        uint8_t bin = 0;
+        for (uint32_t limit = 500; us >= limit && bin < DA_BENCH_HIST_BINS - 1; limit <<= 1) bin++;
+        result->latencyHistogram[bin]++;
+        if (us > result->maxWriteUs) result->maxWriteUs = us;
+        total += ticks;
+    }
+    result->meanWriteUs = da_us(total / DA_BENCH_SECTORS, freq.lo);
+    result->singleWriteBps = da_bytes_per_second(DA_BENCH_SECTORS * sector_size, total, freq.lo);
+
+    total = 0;
+    for (i = 0; i < DA_BENCH_SECTORS; i += DA_BENCH_BLOCK_SECTORS) {
+        for (s = 0; s < DA_BENCH_BLOCK_SECTORS; s++) da_bench_fill(buffer + s * sector_size, i + s);
+        uint32_t start = Timestamp_get32();
+        if (SD_write(sdHandle, buffer, first + i, DA_BENCH_BLOCK_SECTORS) != SD_STATUS_SUCCESS) return DISK_FAILED_WRITE;
+        uint32_t ticks = Timestamp_get32() - start;
+        if (da_us(ticks, freq.lo) > result->maxMultiWriteUs) result->maxMultiWriteUs = da_us(ticks, freq.lo);
+        total += ticks;
+    }
+    result->multiWriteBps = da_bytes_per_second(DA_BENCH_SECTORS * sector_size, total, freq.lo);
+
+    // read back what the multi-block pass wrote, a card that returns something else isn't usable
+    total = 0;
+    for (i = 0; i < DA_BENCH_SECTORS; i += DA_BENCH_BLOCK_SECTORS) {
+        uint32_t start = Timestamp_get32();
+        if (SD_read(sdHandle, buffer, first + i, DA_BENCH_BLOCK_SECTORS) != SD_STATUS_SUCCESS) return DISK_FAILED_READ;
+        total += Timestamp_get32() - start;
+
+        for (s = 0; s < DA_BENCH_BLOCK_SECTORS; s++) {
+            for (unsigned int b = 0; b < sector_size; b++) {
+                if (buffer[s * sector_size + b] != (char) ((i + s) * 31 + b)) return DISK_FAILED_READ;
+            }
+        }
+    }
+    result->readBps = da_bytes_per_second(DA_BENCH_SECTORS * sector_size, total, freq.lo);
+
+    return DISK_SUCCESS;
+}
+
+int da_benchmark(struct DiskBenchmark* result) {
+    memset(result, 0, sizeof(*result));
+
+    if (locked) result->status = DISK_LOCKED;
+    else if (sdHandle == NULL) result->status = DISK_NULL_HANDLE;
+    else {
+        char* buffer = (char *) blockpool_alloc(DA_BENCH_BLOCK_SECTORS);
+        if (buffer == NULL) result->status = DISK_NO_MEMORY;
+        else {
+            result->status = da_run_benchmark(result, buffer);
+            blockpool_free(buffer);
+        }
+    }
+
+    last_benchmark = *result;
+    return result->status;
+}
+
+void da_get_benchmark(struct DiskBenchmark* result) {
+    *result = last_benchmark;
 }
 
 char* da_get_transaction_buffer() {
@@ -4,7 +4,6 @@
 #include <ti/drivers/SD.h>
 #include <xdc/runtime/System.h>
 #include "Board.h"
-#include <semaphore.h>
 //#include "Application/simple_peripheral.h"
 
 
@@ -19,10 +18,67 @@
 #define DISK_FAILED_READ    -3
 #define DISK_FAILED_WRITE   -4
 #define DISK_LOCKED         -5
-
-static unsigned int cur_sector_num = -1;
-
-extern sem_t storage_mutex;
+#define DISK_NO_MEMORY      -6
+#define DISK_FULL           -7
+#define DISK_BAD_CURSOR     -8
+#define DISK_BUSY           -9
+#define DISK_NOT_MOUNTED    -10 // the storage task hasn't mounted the card yet, see Storage_mount
+
+// The positions are kept in a superblock written alternately to sector 0 and to the sector
+// after the data ring (two reserved sectors on an export volume, see da_set_export), so a torn
+// write only ever loses the copy being written. da_load takes the valid copy with the newest
+// generation. A card with the old ASCII "write_pos:read_pos" index in sector 0 is still loaded
+// and gets a superblock on the next commit.
+// Other modules can keep their own data behind the superblock.
+#define DA_INDEX_EXTRA_OFFSET   64
+
+// Every consumer of the log (the phone app, a clinician tablet, a UART dump) reads it through its
+// own cursor, with its own read position and soft commits. The default cursor is always
+// attached, the others once they are first used. Space is only reclaimed behind the slowest
+// attached cursor.
+#define DA_CURSORS              3   // every cursor has a slot in the superblock
+#define DA_CURSOR_DEFAULT       0
+
+#define DA_SUPERBLOCK_MAGIC     0x42435042  // "BPCB"
+#define DA_SUPERBLOCK_VERSION   1
+
+// Little endian, the CRC-32 of the first length bytes follows them. Later versions only add
+// fields before the CRC, up to DA_INDEX_EXTRA_OFFSET.
+struct DaSuperblock {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t generation;        // one more on every write
+    uint8_t attached;           // bit per cursor
+    uint8_t reserved[3];
+    uint64_t writePos;
+    uint64_t readPos[DA_CURSORS];
+    uint32_t crc;
+};
+
+// called by da_commit to fill the rest of the superblock sector, returns the number of bytes used
+typedef int (*DaIndexFxn)(char* buffer, int maxLength);
+
+// A raw card keeps its last DA_RAW_TAIL_SECTORS sectors out of the data ring, superblock copy B
+// and then the DA_BENCH_SECTORS of da_benchmark. The tail is as long as the benchmark sectors
+// were before there was a copy B, so the data ring of a card with the old index doesn't move.
+#define DA_RAW_TAIL_SECTORS     64
+#define DA_BENCH_SECTORS        62  // per pass, a multiple of DA_BENCH_BLOCK_SECTORS
+#define DA_BENCH_BLOCK_SECTORS  2   // sectors per SD_write in the multi-block pass, taken from BlockPool
+#define DA_BENCH_HIST_BINS      10  // bin n counts SD_writes of [2^n, 2^(n+1)) * 250 us, the last bin everything above
+
+// Results of da_benchmark. Sent as is on the diagnostics page, so only 32 bit fields.
+struct DiskBenchmark {
+    int32_t status;
+    uint32_t sectors;           // sectors per pass
+    uint32_t singleWriteBps;    // bytes per second writing one sector per SD_write
+    uint32_t multiWriteBps;     // bytes per second writing DA_BENCH_BLOCK_SECTORS per SD_write
+    uint32_t readBps;           // bytes per second reading DA_BENCH_BLOCK_SECTORS per SD_read
+    uint32_t meanWriteUs;       // single sector SD_write
+    uint32_t maxWriteUs;        // longest single sector SD_write, how long the card can keep the storage task busy
+    uint32_t maxMultiWriteUs;
+    uint32_t latencyHistogram[DA_BENCH_HIST_BINS]; // single sector SD_writes
+};
 
 // struct SDCard card;
 
@@ -38,19 +94,48 @@ unsigned int da_get_num_sectors();
 //free txn buffer
 int da_destructor();
 
+// drops what the selected cursor hasn't read, and the whole log once no attached cursor needs it.
+// Any cursor but the default one stops holding the log back until it is selected again.
 int da_clear();
+// da_clear on cursor id, selected or not
+int da_clear_cursor(int id);
+
+// selects the cursor the reads, commits and da_clear work on, attaching it at the oldest data
+// still on the card if it wasn't. Reads the last cursor didn't soft commit are rolled back.
+int da_set_cursor(int id);
+int da_get_cursor();
 
 // load SD card info into SD struct
 int da_load();
+
+// Export layout, see FatExport.h. With files set, da_load turns a card that has nothing left to
+// read into a FAT32 volume of files preallocated files of file_sectors each, which are then the
+// data ring. A card that already is an export volume stays one either way, 0 files only keeps
+// raw cards raw.
+void da_set_export(uint32_t file_sectors, uint16_t files);
+// files on the card, 0 when it is raw
+int da_get_export_files();
+// bytes per file, file n starts n of them into the data ring
+unsigned long da_get_export_file_size();
 int da_close();
 
 // writes to sd card. We only append.
 int da_write(char* buffer, int size);
 void da_set_write_pos(int position);
+// moves the write position to the start of a new session. Cursors that had read everything move
+// along, so they don't read the sectors in between that were never written.
+void da_start_at(unsigned long position);
+// of the superblock on the card, 0 until the first commit after a format
+uint32_t da_get_generation();
 
 // reads from position. Position should be initialized to second sector.
 // first sector reserved to track file size
 int da_read(char* buffer, int size);
+// reads from position without moving the cursor, for the storage task. The cursors
+// belong to the task that reads, da_advance moves the selected one past what it got.
+// Cursor calls are safe against the storage task writing and clearing at the same time.
+int da_read_at(unsigned long position, char* buffer, int size);
+void da_advance(int size);
 int da_get_cur_sector();
 int da_get_sector(int sector);
 int da_get_data_size();
@@ -58,6 +143,16 @@ int da_get_data_size();
 int da_soft_commit();
 int da_soft_rollback();
 int da_commit();
+// saves the read position of the last da_soft_commit in the index, da_load starts from there after a reset
+int da_checkpoint();
+void da_set_index_fxn(DaIndexFxn fxn);
+
+// while locked (recording) da_benchmark returns DISK_LOCKED
+void da_set_locked(unsigned char lock);
+// measures the card over the reserved sectors, the data and the index aren't touched
+int da_benchmark(struct DiskBenchmark* result);
+// results of the last da_benchmark
+void da_get_benchmark(struct DiskBenchmark* result);
 
 // TODO: delete this function. Only adding it for debugging purposes. This is a dangerous function
 char* da_get_transaction_buffer();
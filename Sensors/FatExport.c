@@ -0,0 +1,210 @@
+#include "FatExport.h"
+#include <string.h>
+
+#define FAT_EOC                 0x0FFFFFFF
+#define FAT_MAX_CLUSTERS        0x0FFFFFF5
+#define FAT_MEDIA               0xF8
+#define FAT_ENTRY_SIZE          32      // of a directory entry
+#define FAT_ENTRIES_PER_SECTOR  (FAT_EXPORT_SECTOR_SIZE / 4)
+#define FAT_DATE                ((2020 - 1980) << 9 | 1 << 5 | 1) // there's no clock to date the files with
+#define FAT_OEM_NAME            "BACPAC  "
+#define FAT_PARTITION_ENTRY     446
+#define FAT_PARTITION_TYPE      0x0C    // FAT32 with LBA
+
+static void fat_put16(uint8_t* sector, int offset, uint16_t value) {
+    sector[offset] = value;
+    sector[offset + 1] = value >> 8;
+}
+
+static void fat_put32(uint8_t* sector, int offset, uint32_t value) {
+    fat_put16(sector, offset, value);
+    fat_put16(sector, offset + 2, value >> 16);
+}
+
+static uint32_t fat_get32(const uint8_t* sector, int offset) {
+    return sector[offset] | sector[offset + 1] << 8 | (uint32_t) sector[offset + 2] << 16 | (uint32_t) sector[offset + 3] << 24;
+}
+
+static void fat_signature(uint8_t* sector) {
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+}
+
+static uint32_t fat_cluster_sector(const struct FatExportVolume* volume, uint32_t cluster) {
+    return volume->partition + FAT_EXPORT_RESERVED + 2 * volume->fatSectors + (cluster - 2) * volume->clusterSectors;
+}
+
+uint8_t fat_export_plan(uint32_t cardSectors, uint32_t fileSectors, uint16_t files, struct FatExportVolume* volume) {
+    uint64_t clusters = 0;
+    uint64_t sectors;
+    uint32_t clusterSectors, rootClusters = 0, fatSectors = 0;
+    uint32_t count;
+
+    // files stay under 4 GB
+    if (fileSectors == 0 || fileSectors > 0xFFFFFFFF / FAT_EXPORT_SECTOR_SIZE || cardSectors <= FAT_EXPORT_PARTITION) return 0;
+    if (files > FAT_EXPORT_MAX_FILES) files = FAT_EXPORT_MAX_FILES;
+
+    // the biggest clusters that still make FAT32 keep the FATs short
+    for (clusterSectors = 64; clusterSectors; clusterSectors >>= 1) {
+        if (fileSectors % clusterSectors) continue;
+        for (count = files; count; count--) {
+            rootClusters = ((count + 1) * FAT_ENTRY_SIZE + clusterSectors * FAT_EXPORT_SECTOR_SIZE - 1) / (clusterSectors * FAT_EXPORT_SECTOR_SIZE); // the label and the files
+            clusters = rootClusters + (uint64_t) count * (fileSectors / clusterSectors);
+            fatSectors = ((clusters + 2) * 4 + FAT_EXPORT_SECTOR_SIZE - 1) / FAT_EXPORT_SECTOR_SIZE;
+            sectors = FAT_EXPORT_RESERVED + 2 * (uint64_t) fatSectors + clusters * clusterSectors;
+            if (sectors <= cardSectors - FAT_EXPORT_PARTITION) break;
+        }
+        if (count && clusters >= FAT_EXPORT_MIN_CLUSTERS && clusters <= FAT_MAX_CLUSTERS) break;
+    }
+    if (clusterSectors == 0) return 0;
+
+    memset(volume, 0, sizeof(*volume));
+    volume->magic = FAT_EXPORT_MAGIC;
+    volume->partition = FAT_EXPORT_PARTITION;
+    volume->sectors = sectors;
+    volume->fatSectors = fatSectors;
+    volume->clusters = clusters;
+    volume->clusterSectors = clusterSectors;
+    volume->rootClusters = rootClusters;
+    volume->fileSectors = fileSectors;
+    volume->files = count;
+    volume->superblock[0] = FAT_EXPORT_PARTITION + FAT_EXPORT_SUPERBLOCK;
+    volume->superblock[1] = volume->superblock[0] + 1;
+    volume->bench = FAT_EXPORT_PARTITION + FAT_EXPORT_BENCH;
+    volume->data = fat_cluster_sector(volume, 2 + rootClusters);
+    return 1;
+}
+
+static void fat_boot_sector(uint8_t* sector, const struct FatExportVolume* volume) {
+    memset(sector, 0, FAT_EXPORT_SECTOR_SIZE);
+    sector[0] = 0xEB;                               // jump over the BPB, nothing boots from the card
+    sector[1] = 0x58;
+    sector[2] = 0x90;
+    memcpy(sector + 3, FAT_OEM_NAME, 8);
+    fat_put16(sector, 11, FAT_EXPORT_SECTOR_SIZE);
+    sector[13] = volume->clusterSectors;
+    fat_put16(sector, 14, FAT_EXPORT_RESERVED);
+    sector[16] = 2;                                 // FATs
+    sector[21] = FAT_MEDIA;
+    fat_put16(sector, 24, 63);                      // sectors per track and heads, only for CHS
+    fat_put16(sector, 26, 255);
+    fat_put32(sector, 28, volume->partition);       // hidden sectors
+    fat_put32(sector, 32, volume->sectors);
+    fat_put32(sector, 36, volume->fatSectors);
+    fat_put32(sector, 44, 2);                       // root directory cluster
+    fat_put16(sector, 48, 1);                       // FSInfo sector
+    fat_put16(sector, 50, 6);                       // backup boot sector
+    sector[64] = 0x80;                              // drive number
+    sector[66] = 0x29;                              // volume id, label and type follow
+    fat_put32(sector, 67, volume->clusters);
+    memcpy(sector + 71, "BACPAC     FAT32   ", 19);
+    fat_signature(sector);
+}
+
+static void fat_fsinfo_sector(uint8_t* sector) {
+    memset(sector, 0, FAT_EXPORT_SECTOR_SIZE);
+    fat_put32(sector, 0, 0x41615252);
+    fat_put32(sector, 484, 0x61417272);
+    fat_put32(sector, 488, 0);                      // free clusters, the files take them all
+    fat_put32(sector, 492, 0xFFFFFFFF);             // next free cluster unknown
+    fat_put32(sector, 508, 0xAA550000);
+}
+
+// the root directory and every file is one run of clusters
+static uint32_t fat_entry(const struct FatExportVolume* volume, uint32_t cluster) {
+    uint32_t first = 2 + volume->rootClusters;      // of SESS000.BIN
+
+    if (cluster == 0) return 0x0FFFFF00 | FAT_MEDIA;
+    if (cluster == 1) return FAT_EOC;
+    if (cluster >= volume->clusters + 2) return 0;  // the rest of the last FAT sector
+    if (cluster < first) return cluster + 1 == first ? FAT_EOC : cluster + 1;
+    return (cluster + 1 - first) % (volume->fileSectors / volume->clusterSectors) ? cluster + 1 : FAT_EOC;
+}
+
+static void fat_directory_sector(uint8_t* sector, const struct FatExportVolume* volume, uint32_t number) {
+    uint32_t i;
+
+    memset(sector, 0, FAT_EXPORT_SECTOR_SIZE);
+    for (i = 0; i < FAT_EXPORT_SECTOR_SIZE / FAT_ENTRY_SIZE; i++) {
+        uint32_t index = number * (FAT_EXPORT_SECTOR_SIZE / FAT_ENTRY_SIZE) + i;
+        uint8_t* entry = sector + i * FAT_ENTRY_SIZE;
+
+        if (index > volume->files) break;
+        if (index == 0) {
+            memcpy(entry, "BACPAC     ", 11);
+            entry[11] = 0x08;                       // volume label
+        }
+        else {
+            uint32_t file = index - 1;
+            uint32_t cluster = 2 + volume->rootClusters + file * (volume->fileSectors / volume->clusterSectors);
+            memcpy(entry, "SESS000 BIN", 11);
+            entry[4] += file / 100;
+            entry[5] += file / 10 % 10;
+            entry[6] += file % 10;
+            entry[11] = 0x01;                       // read only, the card owns the clusters
+            fat_put16(entry, 16, FAT_DATE);         // created
+            fat_put16(entry, 18, FAT_DATE);         // accessed
+            fat_put16(entry, 20, cluster >> 16);
+            fat_put16(entry, 26, cluster);
+            fat_put32(entry, 28, volume->fileSectors * FAT_EXPORT_SECTOR_SIZE);
+        }
+        fat_put16(entry, 24, FAT_DATE);             // written
+    }
+}
+
+static int fat_write(SD_Handle handle, char* buffer, uint32_t sector) {
+    return SD_write(handle, buffer, sector, 1) == SD_STATUS_SUCCESS ? DISK_SUCCESS : DISK_FAILED_WRITE;
+}
+
+int fat_export_format(SD_Handle handle, char* buffer, const struct FatExportVolume* volume) {
+    uint8_t* sector = (uint8_t*) buffer;
+    uint32_t i, e;
+    int result = DISK_SUCCESS;
+
+    // boot sector and FSInfo, their backups in 6 and 7, empty superblocks
+    for (i = 0; i < FAT_EXPORT_BENCH && result == DISK_SUCCESS; i++) {
+        if (i == 0 || i == 6) fat_boot_sector(sector, volume);
+        else if (i == 1 || i == 7) fat_fsinfo_sector(sector);
+        else memset(sector, 0, FAT_EXPORT_SECTOR_SIZE);
+        result = fat_write(handle, buffer, volume->partition + i);
+    }
+
+    for (i = 0; i < volume->fatSectors && result == DISK_SUCCESS; i++) {
+        for (e = 0; e < FAT_ENTRIES_PER_SECTOR; e++) fat_put32(sector, e * 4, fat_entry(volume, i * FAT_ENTRIES_PER_SECTOR + e));
+        result = fat_write(handle, buffer, volume->partition + FAT_EXPORT_RESERVED + i);
+        if (result == DISK_SUCCESS) result = fat_write(handle, buffer, volume->partition + FAT_EXPORT_RESERVED + volume->fatSectors + i);
+    }
+
+    for (i = 0; i < volume->rootClusters * volume->clusterSectors && result == DISK_SUCCESS; i++) {
+        fat_directory_sector(sector, volume, i);
+        result = fat_write(handle, buffer, fat_cluster_sector(volume, 2) + i);
+    }
+    if (result != DISK_SUCCESS) return result;
+
+    // one partition, and the layout in the boot code area
+    memset(sector, 0, FAT_EXPORT_SECTOR_SIZE);
+    memcpy(sector, volume, sizeof(*volume));
+    uint8_t* entry = sector + FAT_PARTITION_ENTRY;
+    entry[1] = entry[5] = 0xFE;                     // no CHS addresses, LBA only
+    entry[2] = entry[6] = 0xFF;
+    entry[3] = entry[7] = 0xFF;
+    entry[4] = FAT_PARTITION_TYPE;
+    fat_put32(entry, 8, volume->partition);
+    fat_put32(entry, 12, volume->sectors);
+    fat_signature(sector);
+    return fat_write(handle, buffer, 0);
+}
+
+uint8_t fat_export_find(SD_Handle handle, char* buffer, struct FatExportVolume* volume) {
+    const uint8_t* sector = (const uint8_t*) buffer;
+
+    if (SD_read(handle, buffer, 0, 1) != SD_STATUS_SUCCESS) return 0;
+    memcpy(volume, buffer, sizeof(*volume));
+    if (volume->magic != FAT_EXPORT_MAGIC || sector[510] != 0x55 || sector[511] != 0xAA) return 0;
+    if (sector[FAT_PARTITION_ENTRY + 4] != FAT_PARTITION_TYPE || fat_get32(sector, FAT_PARTITION_ENTRY + 8) != volume->partition) return 0;
+
+    // a PC that formats the partition again keeps the MBR but writes its own boot sector
+    if (SD_read(handle, buffer, volume->partition, 1) != SD_STATUS_SUCCESS) return 0;
+    return memcmp(sector + 3, FAT_OEM_NAME, 8) == 0 && fat_get32(sector, 32) == volume->sectors
+        && fat_get32(sector, 36) == volume->fatSectors && sector[13] == volume->clusterSectors;
+}
@@ -0,0 +1,59 @@
+#ifndef FATEXPORT_H
+#define FATEXPORT_H
+
+#include <stdint.h>
+#include "DiskAccess.h"
+
+// Minimal FAT32 writer for the export layout. The card gets one partition holding
+// FAT_EXPORT_FILES preallocated files SESS000.BIN, SESS001.BIN, ... of fileSectors each.
+// Their clusters follow each other, so together they are one run of sectors that
+// DiskAccess uses as its data ring and appends to at raw sector speed, while a PC
+// with a card reader just copies the files. Nothing but the format itself ever
+// touches the FAT or the directory.
+//
+// The superblock copies and the benchmark sectors of DiskAccess go in the reserved
+// sectors of the volume, which FAT drivers skip.
+
+#define FAT_EXPORT_SECTOR_SIZE      512
+#define FAT_EXPORT_PARTITION        2048    // first sector of the volume, 1 MB aligned like a PC would
+#define FAT_EXPORT_SUPERBLOCK       8       // copy A, copy B follows, after the backup boot sector and FSInfo
+#define FAT_EXPORT_BENCH            32
+#define FAT_EXPORT_RESERVED         96      // FAT_EXPORT_BENCH and the DA_BENCH_SECTORS, fixed since the clusters are found by it
+#define FAT_EXPORT_MIN_CLUSTERS     65525   // fewer and a PC takes the volume for FAT16
+
+// A FOURTYEIGHT session is SD_RAW_FACTOR * RANGE_FACTOR sectors (see simple_peripheral.c),
+// and the session counter in SNV is one byte
+#define FAT_EXPORT_FILE_SECTORS     (33 * 33)
+#define FAT_EXPORT_FILES            256
+#define FAT_EXPORT_MAX_FILES        1000    // the names have three digits
+
+#define FAT_EXPORT_MAGIC            0x54414642  // "BFAT", in the boot code area of the MBR
+
+// Where everything is, kept in the MBR (little endian like the superblock) so da_load finds the volume again
+struct FatExportVolume {
+    uint32_t magic;
+    uint32_t partition;         // first sector of the volume on the card
+    uint32_t sectors;           // of the volume
+    uint32_t fatSectors;        // of each of the two FATs
+    uint32_t clusters;
+    uint32_t clusterSectors;
+    uint32_t rootClusters;      // the root directory starts at cluster 2, the files right after it
+    uint32_t fileSectors;
+    uint32_t files;
+    // card sectors DiskAccess uses
+    uint32_t superblock[2];
+    uint32_t bench;
+    uint32_t data;              // first sector of SESS000.BIN
+};
+
+// Lays out a volume with up to files files (at most FAT_EXPORT_MAX_FILES) on a card of cardSectors.
+// Returns 1 and fills volume, 0 when not even one file fits or there are too few clusters for FAT32.
+uint8_t fat_export_plan(uint32_t cardSectors, uint32_t fileSectors, uint16_t files, struct FatExportVolume* volume);
+// Writes the reserved sectors, both FATs, the root directory and at last the MBR, so an
+// interrupted format doesn't look like a volume. buffer is one sector.
+int fat_export_format(SD_Handle handle, char* buffer, const struct FatExportVolume* volume);
+// Returns 1 and fills volume when the card holds an export volume. A card with our MBR whose
+// partition was reformatted on a PC doesn't count. buffer is one sector.
+uint8_t fat_export_find(SD_Handle handle, char* buffer, struct FatExportVolume* volume);
+
+#endif
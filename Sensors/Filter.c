@@ -0,0 +1,93 @@
+#include "Filter.h"
+#include "Serializer.h"
+
+static struct FilterConfig filter_config = { 0, 0, 1 };
+
+static int32_t history[NUM_SENSORS][2]; // last two inputs for the median
+static int32_t iir_state[NUM_SENSORS];
+static int64_t decimation_sum[NUM_SENSORS]; // of the values since the last output
+static uint8_t decimation_count[NUM_SENSORS];
+static uint8_t primed[NUM_SENSORS];
+
+void filter_configure(struct FilterConfig* config) {
+    filter_config = *config;
+    if (filter_config.decimation == 0) filter_config.decimation = 1;
+    if (filter_config.iirShift > FILTER_MAX_SHIFT) filter_config.iirShift = FILTER_MAX_SHIFT;
+    filter_reset();
+}
+
+void filter_reset() {
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+        primed[i] = 0;
+        decimation_count[i] = 0;
+        decimation_sum[i] = 0;
+    }
+}
+
+void filter_set_decimation(uint8_t decimation) {
+    if (decimation == 0) decimation = 1;
+    if (decimation == filter_config.decimation) return;
+
+    // the median and IIR carry on, only the outputs are counted from here
+    filter_config.decimation = decimation;
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+        decimation_count[i] = 0;
+        decimation_sum[i] = 0;
+    }
+}
+
+uint8_t filter_decimation_for_rate(uint16_t averageRate, uint16_t outputRate) {
+    if (outputRate == 0 || outputRate >= averageRate) return 1;
+    uint16_t decimation = (averageRate + outputRate / 2) / outputRate;
+    return decimation > 255 ? 255 : decimation;
+}
+
+static int32_t median3(int32_t a, int32_t b, int32_t c) {
+    if (a > b) {
+        int32_t t = a;
+        a = b;
+        b = t;
+    }
+    if (b > c) b = c;
+    return a > b ? a : b;
+}
+
+uint8_t filter_process(uint8_t channel, float* value) {
+    if (channel >= NUM_SENSORS) return 0;
+
+    // nothing enabled, pass the average through untouched
+    if (!filter_config.median && filter_config.iirShift == 0 && filter_config.decimation == 1) return 1;
+
+    int32_t x = (int32_t) (*value * 100);
+
+    if (!primed[channel]) {
+        history[channel][0] = x;
+        history[channel][1] = x;
+        iir_state[channel] = x * (1 << FILTER_FRAC_BITS);
+        primed[channel] = 1;
+    }
+
+    if (filter_config.median) {
+        int32_t m = median3(x, history[channel][0], history[channel][1]);
+        history[channel][1] = history[channel][0];
+        history[channel][0] = x;
+        x = m;
+    }
+
+    if (filter_config.iirShift) {
+        int32_t target = x * (1 << FILTER_FRAC_BITS);
+        iir_state[channel] += (target - iir_state[channel]) >> filter_config.iirShift;
+        x = iir_state[channel] >> FILTER_FRAC_BITS;
+    }
+
+    if (filter_config.decimation > 1) {
+        decimation_sum[channel] += x;
+        if (++decimation_count[channel] < filter_config.decimation) return 0;
+        x = (int32_t) (decimation_sum[channel] / filter_config.decimation);
+        decimation_sum[channel] = 0;
+        decimation_count[channel] = 0;
+    }
+
+    *value = x / 100.0f;
+    return 1;
+}
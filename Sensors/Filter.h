@@ -0,0 +1,32 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+
+// Per-channel filter stage between the boxcar average and the serializer.
+// All state is kept in fixed point (hundredths of an ohm / millivolt with
+// FILTER_FRAC_BITS extra fraction bits) so it stays cheap in the timer callback.
+
+#define FILTER_FRAC_BITS    6
+#define FILTER_MAX_SHIFT    8
+
+struct FilterConfig {
+    uint8_t median;     // 1 runs median-of-3 spike rejection on the averages
+    uint8_t iirShift;   // first order IIR y += (x - y) >> iirShift, 0 turns it off
+    uint8_t decimation; // emit the mean of every decimation averages (a boxcar, so the lower rate doesn't alias), 1 emits all of them
+};
+
+void filter_configure(struct FilterConfig* config);
+void filter_reset();
+// changes the decimation only, e.g. when the next slot of the schedule averages more cycles per output.
+// The median and IIR keep their state.
+void filter_set_decimation(uint8_t decimation);
+
+// Computes the decimation that brings averageRate (averages per second per channel) down to outputRate
+uint8_t filter_decimation_for_rate(uint16_t averageRate, uint16_t outputRate);
+
+// Feeds one averaged value of channel through the filter. Returns 1 when an output
+// is due for this channel, value then holds the filtered value.
+uint8_t filter_process(uint8_t channel, float* value);
+
+#endif
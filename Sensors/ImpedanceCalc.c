@@ -7,6 +7,7 @@
 */
 
 #include "ImpedanceCalc.h"
+#include <math.h>
 
 float impedanceCalc(uint8_t tapNumber, uint16_t adc) {
     float imp = 0;
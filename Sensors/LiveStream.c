@@ -0,0 +1,123 @@
+#include "LiveStream.h"
+#include <string.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+static char frames[LIVESTREAM_NUM_FRAMES][LIVESTREAM_FRAME_SIZE];
+static uint8_t frame_length[LIVESTREAM_NUM_FRAMES];
+static uint8_t head;        // oldest frame
+static uint8_t count;       // frames in the ring
+static uint8_t head_offset; // bytes of the head frame already notified
+static uint8_t reserved;    // frames touched by the last peek, these can't be dropped
+static uint8_t enabled;
+static uint32_t dropped;
+
+void livestream_enable(uint8_t enable) {
+    UInt key = Hwi_disable();
+    enabled = enable;
+    if (!enable) {
+        count = 0;
+        head_offset = 0;
+        reserved = 0;
+    }
+    Hwi_restore(key);
+}
+
+uint8_t livestream_is_enabled() {
+    return enabled;
+}
+
+void livestream_push(char* frame, uint8_t length) {
+    if (!enabled) return;
+    if (length > LIVESTREAM_FRAME_SIZE) length = LIVESTREAM_FRAME_SIZE;
+
+    UInt key = Hwi_disable();
+    if (count == LIVESTREAM_NUM_FRAMES) {
+        // drop the oldest frame that isn't partially sent or waiting on a notification
+        uint8_t victim = reserved;
+        if (victim == 0 && head_offset != 0) victim = 1;
+
+        dropped++;
+        if (victim >= count) {
+            // every frame is in flight, the new one is the only one we can lose
+            Hwi_restore(key);
+            return;
+        }
+
+        // close the gap left by the victim
+        for (uint8_t i = victim; i + 1 < count; i++) {
+            uint8_t to = (head + i) % LIVESTREAM_NUM_FRAMES;
+            uint8_t from = (head + i + 1) % LIVESTREAM_NUM_FRAMES;
+            memcpy(frames[to], frames[from], frame_length[from]);
+            frame_length[to] = frame_length[from];
+        }
+        count--;
+    }
+
+    uint8_t tail = (head + count) % LIVESTREAM_NUM_FRAMES;
+    memcpy(frames[tail], frame, length);
+    frame_length[tail] = length;
+    count++;
+    Hwi_restore(key);
+}
+
+uint16_t livestream_peek(char* buffer, uint16_t maxLength) {
+    uint16_t total = 0;
+
+    UInt key = Hwi_disable();
+    uint8_t offset = head_offset;
+    reserved = 0;
+    while (reserved < count && total < maxLength) {
+        uint8_t slot = (head + reserved) % LIVESTREAM_NUM_FRAMES;
+        uint16_t n = frame_length[slot] - offset;
+        if (n > maxLength - total) n = maxLength - total;
+
+        memcpy(buffer + total, frames[slot] + offset, n);
+        total += n;
+        reserved++;
+        offset = 0;
+    }
+    Hwi_restore(key);
+
+    return total;
+}
+
+void livestream_consume(uint16_t length) {
+    UInt key = Hwi_disable();
+    while (length > 0 && count > 0) {
+        uint16_t left = frame_length[head] - head_offset;
+        if (length < left) {
+            head_offset += length;
+            break;
+        }
+        length -= left;
+        head = (head + 1) % LIVESTREAM_NUM_FRAMES;
+        head_offset = 0;
+        count--;
+    }
+    reserved = 0;
+    Hwi_restore(key);
+}
+
+void livestream_release() {
+    UInt key = Hwi_disable();
+    reserved = 0;
+    Hwi_restore(key);
+}
+
+uint8_t livestream_is_empty() {
+    return count == 0;
+}
+
+uint32_t livestream_get_dropped() {
+    return dropped;
+}
+
+void livestream_clear() {
+    UInt key = Hwi_disable();
+    head = 0;
+    count = 0;
+    head_offset = 0;
+    reserved = 0;
+    dropped = 0;
+    Hwi_restore(key);
+}
@@ -0,0 +1,35 @@
+#ifndef LIVESTREAM_H
+#define LIVESTREAM_H
+
+#include <stdint.h>
+
+// Small ring of completed frames waiting to be notified over the BACPAC Live
+// characteristic. Frames are pushed from DACtimerCallback and drained by the
+// BLE task. When the ring is full the oldest frame that hasn't started going
+// out over the air is dropped and counted.
+
+#ifndef LIVESTREAM_NUM_FRAMES
+#define LIVESTREAM_NUM_FRAMES       4
+#endif
+
+#define LIVESTREAM_FRAME_SIZE       80 // must hold one dense serialized frame
+
+void livestream_enable(uint8_t enabled);
+uint8_t livestream_is_enabled();
+
+// called from the timer callback with one serialized frame
+void livestream_push(char* frame, uint8_t length);
+
+// copies up to maxLength bytes from the oldest frames into buffer without removing them.
+// A frame bigger than maxLength is split across several peeks.
+uint16_t livestream_peek(char* buffer, uint16_t maxLength);
+// removes the bytes handed out by the last peek once they were notified
+void livestream_consume(uint16_t length);
+// gives the bytes from the last peek back when they couldn't be sent
+void livestream_release();
+
+uint8_t livestream_is_empty();
+uint32_t livestream_get_dropped();
+void livestream_clear();
+
+#endif
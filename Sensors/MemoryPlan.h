@@ -0,0 +1,45 @@
+#ifndef MEMORYPLAN_H
+#define MEMORYPLAN_H
+
+#include "LiveStream.h"
+
+// Every buffer the BACPAC code keeps for the whole run is placed statically and
+// sized here, so nothing is allocated once the board is running and the ICall
+// heap only has to cover the BLE stack. The sizes add up to MEMORY_STATIC_TOTAL,
+// and the build fails when that grows past MEMORY_STATIC_BUDGET.
+
+#define MEMORY_UART_BUF_SIZE        256 // sensors.c uartBuf
+#define MEMORY_OUTPUT_BUF_SIZE      64  // simple_peripheral.c outputBuffer
+#define MEMORY_STORAGE_BUF_SIZE     128 // one serialized frame handed to the storage task
+// The storage task runs the request queue, the mount with da_load and the FAT format,
+// da_benchmark, the NVS erase and program of the overflow and the SD and SPI drivers
+// below all of them. Its deepest path is a commit: da_write_index with the superblock
+// on the stack, the stats copy of the index callback, then SD_write blocking in the
+// SPI driver, a bit over 500 bytes. Twice that leaves room for the drivers; check it
+// against the storage line of the telemetry page (stack peak of size).
+#define MEMORY_STORAGE_STACK_SIZE   1024
+#define MEMORY_STORAGE_QUEUE_LENGTH 4   // Storage requests waiting for the storage task
+#define MEMORY_STORAGE_REQUEST_SIZE 20  // sizeof(struct StorageRequest) on the CC2640R2
+#define MEMORY_STORAGE_RING_SIZE    224 // frames waiting while the storage task is busy, three dense ones
+#define MEMORY_LIVESTREAM_SIZE      (LIVESTREAM_NUM_FRAMES * LIVESTREAM_FRAME_SIZE)
+
+// BlockPool: sector sized blocks for the SD card transaction buffer and the
+// multi-block pass of da_benchmark. Word aligned for the SPI DMA.
+#define MEMORY_SECTOR_SIZE          512
+#define MEMORY_POOL_BLOCKS          3
+
+#define MEMORY_POOL_SIZE            (MEMORY_POOL_BLOCKS * MEMORY_SECTOR_SIZE)
+
+#define MEMORY_STATIC_TOTAL         (MEMORY_UART_BUF_SIZE + MEMORY_OUTPUT_BUF_SIZE + MEMORY_STORAGE_BUF_SIZE + \
+                                     MEMORY_STORAGE_STACK_SIZE + MEMORY_STORAGE_QUEUE_LENGTH * MEMORY_STORAGE_REQUEST_SIZE + \
+                                     MEMORY_STORAGE_RING_SIZE + \
+                                     MEMORY_LIVESTREAM_SIZE + MEMORY_POOL_SIZE)
+
+#ifndef MEMORY_STATIC_BUDGET
+#define MEMORY_STATIC_BUDGET        3840
+#endif
+
+// compile time check, the array size turns negative when the plan is over budget
+typedef char memory_plan_over_budget[(MEMORY_STATIC_TOTAL <= MEMORY_STATIC_BUDGET) ? 1 : -1];
+
+#endif
@@ -0,0 +1,204 @@
+#include "Overflow.h"
+#include <ti/drivers/NVS.h>
+#include <string.h>
+#include "Board.h"
+
+#define OVERFLOW_MAGIC      0x574F4C46  // "FLOW", written after the sequence number
+#define OVERFLOW_ERASED     0xFF
+#define OVERFLOW_PENDING    0xFE
+#define OVERFLOW_DRAINED    0x00
+
+struct OverflowPosition {
+    uint32_t sector;
+    uint32_t offset;
+};
+
+static NVS_Handle nvs;
+static const uint8_t* region;       // memory mapped
+static uint32_t sector_size;
+static uint32_t sectors;
+static uint32_t sequence;           // of the head sector
+static struct OverflowPosition head; // where the next record goes
+static struct OverflowPosition tail; // the oldest pending record, head when there is none
+static uint32_t frames;
+
+static uint8_t overflow_crc(uint8_t crc, const uint8_t* data, uint16_t length) {
+    uint8_t bit;
+
+    while (length--) {
+        crc ^= *data++;
+        for (bit = 0; bit < 8; bit++) crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static const uint8_t* overflow_at(const struct OverflowPosition* position) {
+    return region + position->sector * sector_size + position->offset;
+}
+
+static uint8_t overflow_sector_valid(uint32_t sector, uint32_t* number) {
+    uint32_t header[2];
+
+    memcpy(header, region + sector * sector_size, sizeof(header));
+    if (header[1] != OVERFLOW_MAGIC) return 0;
+    if (number) *number = header[0];
+    return 1;
+}
+
+// no record starts at position, the rest of the sector is free or unusable
+static uint8_t overflow_sector_end(const struct OverflowPosition* position) {
+    const uint8_t* record = overflow_at(position);
+
+    if (position->offset + OVERFLOW_RECORD_HEADER_SIZE > sector_size) return 1;
+    if (record[0] == OVERFLOW_ERASED && record[1] == OVERFLOW_ERASED) return 1;
+    return position->offset + OVERFLOW_RECORD_HEADER_SIZE + record[1] > sector_size;
+}
+
+static uint8_t overflow_record_pending(const uint8_t* record) {
+    return record[0] == OVERFLOW_PENDING
+        && overflow_crc(overflow_crc(0, record + 1, 1), record + OVERFLOW_RECORD_HEADER_SIZE, record[1]) == record[2];
+}
+
+// moves position to the next pending record at or after it, returns 0 when there is none before the head
+static uint8_t overflow_next(struct OverflowPosition* position) {
+    while (position->sector != head.sector || position->offset < head.offset) {
+        if (!overflow_sector_valid(position->sector, NULL) || overflow_sector_end(position)) {
+            if (position->sector == head.sector) break;
+            position->sector = (position->sector + 1) % sectors;
+            position->offset = OVERFLOW_SECTOR_HEADER_SIZE;
+            continue;
+        }
+        if (overflow_record_pending(overflow_at(position))) return 1;
+        position->offset += OVERFLOW_RECORD_HEADER_SIZE + overflow_at(position)[1];
+    }
+    *position = head;
+    return 0;
+}
+
+// erases the sector after the head and moves there, unless it still holds the oldest frames
+static uint8_t overflow_next_sector(void) {
+    uint32_t next = (head.sector + 1) % sectors;
+    uint32_t header[2] = { sequence + 1, OVERFLOW_MAGIC };
+
+    if (frames && tail.sector == next) return 0;
+    if (NVS_erase(nvs, next * sector_size, sector_size) != NVS_STATUS_SUCCESS) return 0;
+    if (NVS_write(nvs, next * sector_size, header, sizeof(header), NVS_WRITE_POST_VERIFY) != NVS_STATUS_SUCCESS) return 0;
+
+    sequence++;
+    head.sector = next;
+    head.offset = OVERFLOW_SECTOR_HEADER_SIZE;
+    if (!frames) tail = head;
+    return 1;
+}
+
+uint8_t overflow_init(void) {
+    NVS_Attrs attrs;
+    struct OverflowPosition position;
+    uint32_t sector, number;
+    uint8_t found = 0;
+
+#ifdef Board_NVSINTERNAL
+    if (nvs == NULL) {
+        NVS_init();
+        nvs = NVS_open(Board_NVSINTERNAL, NULL);
+    }
+#endif
+    if (nvs == NULL) return 0;
+    NVS_getAttrs(nvs, &attrs);
+    region = (const uint8_t*) attrs.regionBase;
+    sector_size = attrs.sectorSize;
+    sectors = attrs.regionSize / attrs.sectorSize;
+    frames = 0;
+    if (sectors < 2) {
+        sectors = 0;
+        return 0;
+    }
+
+    // the newest sector is the one being written
+    for (sector = 0; sector < sectors; sector++) {
+        if (!overflow_sector_valid(sector, &number) || (found && number < sequence)) continue;
+        sequence = number;
+        head.sector = sector;
+        found = 1;
+    }
+    if (!found) {
+        sequence = 0;
+        head.sector = sectors - 1;
+        if (!overflow_next_sector()) {
+            sectors = 0;
+            return 0;
+        }
+    }
+    else {
+        head.offset = OVERFLOW_SECTOR_HEADER_SIZE;
+        while (!overflow_sector_end(&head)) head.offset += OVERFLOW_RECORD_HEADER_SIZE + overflow_at(&head)[1];
+    }
+
+    // the sectors after the head hold the older frames, oldest first
+    tail.sector = (head.sector + 1) % sectors;
+    tail.offset = OVERFLOW_SECTOR_HEADER_SIZE;
+    if (overflow_next(&tail)) {
+        position = tail;
+        do {
+            frames++;
+            position.offset += OVERFLOW_RECORD_HEADER_SIZE + overflow_at(&position)[1];
+        } while (overflow_next(&position));
+    }
+    return 1;
+}
+
+uint8_t overflow_push(const char* frame, uint8_t length, const char* rest, uint8_t restLength) {
+    uint8_t header[OVERFLOW_RECORD_HEADER_SIZE];
+    uint32_t size = OVERFLOW_RECORD_HEADER_SIZE + length + restLength;
+    uint32_t offset;
+    uint8_t result;
+
+    if (sectors == 0 || length + restLength > 0xFF || size > sector_size - OVERFLOW_SECTOR_HEADER_SIZE) return 0;
+    if (head.offset + size > sector_size && !overflow_next_sector()) return 0;
+
+    header[0] = OVERFLOW_PENDING;
+    header[1] = length + restLength;
+    header[2] = overflow_crc(overflow_crc(overflow_crc(0, header + 1, 1), (const uint8_t*) frame, length), (const uint8_t*) rest, restLength);
+
+    // the header first, a record torn after it fails the CRC
+    offset = head.sector * sector_size + head.offset;
+    if (NVS_write(nvs, offset, header, sizeof(header), 0) != NVS_STATUS_SUCCESS) {
+        // nobody knows where a half written header says the next record is, the next one starts a new sector
+        head.offset = sector_size;
+        return 0;
+    }
+    result = NVS_write(nvs, offset + sizeof(header), (void*) frame, length, 0) == NVS_STATUS_SUCCESS
+        && (restLength == 0 || NVS_write(nvs, offset + sizeof(header) + length, (void*) rest, restLength, 0) == NVS_STATUS_SUCCESS);
+    head.offset += size;
+    if (!result) return 0;
+
+    if (!frames) {
+        tail.sector = head.sector; // tail was at the head
+        tail.offset = head.offset - size;
+    }
+    frames++;
+    return 1;
+}
+
+const char* overflow_peek(uint8_t* length) {
+    if (frames == 0) return NULL;
+
+    *length = overflow_at(&tail)[1];
+    return (const char*) overflow_at(&tail) + OVERFLOW_RECORD_HEADER_SIZE;
+}
+
+void overflow_pop(void) {
+    uint8_t drained = OVERFLOW_DRAINED;
+
+    if (frames == 0) return;
+
+    // should this fail the frame comes back after a reset and is on the card twice
+    NVS_write(nvs, tail.sector * sector_size + tail.offset, &drained, 1, 0);
+    tail.offset += OVERFLOW_RECORD_HEADER_SIZE + overflow_at(&tail)[1];
+    frames--;
+    overflow_next(&tail);
+}
+
+uint32_t overflow_get_frames(void) {
+    return frames;
+}
@@ -0,0 +1,40 @@
+#ifndef OVERFLOW_H
+#define OVERFLOW_H
+
+#include <stdint.h>
+
+// Log structured ring of frames in the internal flash (the NVSINTERNAL region), for
+// when the SD card is missing, failed a write or is full. The storage task writes
+// the frames here instead and moves them to the card, oldest first, once it takes
+// writes again.
+//
+// Every flash sector starts with a header holding a sequence number, the sector with
+// the highest one is the one being written. Records follow: a state byte, the length,
+// a CRC-8 of both and the frame. Drained records get their state byte cleared, which
+// flash can do without an erase, so only a sector the writer moves on to is erased.
+// A reset keeps every frame that wasn't drained, a record torn by a reset fails its
+// CRC and is skipped.
+//
+// Only the storage task uses it. Erasing a sector stalls the flash for a few ms.
+//
+// The region is the NVSINTERNAL entry of the board file (Board_NVSINTERNAL). The board file and the
+// linker command file come with the SDK project and aren't in this tree. The region has to be flash
+// the linker keeps out of the application image, below the stack image and away from the SNV pages
+// of the BLE stack, in whole 4 KB sectors. Check where the board file's region buffer is placed
+// against the stack boundary of the project. Without Board_NVSINTERNAL there is no overflow,
+// overflow_init returns 0 and frames the card can't take are dropped as write failures.
+
+#define OVERFLOW_SECTOR_HEADER_SIZE 8
+#define OVERFLOW_RECORD_HEADER_SIZE 3
+
+// opens the region and finds the frames left from before, returns 0 when there is no usable region
+uint8_t overflow_init(void);
+// adds a frame given in two pieces (rest may be NULL), returns 0 when it doesn't fit
+uint8_t overflow_push(const char* frame, uint8_t length, const char* rest, uint8_t restLength);
+// the oldest frame, read in place from the memory mapped flash, NULL when there is none
+const char* overflow_peek(uint8_t* length);
+// drops the frame from the last peek once it is on the card
+void overflow_pop(void);
+uint32_t overflow_get_frames(void);
+
+#endif
@@ -0,0 +1,53 @@
+#include "PowerModel.h"
+#include <string.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#define POWER_TICKS_PER_MS  100 // 10 us Clock ticks
+
+static const uint16_t state_ua[POWER_NUM_STATES] = { POWER_IDLE_UA, POWER_ACQUIRING_UA, POWER_STANDBY_UA };
+
+static uint32_t state_ms[POWER_NUM_STATES];
+static uint32_t carry_ticks; // less than a millisecond not accounted yet
+static uint32_t last_ticks;
+static uint8_t state;
+
+void power_reset() {
+    UInt key = Hwi_disable();
+    memset(state_ms, 0, sizeof(state_ms));
+    carry_ticks = 0;
+    last_ticks = Clock_getTicks();
+    Hwi_restore(key);
+}
+
+// Clock ticks wrap after 11 hours, something has to call this more often than that (telemetry does)
+void power_enter(uint8_t newState) {
+    UInt key = Hwi_disable();
+    uint32_t now = Clock_getTicks();
+    uint32_t ticks = now - last_ticks + carry_ticks;
+
+    state_ms[state] += ticks / POWER_TICKS_PER_MS;
+    carry_ticks = ticks % POWER_TICKS_PER_MS;
+    last_ticks = now;
+    if (newState < POWER_NUM_STATES) state = newState;
+    Hwi_restore(key);
+}
+
+uint8_t power_get_state() {
+    return state;
+}
+
+void power_get(struct PowerEstimate* estimate) {
+    power_enter(state);
+    memcpy(estimate->stateMs, state_ms, sizeof(state_ms));
+
+    uint32_t recordingMs = state_ms[POWER_STATE_ACQUIRING] + state_ms[POWER_STATE_STANDBY];
+    uint64_t recordingCharge = (uint64_t) state_ms[POWER_STATE_ACQUIRING] * state_ua[POWER_STATE_ACQUIRING]
+                             + (uint64_t) state_ms[POWER_STATE_STANDBY] * state_ua[POWER_STATE_STANDBY];
+    uint32_t totalMs = recordingMs + state_ms[POWER_STATE_IDLE];
+    uint64_t totalCharge = recordingCharge + (uint64_t) state_ms[POWER_STATE_IDLE] * state_ua[POWER_STATE_IDLE];
+
+    estimate->recordingUa = recordingMs ? recordingCharge / recordingMs : 0;
+    estimate->averageUa = totalMs ? totalCharge / totalMs : state_ua[state];
+    estimate->recordingHours = estimate->recordingUa ? (uint32_t) POWER_CELL_MAH * 1000 / estimate->recordingUa : 0;
+}
@@ -0,0 +1,41 @@
+#ifndef POWERMODEL_H
+#define POWERMODEL_H
+
+#include <stdint.h>
+
+// Estimates the average current from the time spent in each power state. The
+// currents are estimates for a CC2640R2 with the BACPAC front end and a
+// microSD card, replace them with meter readings of the board when there are some.
+
+#define POWER_STATE_IDLE        0 // not recording, BLE only
+#define POWER_STATE_ACQUIRING   1 // front end powered, DAC timer running, standby blocked
+#define POWER_STATE_STANDBY     2 // recording, between two bursts
+#define POWER_NUM_STATES        3
+
+#ifndef POWER_IDLE_UA
+#define POWER_IDLE_UA           350  // advertising or connected, SD card idle
+#endif
+#ifndef POWER_ACQUIRING_UA
+#define POWER_ACQUIRING_UA      4500 // CPU woken by every timer tick, mux, DAC excitation, ADC, SD writes
+#endif
+#ifndef POWER_STANDBY_UA
+#define POWER_STANDBY_UA        250  // standby, the SD card idle current dominates
+#endif
+#ifndef POWER_CELL_MAH
+#define POWER_CELL_MAH          500
+#endif
+
+struct PowerEstimate {
+    uint32_t stateMs[POWER_NUM_STATES]; // time spent in every state since power_reset
+    uint32_t recordingUa;               // average over acquiring and standby
+    uint32_t averageUa;                 // average over every state
+    uint32_t recordingHours;            // POWER_CELL_MAH at recordingUa
+};
+
+void power_reset();
+// accounts the time since the last call to the state that was running
+void power_enter(uint8_t state);
+uint8_t power_get_state();
+void power_get(struct PowerEstimate* estimate);
+
+#endif
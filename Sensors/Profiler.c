@@ -0,0 +1,113 @@
+#include "Profiler.h"
+#include <string.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <xdc/runtime/System.h>
+
+#define DWT_CTRL        (*(volatile uint32_t*) 0xE0001000)
+#define DWT_CTRL_CYCCNTENA  0x00000001
+#define DEMCR           (*(volatile uint32_t*) 0xE000EDFC)
+#define DEMCR_TRCENA    0x01000000
+
+struct StageState {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t histogram[PROFILER_HIST_BINS];
+};
+
+static const char* const stage_names[PROFILER_NUM_STAGES] = { "tick", "adc", "impedance", "controller", "output", "i2c" };
+
+static struct StageState stages[PROFILER_NUM_STAGES];
+static uint32_t period_cycles;
+static uint32_t ticks;
+static uint32_t overruns;
+static uint32_t last_tick_start;
+
+void profiler_init() {
+#ifndef HOST_BUILD
+    DEMCR |= DEMCR_TRCENA;
+    PROFILER_DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+    profiler_reset();
+}
+
+void profiler_set_period(uint32_t periodCycles) {
+    period_cycles = periodCycles;
+}
+
+void profiler_reset() {
+    UInt key = Hwi_disable();
+    memset(stages, 0, sizeof(stages));
+    for (uint8_t i = 0; i < PROFILER_NUM_STAGES; i++) stages[i].min = UINT32_MAX;
+    ticks = 0;
+    overruns = 0;
+    last_tick_start = 0;
+    Hwi_restore(key);
+}
+
+static uint8_t profiler_bin(uint32_t cycles) {
+    uint8_t bin = 0;
+    cycles >>= PROFILER_HIST_SHIFT + 1;
+    while (cycles && bin < PROFILER_HIST_BINS - 1) {
+        cycles >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+void profiler_record(uint8_t stage, uint32_t cycles) {
+    struct StageState* state = &stages[stage];
+    state->count++;
+    state->total += cycles;
+    if (cycles < state->min) state->min = cycles;
+    if (cycles > state->max) state->max = cycles;
+    state->histogram[profiler_bin(cycles)]++;
+}
+
+uint32_t profiler_tick_begin() {
+    uint32_t start = profiler_now();
+
+    // a tick that starts more than half a period late means the previous one held off the interrupt
+    if (ticks && period_cycles && start - last_tick_start > period_cycles + period_cycles / 2) overruns++;
+    last_tick_start = start;
+    ticks++;
+    return start;
+}
+
+void profiler_tick_end(uint32_t start) {
+    uint32_t cycles = profiler_now() - start;
+    profiler_record(PROFILER_TICK, cycles);
+    if (period_cycles && cycles >= period_cycles) overruns++;
+}
+
+void profiler_get_stage(uint8_t stage, struct ProfilerStage* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (stage >= PROFILER_NUM_STAGES) return;
+
+    UInt key = Hwi_disable();
+    struct StageState* state = &stages[stage];
+    stats->count = state->count;
+    stats->min = state->count ? state->min : 0;
+    stats->max = state->max;
+    stats->mean = state->count ? (uint32_t) (state->total / state->count) : 0;
+    memcpy(stats->histogram, state->histogram, sizeof(stats->histogram));
+    Hwi_restore(key);
+}
+
+void profiler_get_summary(struct ProfilerSummary* summary) {
+    UInt key = Hwi_disable();
+    summary->periodCycles = period_cycles;
+    summary->ticks = ticks;
+    summary->overruns = overruns;
+    summary->maxTickCycles = stages[PROFILER_TICK].max;
+    Hwi_restore(key);
+}
+
+int profiler_format(char* buffer, uint8_t stage) {
+    struct ProfilerStage stats;
+    profiler_get_stage(stage, &stats);
+    return System_sprintf(buffer, "%s: n=%u min=%u max=%u mean=%u cycles\n", stage < PROFILER_NUM_STAGES ? stage_names[stage] : "?",
+                          stats.count, stats.min, stats.max, stats.mean);
+}
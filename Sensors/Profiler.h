@@ -0,0 +1,65 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+// Cycle counts of the DACtimerCallback phases. On the board the Cortex-M3 DWT
+// cycle counter is used (48 MHz), the host build uses the xdc Timestamp shim.
+
+#define PROFILER_TICK           0 // the whole DACtimerCallback
+#define PROFILER_ADC_READ       1
+#define PROFILER_IMPEDANCE      2 // impedanceCalc and averaging
+#define PROFILER_CONTROLLER     3 // p controller picking the next tap
+#define PROFILER_OUTPUT         4 // filter, serializer and handing the frame to storage
+#define PROFILER_I2C            5 // potentiometer write
+#define PROFILER_NUM_STAGES     6
+
+// bin n counts durations of [2^(n + PROFILER_HIST_SHIFT), 2^(n + 1 + PROFILER_HIST_SHIFT)) cycles,
+// the first and last bins also take everything below and above
+#define PROFILER_HIST_BINS      16
+#define PROFILER_HIST_SHIFT     4
+
+// Stage statistics. Sent as is on the diagnostics pages, so only 32 bit fields.
+struct ProfilerStage {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+    uint32_t histogram[PROFILER_HIST_BINS];
+};
+
+struct ProfilerSummary {
+    uint32_t periodCycles;  // cycles between two timer ticks
+    uint32_t ticks;
+    uint32_t overruns;      // ticks that ran longer than the period or came in late
+    uint32_t maxTickCycles;
+};
+
+#ifdef HOST_BUILD
+#include <xdc/runtime/Timestamp.h>
+static inline uint32_t profiler_now() {
+    return Timestamp_get32();
+}
+#else
+#define PROFILER_DWT_CYCCNT     (*(volatile uint32_t*) 0xE0001004)
+static inline uint32_t profiler_now() {
+    return PROFILER_DWT_CYCCNT;
+}
+#endif
+
+// enables the cycle counter
+void profiler_init();
+void profiler_set_period(uint32_t periodCycles);
+void profiler_reset();
+
+void profiler_record(uint8_t stage, uint32_t cycles);
+// wrap one timer tick, these also look for overruns
+uint32_t profiler_tick_begin();
+void profiler_tick_end(uint32_t start);
+
+void profiler_get_stage(uint8_t stage, struct ProfilerStage* stats);
+void profiler_get_summary(struct ProfilerSummary* summary);
+// one readable line for the stage, returns its length
+int profiler_format(char* buffer, uint8_t stage);
+
+#endif
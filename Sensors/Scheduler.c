@@ -0,0 +1,37 @@
+#include "Scheduler.h"
+
+static struct AcquisitionSlot slots[SCHEDULER_MAX_SLOTS] = { { ACQ_MODE_IMPEDANCE, 5, 1 } };
+static uint8_t num_slots = 1;
+static uint8_t current_slot;
+static uint8_t frames_done;
+
+void scheduler_setTable(const struct AcquisitionSlot* table, uint8_t length) {
+    if (length == 0) return;
+    if (length > SCHEDULER_MAX_SLOTS) length = SCHEDULER_MAX_SLOTS;
+
+    for (uint8_t i = 0; i < length; i++) {
+        slots[i] = table[i];
+        if (slots[i].cyclesPerOutput == 0) slots[i].cyclesPerOutput = 1;
+        if (slots[i].frames == 0) slots[i].frames = 1;
+    }
+    num_slots = length;
+    scheduler_reset();
+}
+
+void scheduler_reset() {
+    current_slot = 0;
+    frames_done = 0;
+}
+
+const struct AcquisitionSlot* scheduler_current() {
+    return &slots[current_slot];
+}
+
+uint8_t scheduler_frameDone() {
+    if (++frames_done < slots[current_slot].frames) return 0;
+
+    uint8_t mode = slots[current_slot].mode;
+    frames_done = 0;
+    current_slot = (current_slot + 1) % num_slots;
+    return slots[current_slot].mode != mode;
+}
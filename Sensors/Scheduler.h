@@ -0,0 +1,27 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+#define ACQ_MODE_IMPEDANCE  0
+#define ACQ_MODE_EMG        1
+
+#define SCHEDULER_MAX_SLOTS 8
+
+// One block of the acquisition schedule. The slot's mode runs for a number of
+// full 16 channel frames before the scheduler moves to the next slot.
+struct AcquisitionSlot {
+    uint8_t mode;            // ACQ_MODE_IMPEDANCE or ACQ_MODE_EMG
+    uint8_t cyclesPerOutput; // cycles averaged into one output, sets the output rate of the slot
+    uint8_t frames;          // frames the slot runs before moving on
+};
+
+void scheduler_setTable(const struct AcquisitionSlot* table, uint8_t length);
+void scheduler_reset();
+const struct AcquisitionSlot* scheduler_current();
+
+// Called once a full frame was produced. Returns 1 when the slot that runs
+// next uses a different mode, so the caller has to reconfigure the hardware.
+uint8_t scheduler_frameDone();
+
+#endif
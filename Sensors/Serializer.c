@@ -6,9 +6,19 @@
  */
 
 #include "Serializer.h"
+#include <string.h>
 
 static struct SensorData sensorData;
 static uint8_t index = 0;
+static uint8_t mode = SERIALIZER_MODE_IMPEDANCE;
+static uint16_t nextSequence = 0;
+
+// deadband state is kept per mode so EMG frames are never compared against impedance frames
+static struct DeadbandConfig deadbandConfig = { 0, 1, 1 };
+static float lastLogged[SERIALIZER_NUM_MODES][NUM_SENSORS];
+static uint16_t framesSinceKeyframe[SERIALIZER_NUM_MODES];
+static uint16_t framesSinceLogged[SERIALIZER_NUM_MODES];
+static uint8_t keyframeLogged[SERIALIZER_NUM_MODES];
 
 int serializer_isFull() {
     return index == 0;
@@ -19,14 +29,79 @@ void serializer_setTimestamp(uint16_t timestamp) {
 }
 
 void serializer_addImpedance(float impedance) {
+    if (index == 0) sensorData.sequence = nextSequence++;
     sensorData.impedanceValues[index] = impedance;
     index = (index + 1) % NUM_SENSORS;
 }
 
+static int serializer_serializeHeader(char* buffer, uint8_t type) {
+    if (mode == SERIALIZER_MODE_EMG) type |= SERIALIZER_FRAME_EMG;
+    buffer[0] = type;
+    memcpy(buffer + sizeof(uint8_t), &sensorData.timestamp, sizeof(uint16_t));
+    memcpy(buffer + sizeof(uint8_t) + sizeof(uint16_t), &sensorData.sequence, sizeof(uint16_t));
+    return SERIALIZER_HEADER_SIZE;
+}
+
 int serializer_serialize(char* buffer) {
-    memcpy(buffer, &sensorData.timestamp, sizeof(uint16_t));
-    memcpy(buffer + sizeof(uint16_t), sensorData.impedanceValues, sizeof(float) * NUM_SENSORS);
-    return sizeof(uint16_t) + sizeof(float) * NUM_SENSORS;
+    int offset = serializer_serializeHeader(buffer, SERIALIZER_FRAME_DENSE);
+    memcpy(buffer + offset, sensorData.impedanceValues, sizeof(float) * NUM_SENSORS);
+    return offset + sizeof(float) * NUM_SENSORS;
+}
+
+void serializer_setDeadband(struct DeadbandConfig* config) {
+    deadbandConfig = *config;
+    memset(keyframeLogged, 0, sizeof(keyframeLogged));
+}
+
+int serializer_serializeDeadband(char* buffer) {
+    uint16_t mask = 0;
+    uint8_t changed = 0;
+    float* last = lastLogged[mode];
+
+    framesSinceKeyframe[mode]++;
+    framesSinceLogged[mode]++;
+
+    if (keyframeLogged[mode]) {
+        for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+            float delta = sensorData.impedanceValues[i] - last[i];
+            if (delta > deadbandConfig.deadband || -delta > deadbandConfig.deadband) {
+                mask |= 1 << i;
+                changed++;
+            }
+        }
+    }
+
+    // a sparse frame costs the mask on top of the values, past that point the dense frame is smaller
+    if (!keyframeLogged[mode] || framesSinceKeyframe[mode] >= deadbandConfig.keyframeInterval
+            || changed * sizeof(float) + sizeof(uint16_t) >= sizeof(float) * NUM_SENSORS) {
+        memcpy(last, sensorData.impedanceValues, sizeof(float) * NUM_SENSORS);
+        keyframeLogged[mode] = 1;
+        framesSinceKeyframe[mode] = 0;
+        framesSinceLogged[mode] = 0;
+        return serializer_serialize(buffer);
+    }
+
+    if (changed) {
+        int offset = serializer_serializeHeader(buffer, SERIALIZER_FRAME_SPARSE);
+        memcpy(buffer + offset, &mask, sizeof(uint16_t));
+        offset += sizeof(uint16_t);
+        for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+            if (mask & (1 << i)) {
+                memcpy(buffer + offset, &sensorData.impedanceValues[i], sizeof(float));
+                offset += sizeof(float);
+                last[i] = sensorData.impedanceValues[i];
+            }
+        }
+        framesSinceLogged[mode] = 0;
+        return offset;
+    }
+
+    if (framesSinceLogged[mode] >= deadbandConfig.heartbeatInterval) {
+        framesSinceLogged[mode] = 0;
+        return serializer_serializeHeader(buffer, SERIALIZER_FRAME_HEARTBEAT);
+    }
+
+    return 0;
 }
 
 int serializer_serializeReadable(char* buffer) {
@@ -47,5 +122,11 @@ int serializer_serializeReadable(char* buffer) {
 
 void serializer_clear() {
     index = 0;
+    nextSequence = 0;
+    memset(keyframeLogged, 0, sizeof(keyframeLogged)); // start the next recording with a full frame
+}
+
+void serializer_setMode(uint8_t newMode) {
+    if (newMode < SERIALIZER_NUM_MODES) mode = newMode;
 }
 
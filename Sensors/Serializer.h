@@ -13,16 +13,60 @@
 #include <stdint.h>
 #include <xdc/runtime/System.h>
 
+/*
+ * Every serialized frame starts with a one byte frame type followed by the
+ * uint16_t timestamp and the uint16_t sequence number. All values are little endian.
+ *
+ * DENSE:     type, timestamp, sequence, NUM_SENSORS floats
+ * SPARSE:    type, timestamp, sequence, uint16_t mask of changed channels (bit 0 = channel 0),
+ *            one float per set bit in channel order
+ * HEARTBEAT: type, timestamp, sequence. Nothing left the deadband since the last frame
+ *
+ * The sequence number counts every frame built since the recording started, logged or
+ * not, and wraps at 65535. A gap means frames were lost. With deadband logging gaps up
+ * to the heartbeat interval are expected, the skipped frames are unchanged.
+ *
+ * The top bit of the type is set for frames holding EMG values (millivolts)
+ * instead of impedance values (ohms).
+ */
+#define SERIALIZER_FRAME_DENSE      0x01
+#define SERIALIZER_FRAME_SPARSE     0x02
+#define SERIALIZER_FRAME_HEARTBEAT  0x03
+#define SERIALIZER_FRAME_EMG        0x80
+#define SERIALIZER_FRAME_TYPE_MASK  0x7F
+
+#define SERIALIZER_MODE_IMPEDANCE   0
+#define SERIALIZER_MODE_EMG         1
+#define SERIALIZER_NUM_MODES        2
+
+#define SERIALIZER_HEADER_SIZE      (sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint16_t))
+#define SERIALIZER_MAX_FRAME_SIZE   (SERIALIZER_HEADER_SIZE + sizeof(float) * NUM_SENSORS)
+
 struct SensorData {
     uint32_t timestamp;
+    uint16_t sequence;
     float impedanceValues[NUM_SENSORS];
 };
 
+// Settings for change-triggered logging
+struct DeadbandConfig {
+    float deadband;             // a channel is logged once it moves more than this from its last logged value
+    uint16_t keyframeInterval;  // frames between two full (dense) frames
+    uint16_t heartbeatInterval; // frames without any change before a heartbeat is logged
+};
+
 int serializer_isFull();
 void serializer_setTimestamp(uint16_t);
 void serializer_addImpedance(float);
 int serializer_serialize(char*);
 int serializer_serializeReadable(char*);
 void serializer_clear();
+// Mode of the values added from now on. Has to be set while the frame is empty.
+void serializer_setMode(uint8_t mode);
+
+void serializer_setDeadband(struct DeadbandConfig*);
+// Serializes the current frame as a dense, sparse or heartbeat frame.
+// Returns 0 when nothing needs to be logged for this frame.
+int serializer_serializeDeadband(char*);
 
 #endif /* SENSORS_SERIALIZER_H_ */
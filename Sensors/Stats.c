@@ -0,0 +1,23 @@
+#include "Stats.h"
+#include <string.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+struct PipelineStats pipelineStats;
+
+void stats_reset() {
+    UInt key = Hwi_disable();
+    memset(&pipelineStats, 0, sizeof(pipelineStats));
+    Hwi_restore(key);
+}
+
+void stats_snapshot(struct PipelineStats* stats) {
+    UInt key = Hwi_disable();
+    *stats = pipelineStats;
+    Hwi_restore(key);
+}
+
+void stats_set_elapsed(struct PipelineStats* stats, uint32_t elapsedMs) {
+    stats->elapsedMs = elapsedMs;
+    if (elapsedMs) stats->deliveredRate = (uint64_t) (stats->framesStored + stats->framesSuppressed) * 1000000 / elapsedMs;
+    else stats->deliveredRate = 0;
+}
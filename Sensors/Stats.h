@@ -0,0 +1,42 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+// Counters for everywhere a sample or frame can get lost between the ADC and the
+// phone. Reset at the start of every recording. Sent as is on the diagnostics page
+// and in the SD card index, so only 32 bit fields.
+struct PipelineStats {
+    uint32_t ticks;             // DACtimerCallbacks
+    uint32_t adcRetries;        // first ADC_convert failed, the retry worked
+    uint32_t adcFailures;       // both conversions failed, the read is dropped
+    uint32_t stutters;          // reads repeated because the adc was above the stutter limit
+    uint32_t stutterLimited;    // reads used anyway after too many stutters
+    uint32_t i2cFailures;       // potentiometer/DAC writes rejected or failed
+    uint32_t framesBuilt;       // complete frames out of the serializer
+    uint32_t framesSuppressed;  // frames the deadband logging had nothing to write for
+    uint32_t framesSkipped;     // storage buffer and frame ring were full, frame lost
+    uint32_t framesStored;      // frames written to the card
+    uint32_t writeFailures;     // da_write errors and the overflow full too, frame lost
+    uint32_t liveDropped;       // frames dropped from the live stream ring
+    uint32_t bleBadReads;       // chunks not sent because the card read failed
+    uint32_t heapSleeps;        // application loops skipped for low heap
+    uint32_t elapsedMs;         // recording time
+    uint32_t deliveredRate;     // frames per second on the card (stored or suppressed), in mHz
+    uint32_t framesDeferred;    // frames that waited in the storage frame ring, e.g. for the card to mount
+    uint32_t framesOverflowed;  // frames written to the internal flash overflow because the card failed or is missing
+    uint32_t overflowDrained;   // frames moved from the overflow to the card, also counted as stored
+    uint32_t overflowFrames;    // frames in the overflow right now, including ones from before a reset
+};
+
+#define STATS_MAGIC     0x54415453 // "STAT", marks the stats in the SD card index
+
+extern struct PipelineStats pipelineStats;
+
+void stats_reset();
+// copies the counters with interrupts off
+void stats_snapshot(struct PipelineStats* stats);
+// fills the derived fields from the recording time
+void stats_set_elapsed(struct PipelineStats* stats, uint32_t elapsedMs);
+
+#endif
@@ -1,27 +1,56 @@
 #include "Storage.h"
 #include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Clock.h>
 #include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
 #include <stdlib.h>
+#include "Stats.h"
+#include "Telemetry.h"
+#include "MemoryPlan.h"
+#include "Overflow.h"
 
 #define STORAGE_TASK_PRIORITY       1
 
 #ifndef STORAGE_TASK_STACK_SIZE
-#define STORAGE_TASK_STACK_SIZE     448//644
+#define STORAGE_TASK_STACK_SIZE     MEMORY_STORAGE_STACK_SIZE
 #endif
 
+// frames moved from the overflow to the card per frame written, more than come in while it catches up
+#define STORAGE_OVERFLOW_DRAIN      8
+
+// Clock ticks between two mounts while there is no usable card, 10 s. A missing card fails SD_initialize quickly.
+#define STORAGE_REMOUNT_PERIOD      1000000
+
 #ifndef STORAGE_BUF_SIZE
-#define STORAGE_BUF_SIZE            128
+#define STORAGE_BUF_SIZE            MEMORY_STORAGE_BUF_SIZE
 #endif
 
 Semaphore_Struct storage_buffer_mailbox_struct;
 Semaphore_Handle storage_buffer_mailbox;
 Semaphore_Struct storage_buffer_mutex_struct;
 Semaphore_Handle storage_buffer_mutex;
+Semaphore_Struct storage_ready_struct;
+Semaphore_Handle storage_ready;
 
 char storage_buffer[STORAGE_BUF_SIZE];
 uint8_t storage_buffer_length;
 static uint8_t storage_status;
 
+static struct StorageRequest storage_queue[MEMORY_STORAGE_QUEUE_LENGTH];
+static uint8_t storage_queue_head;
+static uint8_t storage_queue_count;
+static uint8_t storage_task_created;
+
+static volatile int storage_mount_status = STORAGE_PENDING;
+static uint32_t storage_mount_ticks;        // when the last mount was done
+static StorageMountFxn storage_mount_fxn;
+
+// frames of a length byte and the bytes, may wrap around the end
+static uint8_t storage_ring[MEMORY_STORAGE_RING_SIZE];
+static uint8_t storage_ring_head;
+static uint8_t storage_ring_used;
+static uint8_t storage_ring_frames;
+
 Task_Struct storageTask;
 Char storageTaskStack[STORAGE_TASK_STACK_SIZE];
 
@@ -29,41 +58,251 @@ uint8_t getStatus() {
     return storage_status;
 }
 
+static void Storage_service(const struct StorageRequest* request) {
+    static struct DiskBenchmark benchmark; // kept off the storage task stack
+    int result;
+
+    switch (request->type) {
+        case STORAGE_READ:
+            result = da_read_at(request->position, request->buffer, request->size);
+            break;
+        case STORAGE_COMMIT:
+            result = da_commit();
+            break;
+        case STORAGE_CHECKPOINT:
+            result = da_checkpoint();
+            break;
+        case STORAGE_CLEAR:
+            result = da_clear_cursor(request->cursor);
+            break;
+        case STORAGE_CLOSE:
+            result = da_close();
+            break;
+        case STORAGE_BENCHMARK:
+            result = da_benchmark(&benchmark);
+            break;
+        case STORAGE_MOUNT:
+            overflow_init(); // frames from before the reset go to the card first
+            result = da_load();
+            storage_mount_ticks = Clock_getTicks();
+            if (storage_mount_fxn) storage_mount_fxn(result);
+            storage_mount_status = result;
+            if (storage_task_created) {
+                Semaphore_post(storage_ready);
+                Semaphore_post(storage_buffer_mailbox); // the frames that waited for the card
+            }
+            break;
+        default:
+            result = DISK_FAILED_READ;
+    }
+
+    if (request->result) *request->result = result;
+    if (request->done) Semaphore_post(request->done);
+}
+
+// takes the oldest request off the queue, returns 0 when there is none
+static uint8_t Storage_next(struct StorageRequest* request) {
+    uint8_t found = 0;
+    UInt key = Hwi_disable();
+
+    if (storage_queue_count) {
+        *request = storage_queue[storage_queue_head];
+        storage_queue_head = (storage_queue_head + 1) % MEMORY_STORAGE_QUEUE_LENGTH;
+        storage_queue_count--;
+        found = 1;
+    }
+    Hwi_restore(key);
+    return found;
+}
+
+int Storage_submit(const struct StorageRequest* request) {
+    if (request->result) *request->result = STORAGE_PENDING;
+    if (!storage_task_created) {
+        Storage_service(request);
+        return DISK_SUCCESS;
+    }
+
+    UInt key = Hwi_disable();
+    if (storage_queue_count == MEMORY_STORAGE_QUEUE_LENGTH) {
+        Hwi_restore(key);
+        return DISK_BUSY;
+    }
+    storage_queue[(storage_queue_head + storage_queue_count) % MEMORY_STORAGE_QUEUE_LENGTH] = *request;
+    storage_queue_count++;
+    Hwi_restore(key);
+
+    Semaphore_post(storage_buffer_mailbox);
+    return DISK_SUCCESS;
+}
+
+int Storage_mount(void) {
+    struct StorageRequest request = { STORAGE_MOUNT, DA_CURSOR_DEFAULT, 0, 0, NULL, NULL, NULL };
+
+    storage_mount_status = STORAGE_PENDING;
+    return Storage_submit(&request);
+}
+
+void Storage_setMountFxn(StorageMountFxn fxn) {
+    storage_mount_fxn = fxn;
+}
+
+int Storage_getMountStatus(void) {
+    return storage_mount_status;
+}
+
+uint8_t Storage_queueFrame(const char* frame, uint8_t length) {
+    uint8_t i, tail;
+    UInt key = Hwi_disable();
+
+    if (length == 0 || storage_ring_used + length + 1 > MEMORY_STORAGE_RING_SIZE) {
+        Hwi_restore(key);
+        return 0;
+    }
+    tail = (storage_ring_head + storage_ring_used) % MEMORY_STORAGE_RING_SIZE;
+    storage_ring[tail] = length;
+    for (i = 0; i < length; i++) storage_ring[(tail + 1 + i) % MEMORY_STORAGE_RING_SIZE] = frame[i];
+    storage_ring_used += length + 1;
+    storage_ring_frames++;
+    Hwi_restore(key);
+
+    if (storage_task_created) Semaphore_post(storage_buffer_mailbox);
+    return 1;
+}
+
+uint8_t Storage_framesWaiting(void) {
+    return storage_ring_frames;
+}
+
+// moves up to STORAGE_OVERFLOW_DRAIN frames from the overflow to the card, returns 1 once it is empty
+static uint8_t Storage_drainOverflow(void) {
+    const char* frame;
+    uint8_t length, drained = 0;
+    int position;
+
+    while ((frame = overflow_peek(&length)) != NULL) {
+        if (drained == STORAGE_OVERFLOW_DRAIN) return 0;
+
+        position = da_get_write_pos();
+        if (da_write((char*) frame, length) != DISK_SUCCESS) {
+            da_set_write_pos(position);
+            return 0;
+        }
+        overflow_pop();
+        pipelineStats.framesStored++;
+        pipelineStats.overflowDrained++;
+        drained++;
+    }
+    return 1;
+}
+
+// writes a frame given in two pieces (the ring wraps) whole to the card, or else to the overflow
+static void Storage_writeFrame(char* frame, uint8_t length, char* rest, uint8_t restLength) {
+    int position;
+
+    if (storage_mount_status != DISK_SUCCESS) storage_status = 1;
+    // the frames in the overflow are older and go first
+    else if (Storage_drainOverflow()) {
+        position = da_get_write_pos();
+        if (da_write(frame, length) == DISK_SUCCESS && (restLength == 0 || da_write(rest, restLength) == DISK_SUCCESS)) {
+            storage_status = 0;
+            pipelineStats.framesStored++;
+            return;
+        }
+        da_set_write_pos(position);
+        storage_status = 1;
+    }
+
+    if (overflow_push(frame, length, rest, restLength)) pipelineStats.framesOverflowed++;
+    else {
+        storage_status = 1;
+        pipelineStats.writeFailures++;
+    }
+}
+
+// writes the oldest frame of the ring straight from the ring, returns 0 when it is empty
+static uint8_t Storage_writeRingFrame(void) {
+    uint8_t length, start, first;
+    UInt key;
+
+    if (storage_ring_frames == 0) return 0;
+
+    // the producer only ever adds behind the frames, so these bytes stay put until we let go of them
+    length = storage_ring[storage_ring_head];
+    start = (storage_ring_head + 1) % MEMORY_STORAGE_RING_SIZE;
+    first = MEMORY_STORAGE_RING_SIZE - start < length ? MEMORY_STORAGE_RING_SIZE - start : length;
+    Storage_writeFrame((char*) storage_ring + start, first, (char*) storage_ring, length - first);
+
+    key = Hwi_disable();
+    storage_ring_head = (storage_ring_head + length + 1) % MEMORY_STORAGE_RING_SIZE;
+    storage_ring_used -= length + 1;
+    storage_ring_frames--;
+    Hwi_restore(key);
+    return 1;
+}
+
 static void Storage_taskFxn(UArg a0, UArg a1) {
-    Storage_init();
+    struct StorageRequest request;
 
     while (true) {
+        // posted for a frame in storage_buffer or the ring and for every request
         Semaphore_pend(storage_buffer_mailbox, BIOS_WAIT_FOREVER);
-        storage_status = 0;
 
-        if (da_write(storage_buffer, storage_buffer_length) != DISK_SUCCESS) storage_status = 1;
+        // a card that was missing or failed the mount is tried again, the frames keep going to the overflow meanwhile
+        if (storage_mount_status != STORAGE_PENDING && storage_mount_status != DISK_SUCCESS
+                && Clock_getTicks() - storage_mount_ticks >= STORAGE_REMOUNT_PERIOD) {
+            request.type = STORAGE_MOUNT;
+            request.result = NULL;
+            request.done = NULL;
+            Storage_service(&request);
+        }
+
+        // frames wait until the card is mounted, the mount posts the mailbox again
+        if (storage_mount_status != STORAGE_PENDING) {
+            // the frame in storage_buffer is older than the ones in the ring
+            if (storage_buffer_length) {
+                Storage_writeFrame(storage_buffer, storage_buffer_length, NULL, 0);
+                storage_buffer_length = 0;
+                Semaphore_post(storage_buffer_mutex);
+            }
+            while (Storage_writeRingFrame());
+            if (storage_mount_status == DISK_SUCCESS) Storage_drainOverflow(); // the card is back, or has time to spare
+        }
 
-        Semaphore_post(storage_buffer_mutex);
+        while (Storage_next(&request)) Storage_service(&request);
     }
 }
 
 void Storage_init() {
     Semaphore_Params bufParams;
     Semaphore_Params mailParams;
+    Semaphore_Params readyParams;
 
 
     Semaphore_Params_init(&bufParams);
     Semaphore_Params_init(&mailParams);
+    Semaphore_Params_init(&readyParams);
 
     bufParams.mode = Semaphore_Mode_BINARY;
     mailParams.mode = Semaphore_Mode_BINARY;
+    readyParams.mode = Semaphore_Mode_BINARY;
 
     Semaphore_construct(&storage_buffer_mutex_struct, 1, &bufParams);
     Semaphore_construct(&storage_buffer_mailbox_struct, 0, &mailParams);
+    Semaphore_construct(&storage_ready_struct, 0, &readyParams);
 
     storage_buffer_mutex = Semaphore_handle(&storage_buffer_mutex_struct);
     storage_buffer_mailbox = Semaphore_handle(&storage_buffer_mailbox_struct);
+    storage_ready = Semaphore_handle(&storage_ready_struct);
 
 }
 
 void Storage_createTask(void) {
   Task_Params taskParams;
 
+  // ready before anybody can hand the task a frame or a request
+  Storage_init();
+  storage_task_created = 1;
+
   // Configure task
   Task_Params_init(&taskParams);
   taskParams.stack = storageTaskStack;
@@ -71,6 +310,7 @@ void Storage_createTask(void) {
   taskParams.priority = STORAGE_TASK_PRIORITY;
 
   Task_construct(&storageTask, Storage_taskFxn, &taskParams, NULL);
+  telemetry_register_task(Task_handle(&storageTask), "stor");
 }
 
 char* Storage_get_transaction_buffer() {
@@ -10,10 +10,60 @@ extern Semaphore_Handle storage_buffer_mutex;
 extern char storage_buffer[];
 extern uint8_t storage_buffer_length;
 
+// posted once the card is mounted, or failed to, see Storage_mount
+extern Semaphore_Handle storage_ready;
+
+// Everything but the frames handed over in storage_buffer reaches the SD card through these
+// requests. The storage task services them in order after the pending frame, so only it ever
+// touches the DiskAccess sector cache and nobody else blocks on the card.
+#define STORAGE_READ            0   // size bytes at position into buffer, see da_read_at
+#define STORAGE_COMMIT          1   // da_commit
+#define STORAGE_CHECKPOINT      2   // da_checkpoint
+#define STORAGE_CLEAR           3   // da_clear_cursor on the request's cursor
+#define STORAGE_CLOSE           4   // da_close, which commits first
+#define STORAGE_BENCHMARK       5   // da_benchmark, the results from da_get_benchmark
+#define STORAGE_MOUNT           6   // da_load, see Storage_mount
+
+#define STORAGE_PENDING         0   // *result until the request is done, no DISK_ status is 0
+
+struct StorageRequest {
+    uint8_t type;
+    uint8_t cursor;             // of STORAGE_CLEAR, taken when the request is made since the selection can change until it is done
+    uint16_t size;
+    unsigned long position;
+    char* buffer;               // owned by the storage task until the request is done
+    volatile int* result;       // gets the DISK_ status, may be NULL
+    Semaphore_Handle done;      // posted when the request is done, may be NULL
+};
+
+// runs in the storage task right after the mount with the da_load status, before any frame is written
+typedef void (*StorageMountFxn)(int status);
+
 void Storage_init();
 extern void Storage_createTask(void);
 uint8_t getStatus();
 
+// Mounts the card in the storage task, so a slow or missing card doesn't hold up the caller.
+// Until then frames wait in storage_buffer and the frame ring, and only the storage task
+// touches DiskAccess. Without a card, and whenever a write fails, frames go to the overflow
+// in internal flash (Overflow.h) and on to the card once it takes writes again. A failed
+// mount is done again on the first storage task wakeup 10 s after it, with the mount fxn
+// and storage_ready like the first one.
+int Storage_mount(void);
+void Storage_setMountFxn(StorageMountFxn fxn);
+// STORAGE_PENDING until the mount is done, then the da_load status
+int Storage_getMountStatus(void);
+
+// Frames the producer couldn't hand over in storage_buffer wait in a ring of MEMORY_STORAGE_RING_SIZE
+// bytes. The frame in storage_buffer is always the oldest, so it is only used while the ring is empty.
+// Returns 0 when the frame doesn't fit. Safe from any context.
+uint8_t Storage_queueFrame(const char* frame, uint8_t length);
+uint8_t Storage_framesWaiting(void);
+
+// queues a copy of request, DISK_BUSY when the queue is full. Until the storage task
+// is created requests are done right away in the caller.
+int Storage_submit(const struct StorageRequest* request);
+
 //TODO: remove this dangerous function
 char* Storage_get_transaction_buffer();
 
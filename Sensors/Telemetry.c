@@ -0,0 +1,79 @@
+#include "Telemetry.h"
+#include "BlockPool.h"
+#include "PowerModel.h"
+#include <string.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/utils/Load.h>
+#include <xdc/runtime/System.h>
+
+static Task_Handle handles[TELEMETRY_MAX_TASKS];
+static struct Telemetry telemetry;
+static uint32_t last_sample;
+
+void telemetry_register_task(Task_Handle task, const char* name) {
+    if (!task || telemetry.numTasks == TELEMETRY_MAX_TASKS) return;
+
+    struct TaskTelemetry* entry = &telemetry.tasks[telemetry.numTasks];
+    strncpy(entry->name, name, TELEMETRY_NAME_LENGTH);
+    handles[telemetry.numTasks++] = task;
+}
+
+void telemetry_heap(uint32_t totalSize, uint32_t totalFree, uint32_t largestFree) {
+    struct HeapTelemetry* heap = &telemetry.heap;
+
+    heap->totalSize = totalSize;
+    heap->totalFree = totalFree;
+    heap->largestFree = largestFree;
+    if (totalFree < heap->minFree || heap->minFree == 0) heap->minFree = totalFree;
+}
+
+static uint16_t telemetry_load(Task_Handle task) {
+    Load_Stat stat;
+
+    if (!Load_getTaskLoad(task, &stat) || stat.totalTime == 0) return 0;
+    return (uint64_t) stat.threadTime * 1000 / stat.totalTime;
+}
+
+void telemetry_sample() {
+    struct HeapTelemetry* heap = &telemetry.heap;
+    Task_Stat stat;
+
+    for (uint8_t i = 0; i < telemetry.numTasks; i++) {
+        struct TaskTelemetry* entry = &telemetry.tasks[i];
+
+        Task_stat(handles[i], &stat);
+        entry->stackSize = stat.stackSize;
+        if (stat.used > entry->stackPeak) entry->stackPeak = stat.used;
+        entry->load = telemetry_load(handles[i]);
+        if (entry->load > entry->peakLoad) entry->peakLoad = entry->load;
+    }
+    telemetry.cpuLoad = 1000 - telemetry_load(Task_getIdleTask());
+
+    heap->fragmentation = heap->totalFree ? 1000 - (uint64_t) heap->largestFree * 1000 / heap->totalFree : 0;
+    if (heap->fragmentation > heap->maxFragmentation) heap->maxFragmentation = heap->fragmentation;
+
+    telemetry.poolMinFree = blockpool_get_min_free();
+    telemetry.samples++;
+    last_sample = Clock_getTicks();
+    power_enter(power_get_state()); // keeps the power model ahead of the Clock tick wrap
+}
+
+uint8_t telemetry_poll() {
+    if (telemetry.samples && Clock_getTicks() - last_sample < TELEMETRY_PERIOD) return 0;
+    telemetry_sample();
+    return 1;
+}
+
+void telemetry_get(struct Telemetry* result) {
+    *result = telemetry;
+}
+
+int telemetry_format(char* buffer, uint8_t task) {
+    if (task >= telemetry.numTasks) return 0;
+
+    struct TaskTelemetry* entry = &telemetry.tasks[task];
+    char name[TELEMETRY_NAME_LENGTH + 1] = { 0 };
+    memcpy(name, entry->name, TELEMETRY_NAME_LENGTH);
+    return System_sprintf(buffer, "%s: stack %u of %u, load %u.%u%% peak %u.%u%%\n", name, entry->stackPeak, entry->stackSize,
+                          entry->load / 10, entry->load % 10, entry->peakLoad / 10, entry->peakLoad % 10);
+}
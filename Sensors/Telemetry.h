@@ -0,0 +1,55 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <ti/sysbios/knl/Task.h>
+
+// Samples of the application tasks and the heap for the Diagnostics
+// characteristic: stack high-water marks from Task_stat, the CPU share of
+// every task from the Load module and the heap numbers the application loop
+// gets from ICall_getHeapStats. Needs Load and Task.initStackFlag in app_ble.cfg.
+
+#define TELEMETRY_MAX_TASKS     4
+#define TELEMETRY_PERIOD        100000 // Clock ticks between samples, 1 s
+#define TELEMETRY_NAME_LENGTH   4
+
+struct TaskTelemetry {
+    char name[TELEMETRY_NAME_LENGTH];
+    uint16_t stackSize;
+    uint16_t stackPeak;         // most of the stack ever in use
+    uint16_t load;              // share of the CPU over the last Load window, 0.1 %
+    uint16_t peakLoad;
+};
+
+struct HeapTelemetry {
+    uint32_t totalSize;
+    uint32_t totalFree;
+    uint32_t minFree;           // lowest totalFree seen since boot
+    uint32_t largestFree;       // largest free block at the last sample
+    uint16_t fragmentation;     // 1 - largestFree / totalFree at the last sample, 0.1 %
+    uint16_t maxFragmentation;
+};
+
+struct Telemetry {
+    uint32_t samples;
+    uint16_t cpuLoad;           // everything but the idle task, 0.1 %
+    uint8_t numTasks;
+    uint8_t poolMinFree;        // fewest BlockPool blocks free at once
+    struct HeapTelemetry heap;
+    struct TaskTelemetry tasks[TELEMETRY_MAX_TASKS];
+};
+
+// name is cut to TELEMETRY_NAME_LENGTH characters
+void telemetry_register_task(Task_Handle task, const char* name);
+
+// called with every ICall_getHeapStats, keeps the minimum
+void telemetry_heap(uint32_t totalSize, uint32_t totalFree, uint32_t largestFree);
+
+// samples the tasks once TELEMETRY_PERIOD passed since the last sample, returns 1 if it did
+uint8_t telemetry_poll();
+void telemetry_sample();
+
+void telemetry_get(struct Telemetry* telemetry);
+int telemetry_format(char* buffer, uint8_t task);
+
+#endif
@@ -74,7 +74,8 @@
  */
 
 /* 48 hour code Notes
-You also need to set the FOURTYEIGHT boolian in a different file to true -> FILE SIMPLE_PERIPHERAL.C -> LINE 710
+48 hour code is switched by CONFIG_FLAG_FOURTYEIGHT in the acquisition config (on by default, see Config.c).
+The config can be changed over the BACPAC Config characteristic and is saved in SNV, no reflash needed.
  */
 
 // CODE VERSION 1.1
@@ -98,6 +99,7 @@ You also need to set the FOURTYEIGHT boolian in a different file to true -> FILE
 #include <ti/drivers/power/PowerCC26XX.h>
 #include <ti/sysbios/BIOS.h>
 #include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Clock.h>
 #include <xdc/runtime/Types.h>
 #include <xdc/runtime/Timestamp.h>
 #include <ti/drivers/SD.h>
@@ -107,10 +109,22 @@ You also need to set the FOURTYEIGHT boolian in a different file to true -> FILE
 /* Board Header file */
 #include "Board.h"
 #include "DiskAccess.h"
+#include "FatExport.h"
 #include "Storage.h"
+#include "Overflow.h"
 #include "Serializer.h"
 #include "sensors.h"
 #include "ImpedanceCalc.h"
+#include "LiveStream.h"
+#include "Filter.h"
+#include "Scheduler.h"
+#include "Config.h"
+#include "Profiler.h"
+#include "Stats.h"
+#include "Telemetry.h"
+#include "MemoryPlan.h"
+#include "BlockPool.h"
+#include "PowerModel.h"
 
 /////////////////////////// pin configuration ///////////////////////
 /* Pin driver handles */
@@ -123,31 +137,32 @@ static PIN_State muxPinState;
 uint8_t muxmod = 0; // allocates which sensor is being read (Values 0-15)
 uint16_t adcValue = 0; // adc read
 float impedance = 0; // impedance (resistance) calculated for the current sensor
-char *uartBuf; // used to store data that will then be output to the serial monitor
+char uartBuf[MEMORY_UART_BUF_SIZE]; // used to store data that will then be output to the serial monitor
+char liveFrame[LIVESTREAM_FRAME_SIZE]; // serialized frame handed to the BLE live stream
 uint8_t stutter = 0; //checks to make sure we don't stutter more than 3 times in one cycle
 const uint8_t channels = 16; //the number of channels corresponds to the number of sensors and should always be 16.
 const uint8_t DACTIMER_CASE_COUNT = 3;
 const float PERIOD_OF_TIME = 1.2522821; // time it takes to complete one round through the DACtimercallback
 uint8_t res1 = 0; // confirms an adcRead read properly
 uint8_t counterCYCLE = 0; // counts the number of DACtimerCallbacks between every output
-uint8_t successImpAdd[channels] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }; // records the number of successful impedance values added to impSum for that cycle
-float impSum[channels] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }; // compiles impedance values
+uint8_t successImpAdd[NUM_SENSORS] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }; // records the number of successful impedance values added to impSum for that cycle
+float impSum[NUM_SENSORS] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }; // compiles impedance values
 float milliseconds = 0; // current time stamp
-uint8_t sensorValues[channels] = { 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125 }; //initial tap value for each sensor (the tap value is a measure of the resistance of the potentiometer (variable resistor) in the circuit)
-const uint16_t HIGHCUTSHIGH = 2770; // high tap values upper bound
-const uint16_t LOWCUTSHIGH = 2730; // high tap values lower bound
-const uint16_t HIGHCUTSLOW = 2500; // low tap values upper bound
-const uint16_t LOWCUTSLOW = 2250; // low tap values lower bound
-const uint16_t HIGHCUTSHIGHTHREE = 2700; // high tap values upper bound
-const uint16_t LOWCUTSHIGHTHREE = 2200; // high tap values lower bound
-const uint16_t HIGHCUTSLOWTHREE = 2600; // low tap values upper bound
-const uint16_t LOWCUTSLOWTHREE = 1000; // low tap values lower bound
+uint8_t sensorValues[NUM_SENSORS] = { 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125, 125 }; //initial tap value for each sensor (the tap value is a measure of the resistance of the potentiometer (variable resistor) in the circuit)
+// the cutoffs, CALIBRATE, FOURTYEIGHT, MUXFREQ and the acquisition schedule come from the acquisition config (see Config.c for the defaults)
+struct AcquisitionConfig acquisitionConfig; // config that is running, version 0 until Sensors_configure is called
+uint16_t HIGHCUTSHIGH; // high tap values upper bound
+uint16_t LOWCUTSHIGH; // high tap values lower bound
+uint16_t HIGHCUTSLOW; // low tap values upper bound
+uint16_t LOWCUTSLOW; // low tap values lower bound
+uint16_t HIGHCUTSHIGHTHREE; // high tap values upper bound
+uint16_t LOWCUTSHIGHTHREE; // high tap values lower bound
+uint16_t HIGHCUTSLOWTHREE; // low tap values upper bound
+uint16_t LOWCUTSLOWTHREE; // low tap values lower bound
 const uint8_t CALIBRATION_LIMIT = 8; // the lower tap values don't quite reach 3000 so we need lower cutoffs. This is the point where these different cutoffs apply.
 const uint8_t CALIBRATION_LIMITTHREE = 4; // the lower tap values don't quite reach 3000 so we need lower cutoffs. This is the point where these different cutoffs apply.
 const uint8_t TAP_HIGHEST_VALUE = 254; // highest tap value possible
 const uint8_t TAP_LOWEST_VALUE = 1; // lowest tap value possible
-const uint8_t NUM_CYCLES_PER_OUTPUT = 5; // How many cycles through DACTimerCallback before one output
-const uint8_t NUM_CYCLES_PER_EMG_OUTPUT = 6; // Has to be a factor  of 3
 const uint8_t lastAmp = 250; //Initialize all sensors to the value (in milli-amps) you want to run the signal.
 const uint8_t V_ONE_THREE_DAC = 93; //Initialize all sensors to the value (in milli-amps) you want to run the signal.
 int8_t adjust_tap = 0; // p controller shifting tap value
@@ -156,18 +171,24 @@ const uint16_t target_adc = 2750; // target adc value for p controller
 const float kp_value_high = .0065; // p controller
 const float kp_value_low = .002; // p controller
 float milvolt = 0;
-const bool CALIBRATE = false; // false runs functional code.  true runs calibration code
-const bool FOURTYEIGHT = true; // runs 48 hour code. Will immediately start writing data to sd card when device turned on.
+bool CALIBRATE = false; // false runs functional code.  true runs calibration code
+bool FOURTYEIGHT = true; // runs 48 hour code. Will immediately start writing data to sd card when device turned on.
 const bool VONETHREE = false; // changes made to account for new board version 1.31. Set to true if handling new board.
-bool EMG = false; // changes made to account for EMG
-const bool EMGIMP = false; // setting this to true will output both EMG and Impedance. The frequency of each will depend on what these variables. NUM_CYCLES_PER_OUTPUT is the number of impedance samples per one outpu. NUM_CYCLES_PER_EMG_OUTPUT  is num of EMG samples per one output.  Code will always output one line EMG then one line impedance.
+bool EMG = false; // true while the scheduler runs an EMG block
+bool modeSwitchPending = false; // set when the next schedule slot runs in the other mode
 bool sumSample = false;
 int readposition = 0;
-int startposition = 0;
 uint8_t AUTOMATE = 1; // AUTOCAL - increments tap.
 unsigned char ucCommand[3];
 const float MV_SCALE = 8.056640625; // (3300.0/4096.0)
-const uint16_t MUXFREQ = 800; // Frequency (the number of channels to be read per second). Must be less than half of DAC frequency (~line 320).
+uint16_t MUXFREQ = 800; // Frequency (the number of channels to be read per second). Must be less than half of DAC frequency (~line 320).
+bool timersRunning = false; // true between Sensors_start_timers and Sensors_stop_timers
+static bool sensorsBooted = false; // Sensors_init ran, the CONFIG_FLAGS_BOOT flags are fixed until the next boot
+static Clock_Struct burstClock; // starts a burst every acquisitionConfig.burstPeriod seconds
+static uint32_t burstIndex = 0; // bursts started in this recording
+static uint8_t burstFramesLeft = 0; // full frames still to read in the running burst
+static bool burstEndPending = false; // the last frame of the burst is done, stop at the start of the next round
+bool DEADBAND_LOGGING = false; // CONFIG_FLAG_DEADBAND, only writes channels to the SD card when they leave the deadband around their last written value
 
 /* Starting sector to write/read to on the SD card*/
 #define STARTINGSECTOR 0
@@ -207,6 +228,11 @@ void DACtimerCallback(GPTimerCC26XX_Handle handle, GPTimerCC26XX_IntMask interru
 void muxPinReset(uint8_t muxmod_GS, bool autocal);
 void muxPower(uint8_t power);
 void Sensors_serializer_output();
+static void Sensors_set_timer_load();
+static void Sensors_timer_tick();
+static void Sensors_start_burst();
+static void Sensors_burst_clock(UArg arg);
+static int Sensors_write_index(char* buffer, int maxLength);
 
 /* Driver handles */
 GPTimerCC26XX_Handle hDACTimer;
@@ -229,7 +255,8 @@ void uartCallback(UART_Handle handle, void *buf, size_t count){
 //                              ======== MAIN THREAD ========
 // this function is run immediately when the PCB is programmed. Any time you reset the PCB it will run again.
 void Sensors_init(){
-    uartBuf = (char*) malloc(256 * sizeof(char));
+    profiler_init();
+    power_reset();
     // Initialize Variables
     if (!VONETHREE)Signal.ampAC = lastAmp; //Set the Signal to what it is initialized to in the array declared on line 138 (lastAmp[])
     else Signal.ampAC = V_ONE_THREE_DAC; // Set the V1.31 DAC to the correct value and leave it.  Allows for better calibration
@@ -238,6 +265,14 @@ void Sensors_init(){
     ADC_init();
     GPIO_init();
     da_initialize();
+    da_set_index_fxn(Sensors_write_index);
+
+    if (acquisitionConfig.version != CONFIG_VERSION) { // nothing was configured before init, run the defaults
+        struct AcquisitionConfig config;
+        config_default(&config);
+        Sensors_configure(&config);
+    }
+    sensorsBooted = true;
 
     ////////////////////////////////////////////// GPIO /////////////////////////////////////////
     /* Configure the LED pins */
@@ -308,10 +343,13 @@ void Sensors_init(){
         print(uartBuf);
         while (1);
     }
-    GPTimerCC26XX_Value loadValDAC = 48000000 / (MUXFREQ * DACTIMER_CASE_COUNT);
-    loadValDAC = loadValDAC - 1;
-    GPTimerCC26XX_setLoadValue(hDACTimer, loadValDAC);
+    Sensors_set_timer_load();
     GPTimerCC26XX_registerInterrupt(hDACTimer, DACtimerCallback, GPT_INT_TIMEOUT);
+
+    // duty cycled recording, the period is set when the recording starts
+    Clock_Params clockParams;
+    Clock_Params_init(&clockParams);
+    Clock_construct(&burstClock, Sensors_burst_clock, 1, &clockParams);
     // Open I2C
     I2Chandle = I2C_open(Board_I2C0, &I2Cparams);
     if (I2Chandle == NULL){
@@ -364,8 +402,8 @@ void Sensors_init(){
     }
     if (CALIBRATE) Sensors_start_timers(); // AUTOCAL - starts spitting out data immediately.
     else {
-        DA_get_status(da_load(), "Loading Disk"); // BLUETOOTH
-        startposition = da_get_read_pos();
+        if (acquisitionConfig.flags & CONFIG_FLAG_FAT_EXPORT) da_set_export(FAT_EXPORT_FILE_SECTORS, FAT_EXPORT_FILES);
+        Storage_mount(); // in the storage task, the application reports the status once storage_ready is posted
     }
     if (FOURTYEIGHT) Sensors_start_timers();
 }
@@ -374,23 +412,225 @@ void Sensors_init(){
 static void i2cWriteCallback(I2C_Handle handle, I2C_Transaction *transac, bool result){
     // Set length bytes
     if (result) transferDone = true;
-    else transferDone = false; // Transaction failed, act accordingly...
+    else {
+        transferDone = false; // Transaction failed, act accordingly...
+        pipelineStats.i2cFailures++;
+    }
 };
 
-// this is where the bulk of the functionality of this file takes place.
+// reads the adc once and retries a single time if the conversion failed
+static uint8_t Sensors_read_adc() {
+    uint32_t start = profiler_now();
+    uint8_t res = ADC_convert(adc, &adcValue); // read the current adc Value
+    if (res != ADC_STATUS_SUCCESS) {
+        res = ADC_convert(adc, &adcValue);
+        if (res == ADC_STATUS_SUCCESS) pipelineStats.adcRetries++;
+        else pipelineStats.adcFailures++;
+    }
+    profiler_record(PROFILER_ADC_READ, profiler_now() - start);
+    return res;
+}
+
+// counts full rounds through the channels and flags when the slot's averaging is done
+static void Sensors_count_cycle() {
+    uint8_t cycles = scheduler_current()->cyclesPerOutput;
+    if (counterCYCLE < cycles && muxmod == 0) counterCYCLE++;
+    if (counterCYCLE >= cycles) sumSample = true;
+}
+
+// moves on to the next sensor channel
+static void Sensors_next_channel() {
+    muxmod++;
+    if (muxmod == channels) muxmod = 0; // reset counter back to zero if it equals the number of channels
+}
+
+// decimates the averages of the current slot down to the filterOutputRate of the config, slots that average more cycles need less of it
+static void Sensors_set_decimation() {
+    filter_set_decimation(filter_decimation_for_rate(MUXFREQ / (channels * scheduler_current()->cyclesPerOutput), acquisitionConfig.filterOutputRate));
+}
+
+/*
+ * Reconfigures the DAC, potentiometer and mux for a new mode. Runs once at the start of a mode block and
+ * takes the whole timer tick so the signal settles before the first read of the block.
+ */
+static void Sensors_set_mode(uint8_t mode) {
+    modeSwitchPending = false;
+    EMG = (mode == ACQ_MODE_EMG);
+    serializer_setMode(EMG ? SERIALIZER_MODE_EMG : SERIALIZER_MODE_IMPEDANCE);
+    filter_reset(); // don't smooth EMG values into impedance values
+    Sensors_set_decimation();
+
+    if (!VONETHREE) {
+        if (EMG) Signal.ampAC = 0;
+        else Signal.ampAC = lastAmp; // High signal.
+        txBuffer1[0] = Signal.ampAC >> 8; //high byte
+        txBuffer1[1] = Signal.ampAC; //low byte
+        I2C_transfer(I2Chandle, &i2cTrans1);
+    }
+
+    // start the block on the first channel with nothing averaged yet
+    muxmod = 0;
+    counterDAC = 0;
+    counterCYCLE = 0;
+    stutter = 0;
+    sumSample = false;
+    for (uint8_t i = 0; i < channels; i++) {
+        impSum[i] = 0;
+        successImpAdd[i] = 0;
+    }
+    adcValue = 0;
+    impedance = 0;
+
+    muxPinReset(muxmod, CALIBRATE);
+    txBuffer3[0] = 0;
+    if (EMG) txBuffer3[1] = 1;
+    else if (CALIBRATE) txBuffer3[1] = AUTOMATE;
+    else txBuffer3[1] = sensorValues[muxmod];
+    I2C_transfer(I2Chandle, &i2cTrans3);
+    muxPower(1);
+}
+
+// EMG Code collects 3 times as fast as normal impedance code: one channel on every DACtimerCallback
+static void Sensors_emg_sample() {
+    if (VONETHREE) stutter = 10; // the v1.31 board has no stutter limit, same as the impedance read
+    res1 = Sensors_read_adc();
+    // designed for v1.2 board with 12 bit adc read on 3.3 Volts
+    if ((adcValue < 2950) || (stutter > 3)){
+        milvolt = (adcValue * MV_SCALE); // required calibration for EMG
+        if (res1 == ADC_STATUS_SUCCESS){
+            impSum[muxmod] += milvolt; // if ,adc read correctly we want to add the calculated voltage to a sum to be averaged later
+            successImpAdd[muxmod] += 1; // increment number of successful values added this round
+        }
+    }
+    Sensors_count_cycle();
+    Sensors_serializer_output();
+    GPIO_write(Board_GPIO_LED1, Board_GPIO_LED_OFF);
+    Sensors_next_channel();
+
+    /////////// RESET MUX FOR NEXT  READ ///////////
+    muxPinReset(muxmod, CALIBRATE); // convert the mux to new setting to account for next sensor channel
+    // To prevent values carrying over from cycle to cycle.
+    adcValue = 0;
+    impedance = 0;
+}
+
+// the DAC timer runs DACTIMER_CASE_COUNT times for every channel read
+static void Sensors_set_timer_load() {
+    GPTimerCC26XX_Value loadValDAC = 48000000 / (MUXFREQ * DACTIMER_CASE_COUNT);
+    loadValDAC = loadValDAC - 1;
+    GPTimerCC26XX_setLoadValue(hDACTimer, loadValDAC);
+    profiler_set_period(loadValDAC + 1); // cpu cycles, the timer runs off the same 48 MHz clock
+}
+
+/*
+ * Sensors_configure validates and applies an acquisition config. It can be called before Sensors_init and while
+ * recording, in which case the timers are stopped, reprogrammed and started again with the new schedule.
+ * CALIBRATE, FOURTYEIGHT and FAT_EXPORT (CONFIG_FLAGS_BOOT) decide what Sensors_init does on power up. Once it ran they
+ * keep the values the board booted with, so the running config and the ISR don't change mode; a config saved with
+ * other ones takes effect on the next boot.
+ */
+uint8_t Sensors_configure(const struct AcquisitionConfig* config) {
+    if (!config_validate(config)) return 0;
+
+    bool running = timersRunning;
+    if (running) Sensors_stop_timers();
+
+    uint8_t bootFlags = acquisitionConfig.flags & CONFIG_FLAGS_BOOT;
+    acquisitionConfig = *config;
+    if (sensorsBooted) acquisitionConfig.flags = (config->flags & ~CONFIG_FLAGS_BOOT) | bootFlags;
+    CALIBRATE = (acquisitionConfig.flags & CONFIG_FLAG_CALIBRATE) != 0;
+    FOURTYEIGHT = (acquisitionConfig.flags & CONFIG_FLAG_FOURTYEIGHT) != 0;
+    DEADBAND_LOGGING = (acquisitionConfig.flags & CONFIG_FLAG_DEADBAND) != 0;
+    MUXFREQ = config->muxFreq;
+    LOWCUTSHIGH = config->lowCutsHigh;
+    HIGHCUTSHIGH = config->highCutsHigh;
+    LOWCUTSLOW = config->lowCutsLow;
+    HIGHCUTSLOW = config->highCutsLow;
+    LOWCUTSHIGHTHREE = config->lowCutsHighThree;
+    HIGHCUTSHIGHTHREE = config->highCutsHighThree;
+    LOWCUTSLOWTHREE = config->lowCutsLowThree;
+    HIGHCUTSLOWTHREE = config->highCutsLowThree;
+
+    scheduler_setTable(config->slots, config->numSlots);
+    EMG = (scheduler_current()->mode == ACQ_MODE_EMG);
+
+    // the decimation depends on the output rate of the slot, Sensors_set_mode sets it
+    struct FilterConfig filterConfig;
+    filterConfig.median = config->filterMedian;
+    filterConfig.iirShift = config->filterIirShift;
+    filterConfig.decimation = 1;
+    filter_configure(&filterConfig);
+
+    struct DeadbandConfig deadbandConfig;
+    deadbandConfig.deadband = config->deadband;
+    deadbandConfig.keyframeInterval = config->keyframeInterval;
+    deadbandConfig.heartbeatInterval = config->heartbeatInterval;
+    serializer_setDeadband(&deadbandConfig);
+
+    if (hDACTimer) Sensors_set_timer_load(); // not opened yet when called before Sensors_init
+
+    if (running) Sensors_start_timers();
+    return 1;
+}
+
+const struct AcquisitionConfig* Sensors_get_config() {
+    return &acquisitionConfig;
+}
+
+// this is where the bulk of the functionality of this file takes place. Every tick is timed by the profiler.
 void DACtimerCallback(GPTimerCC26XX_Handle handle,GPTimerCC26XX_IntMask interruptMask) {
+    uint32_t start = profiler_tick_begin();
+    pipelineStats.ticks++;
+    Sensors_timer_tick();
+    profiler_tick_end(start);
+}
+
+/*
+ * Ends a burst of the duty cycled recording. The front end is powered down and the DAC timer stopped, so
+ * nothing keeps the board out of standby until the burst clock starts the next burst.
+ */
+static void Sensors_end_burst() {
+    burstEndPending = false;
+    GPTimerCC26XX_stop(hDACTimer);
+    muxPower(0);
+    if (!VONETHREE) { // no excitation current between bursts
+        Signal.ampAC = 0;
+        txBuffer1[0] = Signal.ampAC >> 8; //high byte
+        txBuffer1[1] = Signal.ampAC; //low byte
+        I2C_transfer(I2Chandle, &i2cTrans1);
+    }
+    Power_releaseConstraint(PowerCC26XX_SB_DISALLOW);
+    power_enter(POWER_STATE_STANDBY);
+}
+
+static void Sensors_timer_tick() {
+    // bursts end on a frame boundary, at the beginning of an impedance round like a mode switch
+    if (burstEndPending && (EMG || counterDAC == 0)) {
+        Sensors_end_burst();
+        return;
+    }
+
+    // a new mode block starts at the beginning of an impedance round so the potentiometer write of case 2 isn't lost
+    if (modeSwitchPending && (EMG || counterDAC == 0)) {
+        Sensors_set_mode(scheduler_current()->mode);
+        return;
+    }
+
+    if (EMG && !CALIBRATE) {
+        Sensors_emg_sample();
+        counterDAC += 1;
+        if (counterDAC == DACTIMER_CASE_COUNT) {
+            milliseconds = milliseconds + PERIOD_OF_TIME; // End of a cycle. Update current time stamp.
+            counterDAC = 0;
+        }
+        return;
+    }
+
     if (counterDAC == 0){
         if (VONETHREE) stutter = 10;
         ////////// ADC Read  ///////////
-        res1 = ADC_convert(adc, &adcValue); // read the current adc Value
-        switch (res1){
-            case ADC_STATUS_SUCCESS:
-                break;
-            default:
-                res1 = ADC_convert(adc, &adcValue);
-        }
-        if (!EMG) muxPower(0); // turn off MUX to conserve POWER
-        storage_buffer_length = 0; // stores length of the data in the buffer. Useful for writing purposes. Don't know if necessary
+        res1 = Sensors_read_adc();
+        muxPower(0); // turn off MUX to conserve POWER
         //AUTOCAL CODE
         if (CALIBRATE){
             if (muxmod == 0) {
@@ -407,35 +647,11 @@ void DACtimerCallback(GPTimerCC26XX_Handle handle,GPTimerCC26XX_IntMask interrup
                 AUTOMATE++;
                 if (AUTOMATE > 254) AUTOMATE = 2; // calibrate from tap 2 to 253
             }
-            muxmod++;
-            if (muxmod == channels) muxmod = 0; // reset counter back to zero if it equals the number of channels
-        }
-        else if (EMG){
-            // designed for v1.2 board with 12 bit adc read on 3.3 Volts
-            if ((adcValue < 2950) || (stutter > 3)){
-                milvolt = (adcValue * MV_SCALE); // required calibration for EMG
-                if (res1 == ADC_STATUS_SUCCESS){
-                    impSum[muxmod] += milvolt; // if ,adc read correctly we want to add the calculated impedance to a sum to be averaged later
-                    successImpAdd[muxmod] += 1; // increment number of successful impedance values added this round
-                }
-            }
-            if (counterCYCLE < NUM_CYCLES_PER_EMG_OUTPUT && muxmod == 0) counterCYCLE++;
-            if (counterCYCLE >= NUM_CYCLES_PER_EMG_OUTPUT) sumSample = true;
-            Sensors_serializer_output();
-            GPIO_write(Board_GPIO_LED1, Board_GPIO_LED_OFF);
-            muxmod++; // possibly still need something with stutter and checking if this is when we should output.
-            if (muxmod == channels) muxmod = 0; // reset counter back to zero if it equals the number of channels
-
-            /////////// RESET MUX FOR NEXT  READ ///////////
-            muxPinReset(muxmod, CALIBRATE); // convert the mux to new setting to account for next sensor channel
-
-            /////////// RESET POTENTIOMETER  FOR NEXT SENSOR READ ///////////
-            // To prevent values carrying over from cycle to cycle.
-            adcValue = 0;
-            impedance = 0;
+            Sensors_next_channel();
         }
         else {
             ////////// CALCULATE IMPEDANCE //////////
+            uint32_t start = profiler_now();
             if ((adcValue < 2950) || (stutter > 3)){
                 if (adcValue < 400 && !VONETHREE) impedance = 49999.99; // if our adcValue is too low. We don't want to interpret it as valid data.
                 else impedance = impedanceCalc(sensorValues[muxmod], adcValue);
@@ -445,78 +661,55 @@ void DACtimerCallback(GPTimerCC26XX_Handle handle,GPTimerCC26XX_IntMask interrup
                     successImpAdd[muxmod] += 1; // increment number of successful impedance values added this round
                 }
             }
+            profiler_record(PROFILER_IMPEDANCE, profiler_now() - start);
         }
         counterDAC += 1; // increments DACtimerCallback counter to 2
     }
     else if (counterDAC == 1) {
         if (CALIBRATE){}
         else {
-            if (EMG){//EMG Code collects 3 times as fast as normal impedance code
-                res1 = ADC_convert(adc, &adcValue); // read the current adc Value
-                switch (res1){
-                    case ADC_STATUS_SUCCESS:
-                        break;
-                    default:
-                        res1 = ADC_convert(adc, &adcValue);
+            ////////// CHANGE TAP VALUE FOR NEXT READ IF NECESSARY //////////
+            // P Controller
+            uint32_t start = profiler_now();
+            if (!VONETHREE) {
+                if (adcValue < LOWCUTSHIGH){
+                    true_error = LOWCUTSHIGH - adcValue;
+                    adjust_tap = round(true_error * pow(sensorValues[muxmod], 0.7)* kp_value_low); // + kd_value * (true_error - last_error[muxmod]) + ki_value * (i_error[muxmod] + true_error);
+                    if (adjust_tap > 20) adjust_tap = 20; //Arbitrary bounds on the adjustment - we need to make this a PARAMETER (const int) later
+                    if (adjust_tap < 0) adjust_tap = 0; //Arbitrary bounds on the adjustment - we need to make this a PARAMETER (const int) later
+                }
+                else if (adcValue > HIGHCUTSHIGH){
+                    true_error = HIGHCUTSHIGH - adcValue;
+                    adjust_tap = round( true_error * pow(sensorValues[muxmod], 0.7)* kp_value_high); // + kd_value * (true_error - last_error[muxmod]) + ki_value * (i_error[muxmod] + true_error);
+                    if (adjust_tap > 0) adjust_tap = 0; //Arbitrary bounds on the adjustment - we need to make this a PARAMETER (const int) later
+                    if (adjust_tap < -20) adjust_tap = -20; //Arbitrary bounds on the adjustment - we need to make this a PARAMETER (const int) later
                 }
-            // designed for v1.2 board with 12 bit adc read on 3.3 Volts
-                if ((adcValue < 2950) || (stutter > 3)) {
-                    milvolt = (adcValue * MV_SCALE); // required calibration for EMG
-                    if (res1 == ADC_STATUS_SUCCESS){
-                        impSum[muxmod] += milvolt; // if ,adc read correctly we want to add the calculated impedance to a sum to be averaged later
-                        successImpAdd[muxmod] += 1; // increment number of successful impedance values added this round
-                    }
+                if (sensorValues[muxmod] < CALIBRATION_LIMIT && adjust_tap < 3){
+                    if (adcValue < LOWCUTSLOW) sensorValues[muxmod]++; // move up a tap
+                    else if (adcValue > HIGHCUTSLOW) sensorValues[muxmod]--; // move down a tap
                 }
-                storage_buffer_length = 0; // stores length of the data in the buffer. Useful for writing purposes. Don't know if necessary
+                else if (adcValue < LOWCUTSHIGH || adcValue > HIGHCUTSHIGH) sensorValues[muxmod] = sensorValues[muxmod] + adjust_tap;
+                if (sensorValues[muxmod] > TAP_HIGHEST_VALUE) sensorValues[muxmod] = TAP_HIGHEST_VALUE; // if we are out of our tap value range we want to bring it back.
+                    //IF we have an Integral Overrun - reset it here. This is where we'll find it most likely to be pinned (these two walls)
+                else if (sensorValues[muxmod] < TAP_LOWEST_VALUE) sensorValues[muxmod] = TAP_LOWEST_VALUE; // if we are out of our tap value range we want to bring it back.
             }
             else {
-                ////////// CHANGE TAP VALUE FOR NEXT READ IF NECESSARY //////////
-                // P Controller
-                if (!VONETHREE) {
-                    if (adcValue < LOWCUTSHIGH){
-                        true_error = LOWCUTSHIGH - adcValue;
-                        adjust_tap = round(true_error * pow(sensorValues[muxmod], 0.7)* kp_value_low); // + kd_value * (true_error - last_error[muxmod]) + ki_value * (i_error[muxmod] + true_error);
-                        if (adjust_tap > 20) adjust_tap = 20; //Arbitrary bounds on the adjustment - we need to make this a PARAMETER (const int) later
-                        if (adjust_tap < 0) adjust_tap = 0; //Arbitrary bounds on the adjustment - we need to make this a PARAMETER (const int) later
-                    }
-                    else if (adcValue > HIGHCUTSHIGH){
-                        true_error = HIGHCUTSHIGH - adcValue;
-                        adjust_tap = round( true_error * pow(sensorValues[muxmod], 0.7)* kp_value_high); // + kd_value * (true_error - last_error[muxmod]) + ki_value * (i_error[muxmod] + true_error);
-                        if (adjust_tap > 0) adjust_tap = 0; //Arbitrary bounds on the adjustment - we need to make this a PARAMETER (const int) later
-                        if (adjust_tap < -20) adjust_tap = -20; //Arbitrary bounds on the adjustment - we need to make this a PARAMETER (const int) later
-                    }
-                    if (sensorValues[muxmod] < CALIBRATION_LIMIT && adjust_tap < 3){
-                        if (adcValue < LOWCUTSLOW) sensorValues[muxmod]++; // move up a tap
-                        else if (adcValue > HIGHCUTSLOW) sensorValues[muxmod]--; // move down a tap
-                    }
-                    else if (adcValue < LOWCUTSHIGH || adcValue > HIGHCUTSHIGH) sensorValues[muxmod] = sensorValues[muxmod] + adjust_tap;
-                    if (sensorValues[muxmod] > TAP_HIGHEST_VALUE) sensorValues[muxmod] = TAP_HIGHEST_VALUE; // if we are out of our tap value range we want to bring it back.
-                        //IF we have an Integral Overrun - reset it here. This is where we'll find it most likely to be pinned (these two walls)
-                    else if (sensorValues[muxmod] < TAP_LOWEST_VALUE) sensorValues[muxmod] = TAP_LOWEST_VALUE; // if we are out of our tap value range we want to bring it back.
+                if (sensorValues[muxmod] > CALIBRATION_LIMITTHREE) {
+                    if (adcValue < LOWCUTSHIGHTHREE) sensorValues[muxmod]++; // move up a tap
+                    else if (adcValue > HIGHCUTSHIGHTHREE) sensorValues[muxmod]--; // move down a tap
                 }
                 else {
-                    if (sensorValues[muxmod] > CALIBRATION_LIMITTHREE) {
-                        if (adcValue < LOWCUTSHIGHTHREE) sensorValues[muxmod]++; // move up a tap
-                        else if (adcValue > HIGHCUTSHIGHTHREE) sensorValues[muxmod]--; // move down a tap
-                    }
-                    else {
-                        if (adcValue < LOWCUTSLOWTHREE) sensorValues[muxmod]++; // move up a tap
-                        else if (adcValue > HIGHCUTSLOWTHREE) sensorValues[muxmod]--; // move down a tap
-                    }
-                    if (sensorValues[muxmod] > TAP_HIGHEST_VALUE) sensorValues[muxmod] = TAP_HIGHEST_VALUE; // if we are out of our tap value range we want to bring it back.
-                    else if (sensorValues[muxmod] < TAP_LOWEST_VALUE) sensorValues[muxmod] = TAP_LOWEST_VALUE; // if we are out of our tap value range we want to bring it back.
+                    if (adcValue < LOWCUTSLOWTHREE) sensorValues[muxmod]++; // move up a tap
+                    else if (adcValue > HIGHCUTSLOWTHREE) sensorValues[muxmod]--; // move down a tap
                 }
+                if (sensorValues[muxmod] > TAP_HIGHEST_VALUE) sensorValues[muxmod] = TAP_HIGHEST_VALUE; // if we are out of our tap value range we want to bring it back.
+                else if (sensorValues[muxmod] < TAP_LOWEST_VALUE) sensorValues[muxmod] = TAP_LOWEST_VALUE; // if we are out of our tap value range we want to bring it back.
             }
+            profiler_record(PROFILER_CONTROLLER, profiler_now() - start);
             // increment the cycle count unless it stuttered
             if ((adcValue < 2950) || (stutter > 3)) {
-                if (EMG) {
-                    if (counterCYCLE < NUM_CYCLES_PER_EMG_OUTPUT && muxmod == 0) counterCYCLE++;
-                    if (counterCYCLE >= NUM_CYCLES_PER_EMG_OUTPUT) sumSample = true;
-                }
-                else {
-                    if (counterCYCLE < NUM_CYCLES_PER_OUTPUT && muxmod == 0) counterCYCLE++;
-                    if (counterCYCLE >= NUM_CYCLES_PER_OUTPUT) sumSample = true;
-                }
+                if (adcValue >= 2950) pipelineStats.stutterLimited++;
+                Sensors_count_cycle();
                 Sensors_serializer_output();
                 GPIO_write(Board_GPIO_LED1, Board_GPIO_LED_OFF);
 
@@ -524,46 +717,17 @@ void DACtimerCallback(GPTimerCC26XX_Handle handle,GPTimerCC26XX_IntMask interrup
                 /*
                  * IMPORTANT: this is where the sensor we are dealing with changes. i.e. from sensor 1 to sensor 2.  The whole process repeats here.
                  */
-                muxmod++;
-                if (muxmod == channels) muxmod = 0; // reset counter back to zero if it equals the number of channels
+                Sensors_next_channel();
                 stutter = 0;
             }
-            else stutter++;
+            else {
+                stutter++;
+                pipelineStats.stutters++;
+            }
         }
         counterDAC += 1;
-
-        if (EMG){
-            /////////// RESET MUX FOR NEXT  READ ///////////
-            muxPinReset(muxmod, CALIBRATE); // convert the mux to new setting to account for next sensor channel
-            /////////// RESET POTENTIOMETER  FOR NEXT SENSOR READ ///////////
-            // To prevent values carrying over from cycle to cycle.
-            adcValue = 0;
-            impedance = 0;
-        }
     }
     else if (counterDAC == 2){
-        if (EMG){ //EMG Code collects 3 times as fast as normal impedance code
-            res1 = ADC_convert(adc, &adcValue); // read the current adc Value
-            switch (res1){
-                case ADC_STATUS_SUCCESS:
-                    break;
-                default:
-                    res1 = ADC_convert(adc, &adcValue);
-            }
-            if ((adcValue < 2950) || (stutter > 3)){
-                milvolt = (adcValue * MV_SCALE); // required calibration for EMG
-                if (res1 == ADC_STATUS_SUCCESS){
-                    impSum[muxmod] += milvolt; // if ,adc read correctly we want to add the calculated impedance to a sum to be averaged later
-                    successImpAdd[muxmod] += 1; // increment number of successful impedance values added this round
-                }
-           }
-           if (counterCYCLE < NUM_CYCLES_PER_EMG_OUTPUT && muxmod == 0) counterCYCLE++;
-           if (counterCYCLE >= NUM_CYCLES_PER_EMG_OUTPUT) sumSample = true;
-           Sensors_serializer_output();
-           GPIO_write(Board_GPIO_LED1, Board_GPIO_LED_OFF);
-           muxmod++;
-           if (muxmod == channels) muxmod = 0; // reset counter back to zero if it equals the number of channels
-        }
         /////////// RESET MUX FOR NEXT  READ ///////////
         muxPinReset(muxmod, CALIBRATE); // convert the mux to new setting to account for next sensor channel
 
@@ -572,16 +736,16 @@ void DACtimerCallback(GPTimerCC26XX_Handle handle,GPTimerCC26XX_IntMask interrup
         adcValue = 0;
         impedance = 0;
 
-        if (!EMG) {
-            txBuffer3[0] = 0; // 8 bit device so we don't need the high byte
-            // AUTOCAL CODE. Switches muxmod with AUTOMATE.
-            if (CALIBRATE) txBuffer3[1] = AUTOMATE;
-            else txBuffer3[1] = sensorValues[muxmod];
-            I2C_transfer(I2Chandle, &i2cTrans3); // writes to the potentiometer the values from above over I2C communication.
-        }
+        txBuffer3[0] = 0; // 8 bit device so we don't need the high byte
+        // AUTOCAL CODE. Switches muxmod with AUTOMATE.
+        if (CALIBRATE) txBuffer3[1] = AUTOMATE;
+        else txBuffer3[1] = sensorValues[muxmod];
+        uint32_t start = profiler_now();
+        if (!I2C_transfer(I2Chandle, &i2cTrans3)) pipelineStats.i2cFailures++; // writes to the potentiometer the values from above over I2C communication. Fails while the last write is still going.
+        profiler_record(PROFILER_I2C, profiler_now() - start);
         /// Updates milliseconds variable (time stamp)
         milliseconds = milliseconds + PERIOD_OF_TIME; // End of a cycle. Update current time stamp.
-        if (!EMG) muxPower(1); // turn on the MUX for the next read
+        muxPower(1); // turn on the MUX for the next read
         counterDAC = 0; // Reset DACtimerCallback to case 0
     }
 }
@@ -592,17 +756,59 @@ void muxPower(uint8_t power){
 }
 /* Every time we start recording data we need our time stamp and sensor channel to reset to 0 */
 void Sensors_start_timers() {
+    if (timersRunning) Sensors_stop_timers(); // starting again mustn't hold the standby constraint twice
     milliseconds = 0;
-    muxmod = 0;
-    if (EMG) PIN_setOutputValue(muxPinHandle, IOID_28, 0); // set the mux enable on.
-    GPTimerCC26XX_start(hDACTimer);
+    profiler_reset(); // profile each recording on its own
+    stats_reset();
+    serializer_clear(); // frame sequence numbers start over
+    scheduler_reset();
+    power_reset();
+    timersRunning = true;
+    da_set_locked(1); // no disk benchmark while recording
+    burstIndex = 0;
+    burstFramesLeft = 0;
+    burstEndPending = false;
+    if (acquisitionConfig.burstPeriod) {
+        uint32_t period = (uint32_t) acquisitionConfig.burstPeriod * (1000000 / Clock_tickPeriod);
+        Clock_setPeriod(Clock_handle(&burstClock), period);
+        Clock_setTimeout(Clock_handle(&burstClock), period);
+        Clock_start(Clock_handle(&burstClock));
+    }
+    Sensors_start_burst(); // every recording starts with the first slot of the schedule
 }
 /* Every time we stop recording data we clear our serializer because our sensors channel will reset next time we start writing again */
 void Sensors_stop_timers() {
     serializer_clear();
     milliseconds = 0;
-    if (EMG) PIN_setOutputValue(muxPinHandle, IOID_28, 1);
+    if (acquisitionConfig.burstPeriod) Clock_stop(Clock_handle(&burstClock));
     GPTimerCC26XX_stop(hDACTimer);
+    if (burstFramesLeft || burstEndPending) Power_releaseConstraint(PowerCC26XX_SB_DISALLOW); // stopped during a burst
+    burstFramesLeft = 0;
+    burstEndPending = false;
+    timersRunning = false;
+    da_set_locked(0);
+    muxPower(0);
+    power_enter(POWER_STATE_IDLE);
+}
+/*
+ * Powers the front end and starts the DAC timer. Without a burst period this runs once and records until
+ * Sensors_stop_timers, otherwise it reads burstFrames full frames, see Sensors_end_burst.
+ */
+static void Sensors_start_burst() {
+    if (acquisitionConfig.burstPeriod) {
+        Power_setConstraint(PowerCC26XX_SB_DISALLOW); // the timer interrupts have to keep coming until the burst ends
+        burstFramesLeft = acquisitionConfig.burstFrames;
+        milliseconds = (float) burstIndex * acquisitionConfig.burstPeriod * 1000; // frames keep the time since the recording started
+        burstIndex++;
+    }
+    Sensors_set_mode(scheduler_current()->mode);
+    power_enter(POWER_STATE_ACQUIRING);
+    GPTimerCC26XX_start(hDACTimer);
+}
+// Clock function (Swi) of the duty cycled recording
+static void Sensors_burst_clock(UArg arg) {
+    if (!timersRunning || burstFramesLeft || burstEndPending) return; // the last burst is still running
+    Sensors_start_burst();
 }
 /*
  * DA_get_status returns an explanation of what is happening with the SD Card.
@@ -628,12 +834,103 @@ void DA_get_status(int status_code, char *message) {
         case DISK_LOCKED:
             System_sprintf(uartBuf, "%s: Disk locked\n\0", message);
             break;
+        case DISK_NO_MEMORY:
+            System_sprintf(uartBuf, "%s: Out of memory\n\0", message);
+            break;
+        case DISK_FULL:
+            System_sprintf(uartBuf, "%s: Card full of unread data\n\0", message);
+            break;
+        case DISK_BAD_CURSOR:
+            System_sprintf(uartBuf, "%s: No such read cursor\n\0", message);
+            break;
+        case DISK_BUSY:
+            System_sprintf(uartBuf, "%s: Storage queue full\n\0", message);
+            break;
+        case DISK_NOT_MOUNTED:
+            System_sprintf(uartBuf, "%s: Card not mounted yet\n\0", message);
+            break;
         default:
             System_sprintf(uartBuf, "%s: Unknown status: %d\n\0", message, status_code);
     }
     UART_write(uart, uartBuf, strlen(uartBuf));
 }
 
+/*
+ * Sensors_get_stats snapshots the pipeline counters of the current recording and works out the
+ * recording time and the frame rate that actually made it to the card.
+ */
+void Sensors_get_stats(struct PipelineStats* stats) {
+    stats_snapshot(stats);
+    stats->liveDropped = livestream_get_dropped();
+    stats->overflowFrames = overflow_get_frames();
+    stats_set_elapsed(stats, (uint64_t) stats->ticks * 1000 / ((uint32_t) MUXFREQ * DACTIMER_CASE_COUNT));
+}
+
+// keeps the stats of the last recording in the SD card index next to the read and write positions
+static int Sensors_write_index(char* buffer, int maxLength) {
+    struct PipelineStats stats;
+    uint32_t magic = STATS_MAGIC;
+
+    if (maxLength < (int) (sizeof(magic) + sizeof(stats))) return 0;
+    Sensors_get_stats(&stats);
+    memcpy(buffer, &magic, sizeof(magic));
+    memcpy(buffer + sizeof(magic), &stats, sizeof(stats));
+    return sizeof(magic) + sizeof(stats);
+}
+
+void Sensors_print_stats() {
+    struct PipelineStats stats;
+    Sensors_get_stats(&stats);
+    System_sprintf(uartBuf, "stats: %u ms, %u built, %u stored, %u skipped, %u write errors, %u mHz delivered\n",
+                   stats.elapsedMs, stats.framesBuilt, stats.framesStored, stats.framesSkipped, stats.writeFailures, stats.deliveredRate);
+    print(uartBuf);
+    System_sprintf(uartBuf, "stats: adc %u retries %u failures, %u stutters, %u i2c failures\n",
+                   stats.adcRetries, stats.adcFailures, stats.stutters, stats.i2cFailures);
+    print(uartBuf);
+    System_sprintf(uartBuf, "stats: %u deferred, overflow %u written %u drained %u waiting\n",
+                   stats.framesDeferred, stats.framesOverflowed, stats.overflowDrained, stats.overflowFrames);
+    print(uartBuf);
+}
+
+// prints the last telemetry sample of the tasks and the heap
+void Sensors_print_telemetry() {
+    struct Telemetry telemetry;
+    telemetry_get(&telemetry);
+    System_sprintf(uartBuf, "telemetry: %u samples, cpu %u.%u%%, heap %u of %u free, min %u, fragmentation %u.%u%%\n",
+                   telemetry.samples, telemetry.cpuLoad / 10, telemetry.cpuLoad % 10, telemetry.heap.totalFree, telemetry.heap.totalSize,
+                   telemetry.heap.minFree, telemetry.heap.fragmentation / 10, telemetry.heap.fragmentation % 10);
+    print(uartBuf);
+    System_sprintf(uartBuf, "memory: %u of %u static bytes, %u of %u pool blocks free, min %u\n",
+                   MEMORY_STATIC_TOTAL, MEMORY_STATIC_BUDGET, blockpool_get_free(), BLOCKPOOL_NUM_BLOCKS, telemetry.poolMinFree);
+    print(uartBuf);
+    for (uint8_t i = 0; i < telemetry.numTasks; i++) {
+        telemetry_format(uartBuf, i);
+        print(uartBuf);
+    }
+}
+
+// prints the estimated current draw of the current recording
+void Sensors_print_power() {
+    struct PowerEstimate estimate;
+    power_get(&estimate);
+    System_sprintf(uartBuf, "power: %u ms acquiring, %u ms standby, %u ms idle, %u uA recording, %u uA average, %u h on %u mAh\n",
+                   estimate.stateMs[POWER_STATE_ACQUIRING], estimate.stateMs[POWER_STATE_STANDBY], estimate.stateMs[POWER_STATE_IDLE],
+                   estimate.recordingUa, estimate.averageUa, estimate.recordingHours, POWER_CELL_MAH);
+    print(uartBuf);
+}
+
+// prints the timing of every DACtimerCallback phase in cpu cycles
+void Sensors_print_profile() {
+    struct ProfilerSummary summary;
+    profiler_get_summary(&summary);
+    System_sprintf(uartBuf, "profile: %u ticks, %u cycles per tick, %u overruns\n", summary.ticks, summary.periodCycles, summary.overruns);
+    print(uartBuf);
+    for (uint8_t i = 0; i < PROFILER_NUM_STAGES; i++) {
+        profiler_format(uartBuf, i);
+        print(uartBuf);
+    }
+}
+
 // Write to the UART/terminal with print()
 void print(char *str) {
     UART_write(uart, str, strlen(str));
@@ -641,6 +938,7 @@ void print(char *str) {
 
 void Sensors_serializer_output() {
     if (sumSample) {
+        uint32_t start = profiler_now();
         if (EMG) {
             if (successImpAdd[muxmod]) milvolt = impSum[muxmod] / successImpAdd[muxmod];
             else milvolt = 49999.99;
@@ -653,22 +951,44 @@ void Sensors_serializer_output() {
         impSum[muxmod] = 0;
         successImpAdd[muxmod] = 0;
         /* IMPORTANT: WRITE IMPEDANCE VALUE TO SD CARD AND/OR UART BUF */
-        if (serializer_isFull()){
-            if (FOURTYEIGHT) serializer_setTimestamp((uint16_t) (milliseconds/1000)); // checking if 16 impedance values have been added to the array
-            else serializer_setTimestamp((uint16_t) milliseconds); // checking if 16 impedance values have been added to the array
-        }
-        if (EMG) serializer_addImpedance(milvolt); //adding current voltage value for EMG read
-        else serializer_addImpedance(impedance); // adding the current impedance value to the serializer array
-        if (serializer_isFull() && Semaphore_pend(storage_buffer_mutex, 0)) {
-            storage_buffer_length += serializer_serialize(storage_buffer);
-            serializer_serializeReadable(uartBuf); // convert serializer array so it is readable by UART (comment out if UART is unnecessary)
-            print(uartBuf); // write to the UART Buf (comment out if UART is unnecessary)
-            Semaphore_post(storage_buffer_mailbox); // writing to the sd card
+        if (filter_process(muxmod, EMG ? &milvolt : &impedance)) { // median/IIR filter and decimation. Only output when this channel is due
+            if (serializer_isFull()){
+                if (FOURTYEIGHT) serializer_setTimestamp((uint16_t) (milliseconds/1000)); // checking if 16 impedance values have been added to the array
+                else serializer_setTimestamp((uint16_t) milliseconds); // checking if 16 impedance values have been added to the array
+            }
+            if (EMG) serializer_addImpedance(milvolt); //adding current voltage value for EMG read
+            else serializer_addImpedance(impedance); // adding the current impedance value to the serializer array
+            if (serializer_isFull()) pipelineStats.framesBuilt++;
+            if (serializer_isFull() && livestream_is_enabled()) {
+                livestream_push(liveFrame, serializer_serialize(liveFrame)); // queue the frame for the BLE live characteristic
+            }
+            if (serializer_isFull() && !Storage_framesWaiting() && Semaphore_pend(storage_buffer_mutex, 0)) {
+                if (DEADBAND_LOGGING) storage_buffer_length = serializer_serializeDeadband(storage_buffer); // only the channels that changed, may be nothing
+                else storage_buffer_length = serializer_serialize(storage_buffer);
+                serializer_serializeReadable(uartBuf); // convert serializer array so it is readable by UART (comment out if UART is unnecessary)
+                print(uartBuf); // write to the UART Buf (comment out if UART is unnecessary)
+                if (storage_buffer_length) Semaphore_post(storage_buffer_mailbox); // writing to the sd card
+                else {
+                    pipelineStats.framesSuppressed++;
+                    Semaphore_post(storage_buffer_mutex); // nothing to write for this frame
+                }
+            }
+            else if (serializer_isFull()) {
+                // the storage task still has the last frame or is waiting for the card, the frame waits in the ring behind it
+                uint8_t length = DEADBAND_LOGGING ? serializer_serializeDeadband(liveFrame) : serializer_serialize(liveFrame);
+                if (length == 0) pipelineStats.framesSuppressed++;
+                else if (Storage_queueFrame(liveFrame, length)) pipelineStats.framesDeferred++;
+                else pipelineStats.framesSkipped++; // the ring is full too
+            }
         }
         if (muxmod == (channels - 1)){
+            const struct AcquisitionSlot* slot = scheduler_current();
             counterCYCLE = 0;
-            if (EMGIMP) EMG = !EMG; // switch from imp to EMG or vice versa
+            if (scheduler_frameDone()) modeSwitchPending = true; // the next slot runs in the other mode
+            else if (scheduler_current() != slot) Sensors_set_decimation(); // same mode, maybe another output rate
+            if (burstFramesLeft && --burstFramesLeft == 0) burstEndPending = true;
         }
+        profiler_record(PROFILER_OUTPUT, profiler_now() - start);
     }
 }
 // calibration code and functional code have different pin configurations
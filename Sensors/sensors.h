@@ -1,11 +1,32 @@
 #ifndef SENSORS_H
 #define SENSORS_H
 
+#include <stdint.h>
+#include "Config.h"
+#include "Stats.h"
+
 //void Sensors_createTask(void);
 void Sensors_init();
 void Sensors_start_timers();
 void Sensors_stop_timers();
 
+// applies an acquisition config, returns 0 and keeps the running config if it is invalid
+uint8_t Sensors_configure(const struct AcquisitionConfig* config);
+const struct AcquisitionConfig* Sensors_get_config();
+
+// prints the DACtimerCallback profile over UART
+void Sensors_print_profile();
+
+// pipeline counters of the current recording, with the delivered frame rate
+void Sensors_get_stats(struct PipelineStats* stats);
+void Sensors_print_stats();
+
+// prints the last task and heap telemetry sample over UART
+void Sensors_print_telemetry();
+
+// prints the current estimate of the power model, see PowerModel.h
+void Sensors_print_power();
+
 void DA_get_status(int status_code, char* message);
 
 void print();